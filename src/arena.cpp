@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "arena.hpp"
+
+void* lcool::arena::allocate_slow(std::size_t size, std::size_t alignment)
+{
+	// Objects which would waste a lot of the current block get their own block
+	std::size_t new_size = size + alignment;
+	bool own_block = new_size > block_size / 4;
+	if (!own_block)
+		new_size = block_size;
+
+	_blocks.emplace_back(new char[new_size]);
+	_capacity += new_size;
+
+	char* block = _blocks.back().get();
+	std::size_t padding = -reinterpret_cast<std::uintptr_t>(block) & (alignment - 1);
+	void* result = block + padding;
+
+	if (!own_block)
+	{
+		_pos = block + padding + size;
+		_end = block + new_size;
+	}
+
+	return result;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_ARENA_HPP
+#define LCOOL_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "smart_ptr.hpp"
+
+namespace lcool
+{
+	/**
+	 * A bump allocator which frees everything it allocated at once
+	 *
+	 * Objects are placed one after another in large blocks of memory. No
+	 * destructors are ever run, so only trivially destructible objects can
+	 * be stored in an arena.
+	 */
+	class arena
+	{
+	public:
+		arena() = default;
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		/** Allocates some uninitialized memory */
+		void* allocate(std::size_t size, std::size_t alignment)
+		{
+			// Align the current position within the block
+			std::size_t padding = -reinterpret_cast<std::uintptr_t>(_pos) & (alignment - 1);
+			if (size + padding > static_cast<std::size_t>(_end - _pos))
+				return allocate_slow(size, alignment);
+
+			void* result = _pos + padding;
+			_pos += padding + size;
+			return result;
+		}
+
+		/** Constructs a new object in the arena */
+		template <typename T, typename... Args>
+		T* create(Args&&... args)
+		{
+			static_assert(std::is_trivially_destructible<T>::value,
+				"objects in an arena are never destroyed");
+
+			return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		/** Copies an array of objects into the arena */
+		template <typename T>
+		T* copy_array(const T* items, std::size_t count)
+		{
+			static_assert(std::is_trivially_destructible<T>::value,
+				"objects in an arena are never destroyed");
+
+			if (count == 0)
+				return nullptr;
+
+			T* result = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+			for (std::size_t i = 0; i < count; i++)
+				new (result + i) T(items[i]);
+
+			return result;
+		}
+
+		/** Constructs an array of default constructed objects in the arena */
+		template <typename T>
+		T* create_array(std::size_t count)
+		{
+			static_assert(std::is_trivially_destructible<T>::value,
+				"objects in an arena are never destroyed");
+
+			if (count == 0)
+				return nullptr;
+
+			T* result = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+			for (std::size_t i = 0; i < count; i++)
+				new (result + i) T();
+
+			return result;
+		}
+
+		/** Returns the total size of the blocks allocated by this arena */
+		std::size_t capacity() const
+		{
+			return _capacity;
+		}
+
+	private:
+		// Size of a normal block (larger objects get a block of their own)
+		static const std::size_t block_size = 64 * 1024;
+
+		std::vector<unique_ptr<char[]>> _blocks;
+		char* _pos = nullptr;
+		char* _end = nullptr;
+		std::size_t _capacity = 0;
+
+		// Allocates memory from a new block
+		void* allocate_slow(std::size_t size, std::size_t alignment);
+	};
+}
+
+#endif
@@ -15,6 +15,8 @@
  * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <iterator>
+
 #include "ast.hpp"
 
 namespace ast = lcool::ast;
@@ -33,3 +35,133 @@ void ast::constant_string::accept(ast::expr_visitor& visitor) const { visitor.vi
 void ast::identifier     ::accept(ast::expr_visitor& visitor) const { visitor.visit(*this); }
 void ast::compute_unary  ::accept(ast::expr_visitor& visitor) const { visitor.visit(*this); }
 void ast::compute_binary ::accept(ast::expr_visitor& visitor) const { visitor.visit(*this); }
+
+ast::program::program()
+{
+	_arenas.push_back(lcool::make_unique<arena>());
+}
+
+std::size_t ast::program::arena_capacity() const
+{
+	std::size_t total = 0;
+	for (auto& nodes : _arenas)
+		total += nodes->capacity();
+	return total;
+}
+
+void ast::program::append(ast::program&& other)
+{
+	_classes.insert(
+		_classes.end(),
+		std::make_move_iterator(other._classes.begin()),
+		std::make_move_iterator(other._classes.end()));
+	other._classes.clear();
+
+	// The expressions stay where they are, so just take ownership of them
+	for (auto& nodes : other._arenas)
+		_arenas.push_back(std::move(nodes));
+
+	other._arenas.clear();
+	other._arenas.push_back(lcool::make_unique<arena>());
+}
+
+namespace
+{
+	// Visitor which counts every expression in a tree
+	class expr_counter : public ast::expr_visitor
+	{
+	public:
+		std::size_t count = 0;
+
+		void count_expr(const ast::expr* expr)
+		{
+			if (expr)
+				expr->accept(*this);
+		}
+
+		void visit(const ast::assign& e) override
+		{
+			count++;
+			count_expr(e.value);
+		}
+
+		void visit(const ast::dispatch& e) override
+		{
+			count++;
+			count_expr(e.object);
+			for (auto& arg : e.arguments)
+				count_expr(arg);
+		}
+
+		void visit(const ast::conditional& e) override
+		{
+			count++;
+			count_expr(e.predicate);
+			count_expr(e.if_true);
+			count_expr(e.if_false);
+		}
+
+		void visit(const ast::loop& e) override
+		{
+			count++;
+			count_expr(e.predicate);
+			count_expr(e.body);
+		}
+
+		void visit(const ast::block& e) override
+		{
+			count++;
+			for (auto& statement : e.statements)
+				count_expr(statement);
+		}
+
+		void visit(const ast::let& e) override
+		{
+			count++;
+			for (auto& var : e.vars)
+				count_expr(var.initial);
+			count_expr(e.body);
+		}
+
+		void visit(const ast::type_case& e) override
+		{
+			count++;
+			count_expr(e.value);
+			for (auto& branch : e.branches)
+				count_expr(branch.body);
+		}
+
+		void visit(const ast::new_object&) override      { count++; }
+		void visit(const ast::constant_bool&) override   { count++; }
+		void visit(const ast::constant_int&) override    { count++; }
+		void visit(const ast::constant_string&) override { count++; }
+		void visit(const ast::identifier&) override      { count++; }
+
+		void visit(const ast::compute_unary& e) override
+		{
+			count++;
+			count_expr(e.body);
+		}
+
+		void visit(const ast::compute_binary& e) override
+		{
+			count++;
+			count_expr(e.left);
+			count_expr(e.right);
+		}
+	};
+}
+
+std::size_t ast::count_exprs(const ast::program& program)
+{
+	expr_counter counter;
+	for (auto& cls : program)
+	{
+		for (auto& attr : cls.attributes)
+			counter.count_expr(attr.initial);
+		for (auto& method : cls.methods)
+			counter.count_expr(method.body);
+	}
+
+	return counter.count;
+}
@@ -19,22 +19,74 @@
 #define LCOOL_AST_HPP
 
 #include <boost/optional/optional.hpp>
+#include <llvm/ADT/StringRef.h>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
+#include "arena.hpp"
 #include "logger.hpp"
 #include "smart_ptr.hpp"
+#include "symbol.hpp"
 
 namespace lcool { namespace ast
 {
 	class expr_visitor;
 
-	/** Base class for expressions */
+	/**
+	 * An array of AST nodes (stored in the program's arena)
+	 *
+	 * Lists are built by the parser and are immutable afterwards.
+	 */
+	template <typename T>
+	class node_list
+	{
+	public:
+		typedef const T* const_iterator;
+
+		/** Creates an empty list */
+		node_list()
+			: _items(nullptr), _size(0)
+		{
+		}
+
+		/** Creates a list from an array which is already in the arena */
+		node_list(const T* items, std::size_t size)
+			: _items(items), _size(size)
+		{
+		}
+
+		/** Copies a vector into the arena and creates a list from it */
+		node_list(arena& nodes, const std::vector<T>& items)
+			: _items(nodes.copy_array(items.data(), items.size())), _size(items.size())
+		{
+		}
+
+		const T* begin() const        { return _items; }
+		const T* end() const          { return _items + _size; }
+		std::size_t size() const      { return _size; }
+		bool empty() const            { return _size == 0; }
+
+		const T& operator[](std::size_t i) const
+		{
+			return _items[i];
+		}
+
+	private:
+		const T* _items;
+		std::size_t _size;
+	};
+
+	/**
+	 * Base class for expressions
+	 *
+	 * Expressions are allocated in the arena owned by their program, so they
+	 * are never deleted individually and must be trivially destructible.
+	 */
 	class expr
 	{
 	public:
-		virtual ~expr() { }
 
 		/**
 		 * Calls the relevant function of visitor depending on the type of this expression
@@ -46,6 +98,9 @@ namespace lcool { namespace ast
 
 		/** The location of the start of this expression */
 		location loc;
+
+	protected:
+		~expr() = default;
 	};
 
 	/** An attribute declaration (also used for let statements) */
@@ -56,13 +111,13 @@ namespace lcool { namespace ast
 		location loc;
 
 		/** Name of the attribute */
-		std::string name;
+		symbol name;
 
 		/** Type of variable / attribute */
-		std::string type;
+		symbol type;
 
 		/** Optional initial value */
-		unique_ptr<expr> initial;
+		expr* initial = nullptr;
 	};
 
 	/** Expression assigning a value to an identifier */
@@ -72,10 +127,10 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Identifier to assign to */
-		std::string id;
+		symbol id;
 
 		/** Value to assign */
-		unique_ptr<expr> value;
+		expr* value = nullptr;
 	};
 
 	/** Method dispatch / call expression */
@@ -85,16 +140,16 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Name of method to call */
-		std::string method_name;
+		symbol method_name;
 
 		/** Optional object to call method on (or self) */
-		unique_ptr<expr> object;
+		expr* object = nullptr;
 
-		/** Static type of the object being called */
-		boost::optional<std::string> object_type;
+		/** Static type of the object being called (empty if none was given) */
+		symbol object_type;
 
 		/** List of arguments */
-		std::vector<unique_ptr<expr>> arguments;
+		node_list<expr*> arguments;
 	};
 
 	/** Condition expression (if statement) */
@@ -104,13 +159,13 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Predicate to test on */
-		unique_ptr<expr> predicate;
+		expr* predicate = nullptr;
 
 		/** Value to return if predicate is true */
-		unique_ptr<expr> if_true;
+		expr* if_true = nullptr;
 
 		/** Value to return if predicate is false */
-		unique_ptr<expr> if_false;
+		expr* if_false = nullptr;
 	};
 
 	/** While loop */
@@ -120,10 +175,10 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Predicate to test on */
-		unique_ptr<expr> predicate;
+		expr* predicate = nullptr;
 
 		/** Body of the loop */
-		unique_ptr<expr> body;
+		expr* body = nullptr;
 	};
 
 	/** Statement block */
@@ -133,7 +188,7 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** List of statements, last statement is the value of the block */
-		std::vector<unique_ptr<expr>> statements;
+		node_list<expr*> statements;
 	};
 
 	/** Let expression (declares local variables + scope) */
@@ -143,10 +198,10 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** List of variables to declare */
-		std::vector<attribute> vars;
+		node_list<attribute> vars;
 
 		/** Let expression body */
-		unique_ptr<expr> body;
+		expr* body = nullptr;
 	};
 
 	/** An individual branch of a type case expression */
@@ -154,13 +209,13 @@ namespace lcool { namespace ast
 	{
 	public:
 		/** Name of the identifier to introduce with the more specific type */
-		std::string id;
+		symbol id;
 
 		/** Type to test for */
-		std::string type;
+		symbol type;
 
 		/** Body of the branch */
-		unique_ptr<expr> body;
+		expr* body = nullptr;
 	};
 
 	/** Type case expression (boo hiss) */
@@ -170,10 +225,10 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Value to test type of */
-		unique_ptr<expr> value;
+		expr* value = nullptr;
 
 		/** List of case branches */
-		std::vector<type_case_branch> branches;
+		node_list<type_case_branch> branches;
 	};
 
 	/** Creates a new object of the given type */
@@ -183,7 +238,7 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Type of the new object */
-		std::string type;
+		symbol type;
 	};
 
 	/** Constant boolean */
@@ -212,8 +267,8 @@ namespace lcool { namespace ast
 	public:
 		virtual void accept(expr_visitor& visitor) const override;
 
-		/** Value of the constant (processed to remove escape codes) */
-		std::string value;
+		/** Value of the constant (processed to remove escape codes, stored in the arena) */
+		llvm::StringRef value;
 	};
 
 	/** Read an identifier (local var / local attribute) */
@@ -223,7 +278,7 @@ namespace lcool { namespace ast
 		virtual void accept(expr_visitor& visitor) const override;
 
 		/** Identifier to read */
-		std::string id;
+		symbol id;
 	};
 
 	/** Types of unary operations */
@@ -244,7 +299,7 @@ namespace lcool { namespace ast
 		compute_unary_type op;
 
 		/** Sub expression */
-		unique_ptr<expr> body;
+		expr* body = nullptr;
 	};
 
 	/** Types of binary operations */
@@ -269,10 +324,10 @@ namespace lcool { namespace ast
 		compute_binary_type op;
 
 		/** Left sub expression */
-		unique_ptr<expr> left;
+		expr* left = nullptr;
 
 		/** Right sub expression */
-		unique_ptr<expr> right;
+		expr* right = nullptr;
 	};
 
 	/** Visitor class used to traverse expression trees */
@@ -305,16 +360,16 @@ namespace lcool { namespace ast
 		location loc;
 
 		/** Method name */
-		std::string name;
+		symbol name;
 
 		/** Return type */
-		std::string type;
+		symbol type;
 
 		/** Method parameters (name, type) */
-		std::vector<std::pair<std::string, std::string>> params;
+		std::vector<std::pair<symbol, symbol>> params;
 
 		/** Method body */
-		unique_ptr<expr> body;
+		expr* body = nullptr;
 	};
 
 	/** AST for a cool class */
@@ -331,10 +386,10 @@ namespace lcool { namespace ast
 		location loc;
 
 		/** Name of class */
-		std::string name;
+		symbol name;
 
 		/** Parent of the class (inherits from) */
-		boost::optional<std::string> parent;
+		boost::optional<symbol> parent;
 
 		/** Attribute definitions */
 		std::vector<attribute> attributes;
@@ -343,8 +398,62 @@ namespace lcool { namespace ast
 		std::vector<method> methods;
 	};
 
-	/** Collection of classes which make up a program */
-	typedef std::vector<cls> program;
+	/**
+	 * Collection of classes which make up a program
+	 *
+	 * The program owns the arena(s) containing all of its expressions.
+	 */
+	class program
+	{
+	public:
+		typedef std::vector<cls>::iterator iterator;
+		typedef std::vector<cls>::const_iterator const_iterator;
+
+		program();
+		program(program&&)            = default;
+		program& operator=(program&&) = default;
+
+		iterator begin()              { return _classes.begin(); }
+		iterator end()                { return _classes.end(); }
+		const_iterator begin() const  { return _classes.begin(); }
+		const_iterator end() const    { return _classes.end(); }
+		std::size_t size() const      { return _classes.size(); }
+		bool empty() const            { return _classes.empty(); }
+
+		cls& operator[](std::size_t i)             { return _classes[i]; }
+		const cls& operator[](std::size_t i) const { return _classes[i]; }
+
+		/** Adds a class to the end of the program */
+		void push_back(cls&& new_cls)
+		{
+			_classes.push_back(std::move(new_cls));
+		}
+
+		/** Reserves space for the given number of classes */
+		void reserve(std::size_t size)
+		{
+			_classes.reserve(size);
+		}
+
+		/** Returns the arena new expressions in this program are allocated in */
+		arena& nodes()
+		{
+			return *_arenas.front();
+		}
+
+		/** Returns the total size of the memory allocated for expressions */
+		std::size_t arena_capacity() const;
+
+		/** Moves every class (and its expressions) from another program to the end of this one */
+		void append(program&& other);
+
+	private:
+		std::vector<unique_ptr<arena>> _arenas;
+		std::vector<cls> _classes;
+	};
+
+	/** Returns the total number of expressions in a program */
+	std::size_t count_exprs(const program& program);
 }}
 
 #endif
@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/format.hpp>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_file.hpp"
+#include "source_manager.hpp"
+
+namespace flat_ast = lcool::flat_ast;
+
+namespace
+{
+	// File layout (all integers are in the byte order of the machine which
+	//  wrote the file):
+	//   header
+	//   source_file[file_count]
+	//   string_entry[string_count]
+	//   disk_node[node_count]
+	//   char[string_data_size]
+	//
+	// String 0 is always the empty string. Locations in the file are
+	//  relative to the source files they came from: each source file is
+	//  given a range of locations starting at its base. Source files are
+	//  stored with absolute paths and are only read if a diagnostic needs
+	//  one of their locations. Their contents are hashed so that changes
+	//  can be detected then.
+
+	const char ast_file_magic[8] = { 'L', 'C', 'O', 'O', 'L', 'A', 'S', 'T' };
+	const std::uint32_t ast_file_version = 2;
+	const std::uint32_t ast_file_byte_order = 0x01020304;
+
+	struct header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint32_t file_count;
+		std::uint32_t string_count;
+		std::uint32_t node_count;
+		std::uint32_t string_data_size;
+	};
+
+	struct source_file
+	{
+		std::uint32_t name;
+		std::uint32_t base;
+		std::uint32_t size;
+		std::uint32_t reserved;
+		std::uint64_t hash;
+	};
+
+	struct string_entry
+	{
+		std::uint32_t offset;
+		std::uint32_t length;
+	};
+
+	struct disk_node
+	{
+		std::uint8_t kind;
+		std::uint8_t op;
+		std::uint16_t reserved;
+		std::uint32_t size;
+		std::uint32_t loc;
+		std::int32_t value;
+		std::uint32_t name;
+		std::uint32_t type;
+	};
+
+	static_assert(sizeof(header) == 32, "unexpected AST file header size");
+	static_assert(sizeof(source_file) == 24, "unexpected AST file source file size");
+	static_assert(sizeof(string_entry) == 8, "unexpected AST file string size");
+	static_assert(sizeof(disk_node) == 24, "unexpected AST file node size");
+
+	// Returns the absolute path of a source file (so the AST file can be
+	//  used from any directory)
+	std::string absolute_path(const std::string& filename)
+	{
+		llvm::SmallString<128> path(filename);
+		if (llvm::sys::fs::make_absolute(path))
+			return filename;
+
+		return std::string(path.begin(), path.end());
+	}
+
+	// Collects the string and source file tables while a file is written
+	class table_builder
+	{
+	public:
+		std::vector<source_file> files;
+		std::vector<string_entry> strings;
+		std::string string_data;
+
+		table_builder()
+		{
+			add_string(std::string());
+		}
+
+		// Returns the index of a string (adding it if needed)
+		std::uint32_t add_string(const std::string& str)
+		{
+			auto result = _string_indexes.emplace(str, strings.size());
+			if (result.second)
+			{
+				strings.push_back(string_entry { std::uint32_t(string_data.size()), std::uint32_t(str.size()) });
+				string_data += str;
+			}
+
+			return result.first->second;
+		}
+
+		// Converts a location into one relative to its source file
+		std::uint32_t add_location(lcool::location loc)
+		{
+			if (!loc.valid())
+				return 0;
+
+			// Most locations are in the same file as the last one
+			if (loc.offset() - _last.start.offset() >= _last.size)
+			{
+				_last = lcool::source_manager::instance().find_file(loc);
+				if (_last.filename == nullptr || loc.offset() - _last.start.offset() >= _last.size)
+				{
+					_last.size = 0;
+					return 0;
+				}
+
+				auto result = _file_indexes.emplace(_last.start.offset(), files.size());
+				if (result.second)
+				{
+					std::uint32_t base = files.empty() ? 1 : files.back().base + files.back().size;
+					files.push_back(source_file { add_string(absolute_path(*_last.filename)), base, _last.size, 0, _last.hash });
+				}
+
+				_last_base = files[result.first->second].base;
+			}
+
+			return _last_base + (loc.offset() - _last.start.offset());
+		}
+
+	private:
+		std::unordered_map<std::string, std::uint32_t> _string_indexes;
+		std::unordered_map<std::uint32_t, std::uint32_t> _file_indexes;
+
+		lcool::source_range _last = { nullptr, lcool::location(), 0, 0 };
+		std::uint32_t _last_base = 0;
+	};
+
+	// Writes an array of structures
+	template <typename T>
+	void write_array(llvm::raw_ostream& output, const std::vector<T>& items)
+	{
+		output.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+	}
+
+	// Reads a structure from anywhere in a buffer (which may not be aligned)
+	template <typename T>
+	T read_struct(const char* data)
+	{
+		T result;
+		std::memcpy(&result, data, sizeof(T));
+		return result;
+	}
+}
+
+bool lcool::is_ast_file(llvm::StringRef data)
+{
+	return data.startswith(llvm::StringRef(ast_file_magic, sizeof(ast_file_magic)));
+}
+
+void lcool::write_ast_file(llvm::raw_ostream& output, const flat_ast::tree& tree)
+{
+	table_builder tables;
+
+	// Convert the nodes first so all the strings and files are known
+	std::vector<disk_node> nodes;
+	nodes.reserve(tree.nodes().size());
+
+	for (const flat_ast::node& n : tree.nodes())
+	{
+		disk_node result = {};
+		result.kind = static_cast<std::uint8_t>(n.kind);
+		result.op = n.op;
+		result.size = n.size;
+		result.loc = tables.add_location(n.loc);
+		result.name = tables.add_string(n.name.str());
+		result.type = tables.add_string(n.type.str());
+
+		if (n.kind == flat_ast::node_kind::constant_string)
+			result.value = tables.add_string(tree.string_value(n));
+		else
+			result.value = n.value;
+
+		nodes.push_back(result);
+	}
+
+	header head = {};
+	std::memcpy(head.magic, ast_file_magic, sizeof(ast_file_magic));
+	head.version = ast_file_version;
+	head.byte_order = ast_file_byte_order;
+	head.file_count = tables.files.size();
+	head.string_count = tables.strings.size();
+	head.node_count = nodes.size();
+	head.string_data_size = tables.string_data.size();
+
+	output.write(reinterpret_cast<const char*>(&head), sizeof(head));
+	write_array(output, tables.files);
+	write_array(output, tables.strings);
+	write_array(output, nodes);
+	output << tables.string_data;
+}
+
+lcool::ast::program lcool::load_ast_file(unique_ptr<llvm::MemoryBuffer> input, const std::string& filename, logger& log)
+{
+	llvm::StringRef data = input->getBuffer();
+	if (data.size() < sizeof(header) || !is_ast_file(data))
+	{
+		log.error(boost::format("'%s' is not an AST file") % filename);
+		return ast::program();
+	}
+
+	header head = read_struct<header>(data.data());
+	if (head.version != ast_file_version || head.byte_order != ast_file_byte_order)
+	{
+		log.error(boost::format("'%s' was written by an incompatible version of lcoolc") % filename);
+		return ast::program();
+	}
+
+	// Find each section of the file
+	std::uint64_t files_offset = sizeof(header);
+	std::uint64_t strings_offset = files_offset + std::uint64_t(head.file_count) * sizeof(source_file);
+	std::uint64_t nodes_offset = strings_offset + std::uint64_t(head.string_count) * sizeof(string_entry);
+	std::uint64_t data_offset = nodes_offset + std::uint64_t(head.node_count) * sizeof(disk_node);
+
+	auto corrupt = [&]()
+	{
+		log.error(boost::format("'%s' is corrupt") % filename);
+		return ast::program();
+	};
+
+	if (data_offset + head.string_data_size != data.size() || head.string_count == 0)
+		return corrupt();
+
+	// Read the string table (symbols are only interned when used)
+	std::vector<llvm::StringRef> strings;
+	strings.reserve(head.string_count);
+
+	llvm::StringRef string_data = data.substr(data_offset);
+	for (std::uint32_t i = 0; i < head.string_count; i++)
+	{
+		auto entry = read_struct<string_entry>(data.data() + strings_offset + i * sizeof(string_entry));
+		if (entry.offset > string_data.size() || entry.length > string_data.size() - entry.offset)
+			return corrupt();
+
+		strings.push_back(string_data.substr(entry.offset, entry.length));
+	}
+
+	// Read the source file table
+	std::vector<source_file> files;
+	for (std::uint32_t i = 0; i < head.file_count; i++)
+	{
+		auto file = read_struct<source_file>(data.data() + files_offset + i * sizeof(source_file));
+		std::uint32_t base = files.empty() ? 1 : files.back().base + files.back().size;
+		if (file.name >= strings.size() || file.base != base || file.size == 0 ||
+			file.size > std::numeric_limits<std::uint32_t>::max() - base)
+			return corrupt();
+
+		files.push_back(file);
+	}
+
+	// The source files are not read unless a diagnostic needs them
+	std::vector<location> starts;
+	for (const source_file& file : files)
+		starts.push_back(source_manager::instance().add_lazy_file(strings[file.name].str(), file.size - 1, file.hash));
+
+	// Relocates a location from the file (most are in the same file as the last one)
+	std::size_t last_file = 0;
+	auto relocate = [&](std::uint32_t loc)
+	{
+		if (last_file >= files.size() || loc - files[last_file].base >= files[last_file].size)
+		{
+			auto iter = std::upper_bound(files.begin(), files.end(), loc,
+				[](std::uint32_t offset, const source_file& file)
+				{
+					return offset < file.base;
+				});
+
+			if (iter == files.begin())
+				return location();
+
+			last_file = (iter - 1) - files.begin();
+			if (loc - files[last_file].base >= files[last_file].size)
+				return location();
+		}
+
+		if (!starts[last_file].valid())
+			return location();
+
+		return location(starts[last_file].offset() + (loc - files[last_file].base));
+	};
+
+	// Read the nodes
+	//  Only string 0 is empty, so any other empty symbol has not been interned yet
+	std::vector<symbol> symbols(strings.size());
+	auto intern = [&](std::uint32_t index)
+	{
+		if (index != 0 && symbols[index].empty())
+			symbols[index] = symbol(strings[index]);
+
+		return symbols[index];
+	};
+
+	std::vector<flat_ast::node> nodes;
+	std::vector<std::string> constant_strings;
+	nodes.reserve(head.node_count);
+
+	for (std::uint32_t i = 0; i < head.node_count; i++)
+	{
+		auto node = read_struct<disk_node>(data.data() + nodes_offset + i * sizeof(disk_node));
+		if (node.name >= strings.size() || node.type >= strings.size())
+			return corrupt();
+
+		flat_ast::node result = {};
+		result.kind = static_cast<flat_ast::node_kind>(node.kind);
+		result.op = node.op;
+		result.size = node.size;
+		result.loc = relocate(node.loc);
+		result.value = node.value;
+		result.name = intern(node.name);
+		result.type = intern(node.type);
+
+		if (result.kind == flat_ast::node_kind::constant_string)
+		{
+			if (node.value < 0 || std::uint32_t(node.value) >= strings.size())
+				return corrupt();
+
+			result.value = constant_strings.size();
+			constant_strings.push_back(strings[node.value].str());
+		}
+
+		nodes.push_back(result);
+	}
+
+	flat_ast::tree tree(std::move(nodes), std::move(constant_strings));
+	if (!flat_ast::is_well_formed(tree))
+		return corrupt();
+
+	return flat_ast::unflatten(tree);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LCOOL_AST_FILE_HPP
+#define LCOOL_AST_FILE_HPP
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+
+#include "ast.hpp"
+#include "flat_ast.hpp"
+#include "logger.hpp"
+#include "smart_ptr.hpp"
+
+namespace lcool
+{
+	/**
+	 * Returns true if some data starts with the header of a binary AST file
+	 *
+	 * @param data contents of the file
+	 */
+	bool is_ast_file(llvm::StringRef data);
+
+	/**
+	 * Writes a flat AST to a binary AST file (normally ending in .clast)
+	 *
+	 * Locations are stored relative to the source files they came from so
+	 * they can be reused when the file is loaded again. Source files are
+	 * stored with absolute paths so the file can be loaded from any
+	 * working directory.
+	 *
+	 * @param output stream to write to
+	 * @param tree   flat tree to write
+	 */
+	void write_ast_file(llvm::raw_ostream& output, const flat_ast::tree& tree);
+
+	/**
+	 * Loads a program from a binary AST file
+	 *
+	 * The file is used in place (so it should be memory mapped) and only the
+	 * AST itself is rebuilt. The original source files are added to the
+	 * source manager, but are only read if a diagnostic needs one of their
+	 * locations (see source_manager::add_lazy_file).
+	 *
+	 * @param input    contents of the file
+	 * @param filename name of the file (for error messages)
+	 * @param log      logger to print errors to
+	 * @return the loaded program (empty if there was an error)
+	 */
+	ast::program load_ast_file(unique_ptr<llvm::MemoryBuffer> input, const std::string& filename, logger& log);
+}
+
+#endif
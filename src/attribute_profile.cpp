@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/format.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "attribute_profile.hpp"
+
+using boost::format;
+
+bool lcool::attribute_profile::load(const std::string& filename, logger& log)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		log.error(format("error opening '%s': %s") % filename % std::strerror(errno));
+		return false;
+	}
+
+	std::string line;
+	for (unsigned line_number = 1; std::getline(file, line); line_number++)
+	{
+		// Each line is "Class.attribute count"
+		std::istringstream line_stream(line);
+		std::string name;
+		std::uint64_t count;
+		std::string::size_type dot;
+
+		if (!(line_stream >> name >> count) ||
+			(dot = name.find('.')) == std::string::npos ||
+			dot == 0 || dot == name.size() - 1)
+		{
+			log.error(format("%s:%u: invalid profile entry") % filename % line_number);
+			return false;
+		}
+
+		symbol cls(name.substr(0, dot));
+		symbol attribute(name.substr(dot + 1));
+		_counts[cls][attribute] += count;
+	}
+
+	return true;
+}
+
+bool lcool::attribute_profile::has_class(symbol cls) const
+{
+	return _counts.find(cls) != _counts.end();
+}
+
+std::uint64_t lcool::attribute_profile::count(symbol cls, symbol attribute) const
+{
+	auto cls_iter = _counts.find(cls);
+	if (cls_iter == _counts.end())
+		return 0;
+
+	auto iter = cls_iter->second.find(attribute);
+	if (iter == cls_iter->second.end())
+		return 0;
+
+	return iter->second;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_ATTRIBUTE_PROFILE_HPP
+#define LCOOL_ATTRIBUTE_PROFILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "logger.hpp"
+#include "symbol.hpp"
+
+namespace lcool
+{
+	/**
+	 * Counts of the number of times each attribute was accessed
+	 *
+	 * These are written by programs compiled with --profile-generate. Each
+	 * line of the file contains the name of an attribute (as Class.attribute)
+	 * followed by the number of times it was read or assigned to by the
+	 * program's code (attribute initializers and the implicit copying and
+	 * destruction of objects are not counted).
+	 */
+	class attribute_profile
+	{
+	public:
+		/**
+		 * Reads a profile from a file
+		 *
+		 * @param filename the file to read
+		 * @param log logger to log any errors to
+		 * @return true on success
+		 */
+		bool load(const std::string& filename, logger& log);
+
+		/** Returns true if the profile contains any attributes of a class */
+		bool has_class(symbol cls) const;
+
+		/** Returns the number of times an attribute was accessed (0 if it is not in the profile) */
+		std::uint64_t count(symbol cls, symbol attribute) const;
+
+	private:
+		std::unordered_map<symbol, std::unordered_map<symbol, std::uint64_t>> _counts;
+	};
+}
+
+#endif
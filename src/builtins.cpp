@@ -24,6 +24,7 @@
 
 #include "builtins.hpp"
 #include "cool_program.hpp"
+#include "timing.hpp"
 
 using namespace lcool;
 
@@ -35,13 +36,24 @@ static const unsigned char bitcode_data[] = {
 // Builtin pre-baked cool objects
 namespace
 {
+	/** Aborts if reading part of the runtime failed (which should never happen) */
+	void materialize_or_die(std::error_code error)
+	{
+		if (error)
+		{
+			std::cerr << "fatal error: failed to read lcool runtime bitcode ("
+				<< error.message() << ")" << std::endl;
+			std::abort();
+		}
+	}
+
 	/** A builtin reference type class (Object, IO, String) */
 	class builtin_ref_class : public cool_class
 	{
 	public:
 		/** Creates a builtin class and extracts the LLVM structures from the given module */
 		builtin_ref_class(llvm::Module* module, const std::string& name, cool_class* parent)
-			: cool_class(name, parent), _module(module)
+			: cool_class(symbol(name), parent), _module(module)
 		{
 			// Add LLVM objects
 			_llvm_type = module->getTypeByName(name)->getPointerTo();
@@ -63,20 +75,21 @@ namespace
 			std::initializer_list<cool_class*> param_types = {})
 		{
 			// Create method slot
+			symbol method_name(name);
 			auto slot = make_unique<cool_method_slot>();
-			slot->name = name;
+			slot->name = method_name;
 			slot->return_type = return_type;
 			slot->parameter_types.assign(param_types);
 			slot->declaring_class = this;
 			slot->vtable_index = vtable_index;
 
 			// Get LLVM function
-			auto func = _module->getFunction(this->name() + "." + name);
+			auto func = _module->getFunction(this->name().str() + "." + name);
 			assert(func != nullptr);
 
 			// Create and insert method
-			auto result = _methods.emplace(name, lcool::make_unique<cool_method>(std::move(slot), func));
-			assert(result.second);
+			auto result = insert_method(lcool::make_unique<cool_method>(std::move(slot), func));
+			assert(result != nullptr);
 		}
 
 		/** Creates a new static method */
@@ -88,6 +101,8 @@ namespace
 			add_method(name, return_type, 0, param_types);
 		}
 
+		using cool_class::build_method_table;
+
 	protected:
 		llvm::Module* _module;
 	};
@@ -114,6 +129,11 @@ namespace
 			return empty_str;
 		}
 
+		virtual llvm::Value* default_value(llvm::IRBuilder<>& builder) const override
+		{
+			return create_object(builder);
+		}
+
 		virtual void ensure_not_null(llvm::IRBuilder<>&, llvm::Value*) const override
 		{
 			// Strings can never be null, so this is a no-op
@@ -130,7 +150,7 @@ namespace
 			const std::string& name,
 			cool_class* parent,
 			llvm::IntegerType* type)
-			: cool_class(name, parent), _module(module)
+			: cool_class(symbol(name), parent), _module(module)
 		{
 			// Add LLVM objects
 			_llvm_type = type;
@@ -151,6 +171,11 @@ namespace
 			return llvm::ConstantInt::get(_llvm_type, 0);
 		}
 
+		virtual llvm::Value* default_value(llvm::IRBuilder<>& builder) const override
+		{
+			return create_object(builder);
+		}
+
 		virtual llvm::Value* upcast_to(llvm::IRBuilder<>& builder, llvm::Value* value, const cool_class* to) const override
 		{
 			// Handle self
@@ -162,7 +187,7 @@ namespace
 				return nullptr;
 
 			// Box this value
-			return call_global(builder, _name + "$box", { value });
+			return call_global(builder, _name.str() + "$box", { value });
 		}
 
 		virtual llvm::Value* downcast(llvm::IRBuilder<>& builder, llvm::Value* value) const override
@@ -171,7 +196,7 @@ namespace
 			assert(value->getType() == _parent->llvm_type());
 
 			// Unbox this value
-			return call_global(builder, _name + "$unbox", { value });
+			return call_global(builder, _name.str() + "$unbox", { value });
 		}
 
 		virtual void refcount_inc(llvm::IRBuilder<>&, llvm::Value*) const override
@@ -186,6 +211,8 @@ namespace
 		{
 		}
 
+		using cool_class::build_method_table;
+
 	private:
 		llvm::Module* _module;
 	};
@@ -193,10 +220,14 @@ namespace
 
 unique_ptr<llvm::Module> lcool::builtins_load_bitfile(llvm::LLVMContext& context)
 {
+	time_scope timer("load runtime");
+
 	// Parse bitcode_data to get an LLVM module
+	//  Only the globals and function prototypes are read here. The function
+	//  bodies are read by builtins_materialize once we know which are used.
 	llvm::StringRef bitcode_data_ref(reinterpret_cast<const char*>(bitcode_data), sizeof(bitcode_data));
-	llvm::MemoryBufferRef buf(bitcode_data_ref, "lcool_runtime");
-	llvm::ErrorOr<unique_ptr<llvm::Module>> src = llvm::parseBitcodeFile(buf, context);
+	auto buf = llvm::MemoryBuffer::getMemBuffer(bitcode_data_ref, "lcool_runtime", false);
+	llvm::ErrorOr<unique_ptr<llvm::Module>> src = llvm::getLazyBitcodeModule(std::move(buf), context);
 
 	if (!src)
 	{
@@ -209,6 +240,37 @@ unique_ptr<llvm::Module> lcool::builtins_load_bitfile(llvm::LLVMContext& context
 	return std::move(*src);
 }
 
+void lcool::builtins_materialize(llvm::Module& module)
+{
+	time_scope timer("materialize runtime");
+
+	// Read the bodies of all the used runtime functions (which may use
+	//  more runtime functions)
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (llvm::Function& func : module)
+		{
+			if (func.isMaterializable() && !func.use_empty())
+			{
+				materialize_or_die(func.materialize());
+				changed = true;
+			}
+		}
+	}
+
+	// Everything left is never used, so it can be dropped without reading it
+	for (auto it = module.begin(); it != module.end(); )
+	{
+		llvm::Function& func = *it++;
+		if (func.isMaterializable())
+			func.eraseFromParent();
+	}
+
+	materialize_or_die(module.materializeAll());
+}
+
 void lcool::builtins_register(lcool::cool_program& program)
 {
 	llvm::Module* module = program.module();
@@ -239,4 +301,11 @@ void lcool::builtins_register(lcool::cool_program& program)
 	cls_string->add_static_method("length", cls_int);
 	cls_string->add_static_method("concat", cls_string, { cls_string });
 	cls_string->add_static_method("substr", cls_string, { cls_int, cls_int });
+
+	// Build method tables (parents first)
+	cls_object->build_method_table();
+	cls_io->build_method_table();
+	cls_string->build_method_table();
+	cls_bool->build_method_table();
+	cls_int->build_method_table();
 }
@@ -28,10 +28,24 @@ namespace lcool
 	/**
 	 * Loads the lcool runtime into a new LLVM Module
 	 *
+	 * The runtime is loaded lazily, so the module is incomplete until
+	 * builtins_materialize has been called on it.
+	 *
 	 * @param context LLVM context to creat Module in
 	 */
 	unique_ptr<llvm::Module> builtins_load_bitfile(llvm::LLVMContext& context);
 
+	/**
+	 * Reads in the bodies of the runtime functions used by a module
+	 *
+	 * The runtime functions which are never used are removed. This must be
+	 * called once all the code has been generated, and before the module is
+	 * verified, optimized or written anywhere.
+	 *
+	 * @param module module originally created by builtins_load_bitfile
+	 */
+	void builtins_materialize(llvm::Module& module);
+
 	/**
 	 * Registers the builtin classes into a cool_program
 	 *
@@ -15,22 +15,29 @@
  * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <boost/range/combine.hpp>
-#include <boost/format.hpp>
-
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+#include "builtins.hpp"
 #include "codegen.hpp"
+#include "layout.hpp"
+#include "timing.hpp"
+#include "typecheck.hpp"
 
 using namespace lcool;
 
 namespace
 {
-// Creates a "dummy" ast::identifier node
-ast::identifier create_dummy_identifier(std::string id)
-{
-	ast::identifier result;
-	result.id = id;
-	return result;
-}
+// Names the code generator treats specially
+const symbol string_symbol("String");
 
 // Returns a pointer to the given slot in an object
 llvm::Value* get_slot_pointer(
@@ -41,129 +48,136 @@ llvm::Value* get_slot_pointer(
 	return builder.CreateInBoundsGEP(object, gep_args);
 }
 
-// Loads an attribute (must be exact type)
-llvm::Value* load_attribute(
-	llvm::IRBuilder<>& builder, llvm::Value* object, cool_attribute* attr)
+// Loads an attribute from the element it is stored in
+llvm::Value* load_slot(
+	llvm::IRBuilder<>& builder, llvm::Value* ptr, cool_attribute* attr)
 {
-	return builder.CreateLoad(get_slot_pointer(builder, object, attr->struct_index));
+	llvm::Value* value = builder.CreateLoad(ptr);
+
+	// Extract packed bools from their flags word
+	if (attr->packed)
+	{
+		if (attr->bit_index != 0)
+			value = builder.CreateLShr(value, attr->bit_index);
+		value = builder.CreateTrunc(value, builder.getInt1Ty());
+	}
+
+	return value;
 }
 
-// Stores a value into an attribute (must be exact type, no refcount handling)
-void store_attribute(
-	llvm::IRBuilder<>& builder, llvm::Value* object,
+// Stores an attribute into the element it is stored in
+void store_slot(
+	llvm::IRBuilder<>& builder, llvm::Value* ptr,
 	cool_attribute* attr, llvm::Value* to_store)
 {
-	builder.CreateStore(to_store, get_slot_pointer(builder, object, attr->struct_index));
+	// Replace a single bit of the flags word for packed bools
+	if (attr->packed)
+	{
+		llvm::Value* word = builder.CreateLoad(ptr);
+		llvm::Type* word_type = word->getType();
+		llvm::Value* mask = llvm::ConstantInt::get(word_type, ~(std::uint64_t(1) << attr->bit_index));
+		llvm::Value* bit = builder.CreateShl(builder.CreateZExt(to_store, word_type), attr->bit_index);
+		to_store = builder.CreateOr(builder.CreateAnd(word, mask), bit);
+	}
+
+	builder.CreateStore(to_store, ptr);
 }
 
-// Returns an object's default initialization value
-llvm::Value* default_initializer(llvm::IRBuilder<>& builder, cool_class* cls)
+// Returns the type of a class's side object
+llvm::StructType* cold_struct_type(cool_class* cls)
 {
-	// For Ints, Bools and Strings, we call the constructor
-	//  otherwise we return null
-	if (cls->name() == "Int" || cls->name() == "Bool" || cls->name() == "String")
-		return cls->create_object(builder);
-	else
-		return llvm::Constant::getNullValue(cls->llvm_type());
+	auto object_type = llvm::cast<llvm::PointerType>(cls->llvm_type())->getElementType();
+	auto cold_pointer = llvm::cast<llvm::StructType>(object_type)->getElementType(cls->cold_struct_index());
+	return llvm::cast<llvm::StructType>(llvm::cast<llvm::PointerType>(cold_pointer)->getElementType());
 }
 
-// An LLVM value attached to its cool class
-struct value_and_cls
+// Allocates an (uninitialized) side object for a class
+llvm::Value* alloc_cold_object(llvm::IRBuilder<>& builder, llvm::Module* module, cool_class* cls)
 {
-	llvm::Value* value;
-	cool_class* cls;
-};
+	// Calculate size using the same gep magic as the vtables
+	llvm::StructType* cold_type = cold_struct_type(cls);
+	auto null_ptr = llvm::ConstantPointerNull::get(cold_type->getPointerTo());
+	auto gep_instruction = llvm::ConstantExpr::getGetElementPtr(cold_type, null_ptr, builder.getInt32(1));
+	auto size = llvm::ConstantExpr::getPtrToInt(gep_instruction, builder.getInt32Ty());
+
+	auto raw = cool_program::call_global(module, builder, "alloc_side_object", { size });
+	return builder.CreateBitCast(raw, cold_type->getPointerTo());
+}
 
-// Stores the stack of arguments and local variables
-class local_vars_stack
+// Returns a pointer to the element an attribute is stored in
+llvm::Value* get_attribute_pointer(
+	llvm::IRBuilder<>& builder, llvm::Value* object, cool_attribute* attr)
 {
-public:
-	// Pushes a new variable
-	//  info contains a POINTER to the variable instead of it's value
-	void push(std::string name, value_and_cls info)
+	// Cold attributes are stored in the side object
+	if (attr->cold)
 	{
-		_vars.emplace_back(name, info);
+		auto call_inst = builder.CreateCall(attr->declaring_class->cold_accessor(), object);
+		call_inst->setCallingConv(llvm::CallingConv::Fast);
+		object = call_inst;
 	}
 
-	// Pop n arguments off the stack
-	void pop(unsigned n = 1)
-	{
-		assert(n <= _vars.size());
-		_vars.resize(_vars.size() - n);
-	}
-
-	// Returns the variable on the top of the stack
-	value_and_cls top()
-	{
-		assert(!_vars.empty());
-		return _vars[_vars.size() - 1].second;
-	}
+	return get_slot_pointer(builder, object, attr->struct_index);
+}
 
-	// Looks up a variable in the stack or returns boost::none if it
-	//  doesn't exist
-	boost::optional<value_and_cls> get(std::string name)
-	{
-		for (auto it = _vars.rbegin(); it != _vars.rend(); it++)
-		{
-			if (it->first == name)
-				return it->second;
-		}
+// Loads an attribute (must be exact type)
+llvm::Value* load_attribute(
+	llvm::IRBuilder<>& builder, llvm::Value* object, cool_attribute* attr)
+{
+	return load_slot(builder, get_attribute_pointer(builder, object, attr), attr);
+}
 
-		return boost::none;
-	}
+// Stores a value into an attribute (must be exact type, no refcount handling)
+void store_attribute(
+	llvm::IRBuilder<>& builder, llvm::Value* object,
+	cool_attribute* attr, llvm::Value* to_store)
+{
+	store_slot(builder, get_attribute_pointer(builder, object, attr), attr, to_store);
+}
 
-	// Number of locals
-	unsigned size() const
+// Increments an attribute's use counter (if the program is instrumented)
+void count_attribute_use(llvm::IRBuilder<>& builder, cool_attribute* attr)
+{
+	if (attr->use_counter != nullptr)
 	{
-		return _vars.size();
+		llvm::Value* count = builder.CreateLoad(attr->use_counter);
+		builder.CreateStore(builder.CreateAdd(count, builder.getInt64(1)), attr->use_counter);
 	}
+}
 
-private:
-	std::vector<std::pair<std::string, value_and_cls>> _vars;
+// An LLVM value attached to its cool class
+struct value_and_cls
+{
+	llvm::Value* value;
+	cool_class* cls;
 };
 
-// Class which handles code generation for each type of expression
-class expr_codegen : public ast::expr_visitor
+// Class which handles code generation for each type of typed expression
+//  The type checker has already resolved everything and reported any
+//  errors, so this only has to lower each expression to LLVM IR.
+class expr_codegen : public typed::expr_visitor
 {
 private:
-	logger& _log;
-
 	// What are we generating code for?
 	cool_program& _program;
-	cool_class* _declaring_cls;
 	llvm::Function* _func;
 
-	// Caches for common classes / objects
-	cool_class* _builtin_int;
-	cool_class* _builtin_bool;
+	// Cached String class (which has its own equality function)
 	cool_class* _builtin_string;
-	value_and_cls _zero;
-	value_and_cls _null_object;
 
 	// The IRBuilder also stores the block were writing instructions into
 	llvm::IRBuilder<> _builder;
 
 	// Holds the result of the most recent "visit" call
-	value_and_cls _result = { nullptr, nullptr };
+	llvm::Value* _result = nullptr;
 
-	// Local variables and arguments stack
-	local_vars_stack _locals;
+	// Local variables and arguments indexed by their typed AST local index
+	//  Each value contains a POINTER to the variable instead of it's value
+	std::vector<value_and_cls> _locals;
 
-	// Dummy self node
-	const ast::identifier _ast_self = create_dummy_identifier("self");
-
-	// Pushes a new variable onto the variables stack
-	//  Memory is allocated at runtime for this variable
-	//  Returns the variable's POINTER value or null on error
-	llvm::Value* push_new_variable(const location& loc, std::string id, cool_class* cls)
+	// Allocates memory at runtime for a new local variable
+	//  Returns the variable's POINTER value
+	llvm::Value* create_variable(unsigned local, symbol name, cool_class* cls)
 	{
-		// Check for "self" name
-		if (id == "self")
-		{
-			_log.error(loc, "illegal variable name 'self'");
-			return nullptr;
-		}
-
 		// Fetch init block
 		auto init_block = &_func->front();
 		assert(init_block->getName().equals("init"));
@@ -173,82 +187,64 @@ private:
 		_builder.SetInsertPoint(init_block);
 
 		value_and_cls pointer_value;
-		pointer_value.value = _builder.CreateAlloca(cls->llvm_type(), nullptr, id);
+		pointer_value.value = _builder.CreateAlloca(cls->llvm_type(), nullptr, name.str());
 		pointer_value.cls = cls;
 		_builder.SetInsertPoint(saved_block);
 
-		// Push variable onto stack
-		_locals.push(id, pointer_value);
+		set_local(local, pointer_value);
 		return pointer_value.value;
 	}
 
-	// Pops the most recent variables created by push_new_variable
-	void pop_new_variables(unsigned n = 1)
+	// Sets the pointer of a local variable
+	void set_local(unsigned local, value_and_cls info)
 	{
-#warning Handle refcounting (discarding objects)
-		// Pop variables gone out of scope
-		_locals.pop(n);
+		if (local >= _locals.size())
+			_locals.resize(local + 1);
+
+		_locals[local] = info;
 	}
 
-public:
-	// Initializes the expression code generator from a class and llvm function
-	expr_codegen(cool_program& program, cool_class* cls, llvm::Function* func, logger& log)
-		: _log(log),
-		  _program(program),
-		  _declaring_cls(cls),
-		  _func(func),
-		  _builder(program.module()->getContext())
+	// Loads the self object
+	llvm::Value* load_self()
 	{
-		// Cache common cool types
-		_builtin_int = program.lookup_class("Int");
-		_builtin_bool = program.lookup_class("Bool");
-		_builtin_string = program.lookup_class("String");
-
-		// Cache zero and the null object
-		_zero.value = _builder.getInt32(0);
-		_zero.cls = _builtin_int;
-
-		_null_object.cls = program.lookup_class("Object");
-		_null_object.value = llvm::Constant::getNullValue(_null_object.cls->llvm_type());
+		assert(!_locals.empty());
+		return _builder.CreateLoad(_locals[0].value);
 	}
 
-
-	// Initializes the expression code generator for the given method
-	expr_codegen(cool_program& program, cool_method* method, logger& log)
-		: expr_codegen(program, method->declaring_class(), method->llvm_func(), log)
+public:
+	// Initializes the expression code generator for an llvm function
+	expr_codegen(cool_program& program, llvm::Function* func)
+		: _program(program),
+		  _func(func),
+		  _builder(program.module()->getContext())
 	{
+		_builtin_string = program.lookup_class(string_symbol);
 	}
 
 	expr_codegen(const expr_codegen&) = delete;
 	expr_codegen& operator=(const expr_codegen&) = delete;
 
-	// Adds an argument to the list of local variables
+	// Adds the next argument to the list of local variables (starting with self)
 	//  info.value contains a POINTER to the argument (not the value itself)
-	bool add_argument(std::string name, value_and_cls info)
+	void add_argument(value_and_cls info)
 	{
-		// Fail if an argument with that name exists
-		if (_locals.get(name))
-			return false;
-
-		_locals.push(name, info);
-		return true;
+		_locals.push_back(info);
 	}
 
 	// Evaluates the given expression and returns the result
 	//  The expression is evaluated at the current insert point and
-	//   may have side effects. If the evaluation failes, an error is reported
-	//   and a "fake" value is returned (but it can still be used).
+	//   may have side effects.
 	//  Code is written to the "current" block. This is usually the block given
 	//   by the last call to evaluate(expr, block) but might be different if
 	//   more blocks are created by the expression itself (eg for conditionals).
-	value_and_cls evaluate(const ast::expr& expr)
+	llvm::Value* evaluate(const typed::expr& expr)
 	{
 		expr.accept(*this);
 		return _result;
 	}
 
 	// Evaluates an expression and writes the code starting at the end of the given block
-	value_and_cls evaluate(const ast::expr& expr, llvm::BasicBlock* block)
+	llvm::Value* evaluate(const typed::expr& expr, llvm::BasicBlock* block)
 	{
 		_builder.SetInsertPoint(block);
 		return evaluate(expr);
@@ -260,171 +256,61 @@ public:
 		return _builder.GetInsertBlock();
 	}
 
-	void visit(const ast::assign& expr) override
+	void visit(const typed::assign& expr) override
 	{
 #warning Handle refcounting
 		// Evaluate subexpr and assign to _result immediately
 		_result = evaluate(*expr.value);
 
-		// Do the assignment
-		if (expr.id == "self")
+		cool_attribute* attr = expr.target.attribute;
+		if (attr != nullptr)
 		{
-			_log.error(expr.loc, "cannot assign to self");
-			return;
+			// Store attribute
+			auto coerced = expr.value->type->upcast_to(_builder, _result, attr->type);
+			store_attribute(_builder, load_self(), attr, coerced);
+			count_attribute_use(_builder, attr);
 		}
-
-		auto local_info = _locals.get(expr.id);
-		if (local_info)
+		else
 		{
 			// Store into local variable / argument
-			auto coerced = _result.cls->upcast_to(_builder, _result.value, local_info->cls);
-			if (coerced == nullptr)
-			{
-				_log.error(expr.loc, boost::format("invalid conversion from '%s' to '%s'") %
-					_result.cls->name() % local_info->cls->name());
-			}
-			else
-			{
-				_builder.CreateStore(coerced, local_info->value);
-			}
-			return;
+			auto& local_info = _locals[expr.target.local];
+			auto coerced = expr.value->type->upcast_to(_builder, _result, local_info.cls);
+			_builder.CreateStore(coerced, local_info.value);
 		}
-
-		auto attr = _declaring_cls->lookup_attribute(expr.id);
-		if (attr != nullptr)
-		{
-			// Store attribute
-			auto coerced = _result.cls->upcast_to(_builder, _result.value, attr->type);
-			if (coerced == nullptr)
-			{
-				_log.error(expr.loc, boost::format("invalid conversion from '%s' to '%s'") %
-					_result.cls->name() % attr->type->name());
-			}
-			else
-			{
-				store_attribute(_builder, evaluate(_ast_self).value, attr, coerced);
-			}
-			return;
-		}
-
-		_log.error(expr.loc, "variable not defined '" + expr.id + "'");
 	}
 
-	void visit(const ast::dispatch& expr) override
+	void visit(const typed::dispatch& expr) override
 	{
 		// Evaluate all expressions which are part of the dispatch
-		value_and_cls object;
-		std::vector<value_and_cls> args;
-
-		if (expr.object)
-			object = evaluate(*expr.object);
-		else
-			object = evaluate(_ast_self);
-
+		llvm::Value* object = evaluate(*expr.object);
+		std::vector<llvm::Value*> args;
 		for (auto& arg_ptr : expr.arguments)
 			args.push_back(evaluate(*arg_ptr));
 
-		// Get class to dispatch against
-		cool_class* cls = object.cls;
-		bool force_static = false;
-		if (expr.object_type)
-		{
-			force_static = true;
-			cls = _program.lookup_class(*expr.object_type);
-			if (cls == nullptr)
-			{
-				_log.error(expr.loc, "class not defined '" + *expr.object_type + "'");
-				_result = _zero;
-				return;
-			}
-
-			if (!object.cls->is_subclass_of(cls))
-			{
-				_log.error(expr.loc, "'" + object.cls->name() + "' to the left of the dispatch is not a subclass of '@" + cls->name() + "'");
-				_result = _zero;
-				return;
-			}
-		}
-
-		// Find method
-		cool_method* to_call = cls->lookup_method(expr.method_name, true);
-		if (to_call == nullptr)
-		{
-			_log.error(expr.loc, "method '" + expr.method_name + "' not defined for class '" + cls->name() + "'");
-			_result = _zero;
-			return;
-		}
-
-		// Check number of args
-		std::vector<cool_class*>& parameter_types = to_call->slot()->parameter_types;
-		if (args.size() != parameter_types.size())
-		{
-			_log.error(expr.loc, boost::format("wrong number of arguments for method '%s.%s' (expected %u, got %u)") %
-				cls->name() % to_call->slot()->name % parameter_types.size() % args.size());
-			_result = _zero;
-			return;
-		}
-
 		// Coerce all the objects to the right types
+		const cool_method_slot* slot = expr.method->slot();
 		std::vector<llvm::Value*> func_args;
-		llvm::Value* coerced;
+		auto coerced = expr.object->type->upcast_to(_builder, object, slot->declaring_class);
 
-		coerced = object.cls->upcast_to(_builder, object.value, to_call->slot()->declaring_class);
-		if (coerced == nullptr)
-		{
-			_log.error(expr.loc, boost::format("invalid conversion from '%s' to '%s'") %
-				object.cls->name() % cls->name());
-		}
-		else
-		{
-			// Verify object is not null
-			object.cls->ensure_not_null(_builder, object.value);
-			func_args.push_back(coerced);
-		}
+		// Verify object is not null
+		expr.object->type->ensure_not_null(_builder, object);
+		func_args.push_back(coerced);
 
-		for (auto arg_zip : boost::combine(args, parameter_types))
+		for (size_t i = 0; i < args.size(); i++)
 		{
-			value_and_cls& arg = arg_zip.get<0>();
-			cool_class* param_type = arg_zip.get<1>();
-			coerced = arg.cls->upcast_to(_builder, arg.value, param_type);
-
-			if (coerced == nullptr)
-			{
-				_log.error(expr.loc, boost::format("invalid conversion from '%s' to '%s'") %
-					arg.cls->name() % param_type->name());
-			}
-			else
-			{
-				func_args.push_back(coerced);
-			}
+			func_args.push_back(expr.arguments[i]->type->upcast_to(
+				_builder, args[i], slot->parameter_types[i]));
 		}
 
 		// Do the function call
-		if (args.size() == parameter_types.size())
-		{
-			_result.value = to_call->call(_builder, func_args, force_static);
-			_result.cls = to_call->slot()->return_type;
-		}
-		else
-		{
-			_result = _zero;
-		}
+		_result = expr.method->call(_builder, func_args, expr.static_call);
 	}
 
-	void visit(const ast::conditional& expr) override
+	void visit(const typed::conditional& expr) override
 	{
 		// Evaluate predicate
 		auto predicate = evaluate(*expr.predicate);
 
-		if (predicate.cls != _builtin_bool)
-		{
-			_log.error(expr.loc, "conditional predicate must be a Bool");
-
-			// Fake a boolean expression so we can continue to check for errors
-			predicate.value = _builder.getFalse();
-			predicate.cls = _builtin_bool;
-		}
-
 		// Create 3 more blocks for each part
 		llvm::LLVMContext& context = _program.module()->getContext();
 		auto block_true = llvm::BasicBlock::Create(context, "if_true", _func);
@@ -432,7 +318,7 @@ public:
 		auto block_done = llvm::BasicBlock::Create(context, "if_done", _func);
 
 		// Insert the conditional jump
-		_builder.CreateCondBr(predicate.value, block_true, block_false);
+		_builder.CreateCondBr(predicate, block_true, block_false);
 
 		// Evaluate both sides + record the final blocks
 		auto result_true = evaluate(*expr.if_true, block_true);
@@ -442,25 +328,23 @@ public:
 
 		// After evaluation, we need to coerce both results into the type
 		//  common to both, then jump to the done block
-		auto common_type = cool_class::common_ancestor(result_true.cls, result_false.cls);
 		_builder.SetInsertPoint(block_true);
-		auto value_true = result_true.cls->upcast_to(_builder, result_true.value, common_type);
+		auto value_true = expr.if_true->type->upcast_to(_builder, result_true, expr.type);
 		_builder.CreateBr(block_done);
 
 		_builder.SetInsertPoint(block_false);
-		auto value_false = result_false.cls->upcast_to(_builder, result_false.value, common_type);
+		auto value_false = expr.if_false->type->upcast_to(_builder, result_false, expr.type);
 		_builder.CreateBr(block_done);
 
 		// Create the final phi node in the done block
 		_builder.SetInsertPoint(block_done);
-		auto phi = _builder.CreatePHI(common_type->llvm_type(), 2);
+		auto phi = _builder.CreatePHI(expr.type->llvm_type(), 2);
 		phi->addIncoming(value_true, block_true);
 		phi->addIncoming(value_false, block_false);
-		_result.value = phi;
-		_result.cls = common_type;
+		_result = phi;
 	}
 
-	void visit(const ast::loop& expr) override
+	void visit(const typed::loop& expr) override
 	{
 		// Create blocks for the predicate, loop body, and done block
 		llvm::LLVMContext& context = _program.module()->getContext();
@@ -474,16 +358,7 @@ public:
 		// Generate predicate code
 		_builder.SetInsertPoint(block_predicate);
 		auto value_predicate = evaluate(*expr.predicate);
-		if (value_predicate.cls != _builtin_bool)
-		{
-			_log.error(expr.loc, "loop predicate must be a Bool");
-
-			// Fake a boolean expression so we can continue to check for errors
-			value_predicate.value = _builder.getFalse();
-			value_predicate.cls = _builtin_bool;
-		}
-
-		_builder.CreateCondBr(value_predicate.value, block_body, block_done);
+		_builder.CreateCondBr(value_predicate, block_body, block_done);
 
 		// Generate body code
 #warning Handle refcounting (discarding objects)
@@ -492,10 +367,10 @@ public:
 
 		// Result of a loop is always a void Object
 		_builder.SetInsertPoint(block_done);
-		_result = _null_object;
+		_result = llvm::Constant::getNullValue(expr.type->llvm_type());
 	}
 
-	void visit(const ast::block& expr) override
+	void visit(const typed::block& expr) override
 	{
 #warning Handle refcounting (discarding objects)
 		// Evaluate each expression in sucession, keeping only the last result
@@ -504,65 +379,34 @@ public:
 			_result = evaluate(*expr_ptr);
 	}
 
-	void visit(const ast::let& expr) override
+	void visit(const typed::let& expr) override
 	{
-		// Fetch init block
-		auto init_block = &_func->front();
-		assert(init_block->getName().equals("init"));
-
-		for (const ast::attribute& var : expr.vars)
+		for (const typed::let_var& var : expr.vars)
 		{
-			// Evaluate initializer (if there is one)
-			value_and_cls initializer;
+			// Evaluate initializer (or use the default value)
+			llvm::Value* initializer;
 			if (var.initial)
-				initializer = evaluate(*var.initial);
-
-			// Lookup class
-			cool_class* cls = _program.lookup_class(var.type);
-			if (cls == nullptr)
-			{
-				_log.error(var.loc, "class not defined '" + var.type + "'");
-				continue;
-			}
-
-			// Generate default initializer if there isn't one
-			if (!var.initial)
 			{
-				initializer.value = default_initializer(_builder, cls);
+				initializer = evaluate(*var.initial);
+				initializer = var.initial->type->upcast_to(_builder, initializer, var.type);
 			}
 			else
 			{
-				// Coerce type so it can be stored
-				initializer.value = initializer.cls->upcast_to(_builder, initializer.value, cls);
-				if (initializer.value == nullptr)
-				{
-					_log.error(expr.loc, boost::format("invalid conversion from '%s' to '%s'") %
-						initializer.cls->name() % cls->name());
-				}
+				initializer = var.type->default_value(_builder);
 			}
 
-			// Push new variable onto the stack and initialize it
-			llvm::Value* var_ptr = push_new_variable(var.loc, var.name, cls);
-			if (var_ptr != nullptr)
-				_builder.CreateStore(initializer.value, var_ptr);
+			// Create the new variable and initialize it
+			llvm::Value* var_ptr = create_variable(var.local, var.name, var.type);
+			_builder.CreateStore(initializer, var_ptr);
 		}
 
 		// Evaluate body
 		_result = evaluate(*expr.body);
-
-		// Pop variables gone out of scope
-		pop_new_variables(expr.vars.size());
 	}
 
 	// Internal data used to construct case expressions
 	struct case_data
 	{
-		// Branch type
-		cool_class* cls;
-
-		// Branch AST data
-		const ast::type_case_branch* branch;
-
 		// The test block assigned to the branch
 		llvm::BasicBlock* test_block;
 
@@ -572,54 +416,14 @@ public:
 		llvm::BasicBlock* value_block_exit;
 
 		// The result of the branch before upcasting
-		value_and_cls result;
+		llvm::Value* result;
 	};
 
-	void visit(const ast::type_case& expr) override
+	void visit(const typed::type_case& expr) override
 	{
 		auto value = evaluate(*expr.value);
-
-		// Resolve class names of all case branches
-		std::unordered_map<cool_class*, size_t> cls_map;
-		std::vector<case_data> sorted_branches;
-
-		for (auto& branch : expr.branches)
-		{
-			auto cls = _program.lookup_class(branch.type);
-			if (cls == nullptr)
-				_log.error(expr.loc, "class not defined '" + branch.type + "'");
-			else if(!cls_map.insert({cls, sorted_branches.size()}).second)
-				_log.error(expr.loc, "class occurs twice in case expression '" + branch.type + "'");
-			else
-				sorted_branches.push_back({cls, &branch, nullptr, nullptr, { nullptr, nullptr }});
-		}
-
-		// Bail out if there are no branches
-		if (sorted_branches.empty())
-		{
-			if (expr.branches.empty())
-				_log.error(expr.loc, "case expression with no branches");
-
-			_result = _null_object;
-			return;
-		}
-
-		// Sort case branches so parent classes are below child classes
-		std::sort(sorted_branches.begin(), sorted_branches.end(),
-			[&cls_map](const case_data& a, const case_data& b) -> bool {
-				// Handle equal classes
-				if (a.cls == b.cls)
-					return false;
-
-				// More derived classes come first
-				if (a.cls->is_subclass_of(b.cls))
-					return true;
-				else if (b.cls->is_subclass_of(a.cls))
-					return false;
-
-				// Incomparable classes are ordered by index in the class map
-				return cls_map.at(a.cls) < cls_map.at(b.cls);
-			});
+		cool_class* value_cls = expr.value->type;
+		std::vector<case_data> branches(expr.branches.size());
 
 		/*
 		 * LLVM case code structure
@@ -657,33 +461,31 @@ public:
 		 *  = Outgoing active block
 		 */
 
-		bool has_default_branch = false;
 		auto& context = _program.module()->getContext();
-		auto func_instance_of = _program.module()->getFunction("instance_of");
 
 		// Initial block
-		value.cls->ensure_not_null(_builder, value.value);
-		sorted_branches[0].test_block = llvm::BasicBlock::Create(context, "case_test", _func);
-		_builder.CreateBr(sorted_branches[0].test_block);
+		value_cls->ensure_not_null(_builder, value);
+		branches[0].test_block = llvm::BasicBlock::Create(context, "case_test", _func);
+		_builder.CreateBr(branches[0].test_block);
 
 		// Create failing and phi blocks
 		auto fail_block = llvm::BasicBlock::Create(context, "case_fail", _func);
 		auto phi_block = llvm::BasicBlock::Create(context, "case_phi", _func);
-		cool_class* final_upcast_cls = nullptr;
 
-		for (size_t i = 0; i < sorted_branches.size(); i++)
+		for (size_t i = 0; i < branches.size(); i++)
 		{
-			auto& branch_data = sorted_branches[i];
+			const typed::type_case_branch& branch = expr.branches[i];
+			auto& branch_data = branches[i];
 
 			// Create our value block + next test block
 			llvm::BasicBlock* test_block = branch_data.test_block;
 			llvm::BasicBlock* value_block_enter = llvm::BasicBlock::Create(context, "case_value", _func);
 			llvm::BasicBlock* next_test_block;
 
-			if (i + 1 < sorted_branches.size())
+			if (i + 1 < branches.size())
 			{
 				next_test_block = llvm::BasicBlock::Create(context, "case_test", _func);
-				sorted_branches[i + 1].test_block = next_test_block;
+				branches[i + 1].test_block = next_test_block;
 			}
 			else
 			{
@@ -692,62 +494,49 @@ public:
 
 			_builder.SetInsertPoint(test_block);
 
-			// Check if this test is always true or false
-			if (value.cls->is_subclass_of(branch_data.cls) && !has_default_branch)
+			switch (branch.test)
 			{
-				// Branch is always true
-				_builder.CreateBr(value_block_enter);
-			}
-			else if (!branch_data.cls->is_subclass_of(value.cls) || has_default_branch)
-			{
-				// Branch is always false / second default branch
-				_log.warning(expr.loc, "unreachable case branch for type '" + branch_data.cls->name() + "'");
-				_builder.CreateBr(next_test_block);
-			}
-			else
-			{
-				// Normal branch
-				auto call_inst = _builder.CreateCall(func_instance_of, {
-					value.cls->upcast_to_object(_builder, value.value),
-					branch_data.cls->llvm_object_vtable()
-				});
-				_builder.CreateCondBr(call_inst, value_block_enter, next_test_block);
+				case typed::case_test::always:
+					_builder.CreateBr(value_block_enter);
+					break;
+
+				case typed::case_test::never:
+					_builder.CreateBr(next_test_block);
+					break;
+
+				case typed::case_test::instance_of:
+				{
+					auto call_inst = _program.call_global(_builder, "instance_of", {
+						value_cls->upcast_to_object(_builder, value),
+						branch.type->llvm_object_vtable()
+					});
+					_builder.CreateCondBr(call_inst, value_block_enter, next_test_block);
+					break;
+				}
 			}
 
 			// Create value block and jump to phi block
 			_builder.SetInsertPoint(value_block_enter);
-			llvm::Value* var_ptr = push_new_variable(expr.loc, branch_data.branch->id, branch_data.cls);
-			if (var_ptr != nullptr)
-			{
-				auto value_downcast = branch_data.cls->downcast(_builder, value.value);
-				_builder.CreateStore(value_downcast, var_ptr);
-			}
-
-			branch_data.result = evaluate(*branch_data.branch->body);
-			if (var_ptr != nullptr)
-				pop_new_variables();
+			llvm::Value* var_ptr = create_variable(branch.local, branch.name, branch.type);
+			auto value_downcast = branch.type->downcast(_builder, value);
+			_builder.CreateStore(value_downcast, var_ptr);
 
+			branch_data.result = evaluate(*branch.body);
 			branch_data.value_block_exit = _builder.GetInsertBlock();
 			_builder.CreateBr(phi_block);
-
-			// Update final upcast class
-			if (final_upcast_cls == nullptr)
-				final_upcast_cls = branch_data.result.cls;
-			else
-				final_upcast_cls = cool_class::common_ancestor(final_upcast_cls, branch_data.result.cls);
 		}
 
 		// Perform upcasts and create phi node
 		_builder.SetInsertPoint(phi_block);
-		auto phi = _builder.CreatePHI(final_upcast_cls->llvm_type(), sorted_branches.size());
+		auto phi = _builder.CreatePHI(expr.type->llvm_type(), branches.size());
 
-		for (size_t i = 0; i < sorted_branches.size(); i++)
+		for (size_t i = 0; i < branches.size(); i++)
 		{
-			auto& branch_data = sorted_branches[i];
+			auto& branch_data = branches[i];
 
 			_builder.SetInsertPoint(branch_data.value_block_exit);
-			auto result_upcast = branch_data.result.cls->upcast_to(
-					_builder, branch_data.result.value, final_upcast_cls);
+			auto result_upcast = expr.branches[i].body->type->upcast_to(
+					_builder, branch_data.result, expr.type);
 			phi->addIncoming(result_upcast, branch_data.value_block_exit);
 		}
 
@@ -757,130 +546,79 @@ public:
 		_builder.CreateUnreachable();
 
 		// Done!
-		_result.value = phi;
-		_result.cls = final_upcast_cls;
+		_result = phi;
 		_builder.SetInsertPoint(phi_block);
 	}
 
-	void visit(const ast::new_object& expr) override
+	void visit(const typed::new_object& expr) override
 	{
-		// Lookup class and create object of that type
-		cool_class* cls = _program.lookup_class(expr.type);
-		if (cls == nullptr)
-		{
-			_log.error(expr.loc, "class not defined '" + expr.type + "'");
-			_result = _null_object;
-		}
-		else
-		{
-			_result.value = cls->create_object(_builder);
-			_result.cls = cls;
-		}
+		_result = expr.type->create_object(_builder);
 	}
 
-	void visit(const ast::constant_bool& expr) override
+	void visit(const typed::constant_bool& expr) override
 	{
 		if (expr.value)
-			_result.value = _builder.getTrue();
+			_result = _builder.getTrue();
 		else
-			_result.value = _builder.getFalse();
-
-		_result.cls = _builtin_bool;
+			_result = _builder.getFalse();
 	}
 
-	void visit(const ast::constant_int& expr) override
+	void visit(const typed::constant_int& expr) override
 	{
-		_result.value = _builder.getInt32(expr.value);
-		_result.cls = _builtin_int;
+		_result = _builder.getInt32(expr.value);
 	}
 
-	void visit(const ast::constant_string& expr) override
+	void visit(const typed::constant_string& expr) override
 	{
 #warning Handle refcounting?
-		_result.value = _program.create_string_literal(expr.value);
-		_result.cls = _builtin_string;
+		_result = _program.create_string_literal(expr.value.str());
 	}
 
-	void visit(const ast::identifier& expr) override
+	void visit(const typed::identifier& expr) override
 	{
 #warning Handle refcounting?
-
-		auto local_info = _locals.get(expr.id);
-		if (local_info)
+		if (expr.var.attribute != nullptr)
 		{
-			// Load local variable / argument
-			_result.value = _builder.CreateLoad(local_info->value);
-			_result.cls = local_info->cls;
-			return;
+			// Load attribute
+			_result = load_attribute(_builder, load_self(), expr.var.attribute);
+			count_attribute_use(_builder, expr.var.attribute);
 		}
-
-		auto attr = _declaring_cls->lookup_attribute(expr.id);
-		if (attr != nullptr)
+		else
 		{
-			// Load attribute
-			_result.value = load_attribute(_builder, evaluate(_ast_self).value, attr);
-			_result.cls = attr->type;
-			return;
+			// Load local variable / argument
+			_result = _builder.CreateLoad(_locals[expr.var.local].value);
 		}
-
-		// Identifier not found!
-		_log.error(expr.loc, "variable not defined '" + expr.id + "'");
-		_result = _zero;
 	}
 
-	void visit(const ast::compute_unary& expr) override
+	void visit(const typed::compute_unary& expr) override
 	{
-		llvm::PointerType* subexpr_ptr_type;
 		auto subexpr = evaluate(*expr.body);
 
 		switch (expr.op)
 		{
 			case ast::compute_unary_type::isvoid:
 				// Don't bother with anything for ints / bools
-				subexpr_ptr_type = llvm::dyn_cast<llvm::PointerType>(subexpr.value->getType());
-				if (subexpr_ptr_type == nullptr)
-				{
-					_log.warning(expr.loc, "isvoid on Int or Bool is always false");
-					_result.value = _builder.getFalse();
-				}
-				else
+				if (auto subexpr_ptr_type = llvm::dyn_cast<llvm::PointerType>(subexpr->getType()))
 				{
 #warning Handle refcounting?
 					// Test for null
 					auto const_null = llvm::ConstantPointerNull::get(subexpr_ptr_type);
-					_result.value = _builder.CreateICmpEQ(subexpr.value, const_null);
+					_result = _builder.CreateICmpEQ(subexpr, const_null);
+				}
+				else
+				{
+					_result = _builder.getFalse();
 				}
-
-				_result.cls = _builtin_bool;
 				break;
 
 			case ast::compute_unary_type::negate:
 				// Integer negation
-				if (subexpr.cls != _builtin_int)
-				{
-					_log.error(expr.loc, "input to ~ operator must be an Int");
-					_result = _zero;
-				}
-				else
-				{
-					_result.value = _builder.CreateNeg(subexpr.value);
-					_result.cls = _builtin_int;
-				}
+				_result = _builder.CreateNeg(subexpr);
 				break;
 
 			case ast::compute_unary_type::logical_not:
 				// Boolean complement
-				if (subexpr.cls != _builtin_bool)
-				{
-					_log.error(expr.loc, "input to 'not' operator must be a Bool");
-					_result.value = _builder.getFalse();
-				}
-				else
-				{
-					_result.value = _builder.CreateNot(subexpr.value);
-				}
-
-				_result.cls = _builtin_bool;
+				_result = _builder.CreateNot(subexpr);
 				break;
 
 			default:
@@ -888,103 +626,70 @@ public:
 		}
 	}
 
-	void visit(const ast::compute_binary& expr) override
+	void visit(const typed::compute_binary& expr) override
 	{
 		auto left = evaluate(*expr.left);
 		auto right = evaluate(*expr.right);
+		cool_class* left_cls = expr.left->type;
+		cool_class* right_cls = expr.right->type;
 
-		// Equality is special as it accepts many different types
-		if (expr.op == ast::compute_binary_type::equal)
+		switch (expr.op)
 		{
-			_result.cls = _builtin_bool;
+			case ast::compute_binary_type::add:
+				_result = _builder.CreateAdd(left, right);
+				break;
 
-			if ((left.cls == _builtin_bool) != (right.cls == _builtin_bool)
-				|| (left.cls == _builtin_int) != (right.cls == _builtin_int)
-				|| (left.cls == _builtin_string) != (right.cls == _builtin_string))
-			{
-				_log.error(expr.loc, "basic types can only be compared with themselves");
-				_result.value = _builder.getFalse();
-			}
-			else if (left.cls == _builtin_string)
-			{
-				// String equality
-				_result.value = _program.call_global(_builder, "String$equals", { left.value, right.value });
-			}
-			else if(left.cls->is_subclass_of(right.cls) || right.cls->is_subclass_of(left.cls))
-			{
-				// Upcast one side to the other
-				if (left.cls->is_subclass_of(right.cls))
-					left.value = left.cls->upcast_to(_builder, left.value, right.cls);
-				else
-					right.value = right.cls->upcast_to(_builder, right.value, left.cls);
+			case ast::compute_binary_type::subtract:
+				_result = _builder.CreateSub(left, right);
+				break;
 
-				// Eveyrthing else compares pointers / values for equality
-				_result.value = _builder.CreateICmpEQ(left.value, right.value);
-			}
-			else
-			{
-				// If the above condition failes, the types can never be equal
-				_log.warning(expr.loc, "result of comparison is always false");
-				_result.value = _builder.getFalse();
-			}
-		}
-		else if (expr.op == ast::compute_binary_type::add ||
-				expr.op == ast::compute_binary_type::subtract ||
-				expr.op == ast::compute_binary_type::multiply ||
-				expr.op == ast::compute_binary_type::divide)
-		{
-			// Arithmetic expression - only accepts ints, result is always int
-			_result = _zero;
-			if (left.cls != _builtin_int || right.cls != _builtin_int)
-			{
-				_log.error(expr.loc, "both inputs to an arithmetic expression must be Ints");
-			}
-			else
-			{
-				switch (expr.op)
-				{
-					case ast::compute_binary_type::add:
-						_result.value = _builder.CreateAdd(left.value, right.value);
-						break;
+			case ast::compute_binary_type::multiply:
+				_result = _builder.CreateMul(left, right);
+				break;
 
-					case ast::compute_binary_type::subtract:
-						_result.value = _builder.CreateSub(left.value, right.value);
-						break;
+			case ast::compute_binary_type::divide:
+				// Check for division by zero
+				_program.call_global(_builder, "zero_division_check", { right });
 
-					case ast::compute_binary_type::multiply:
-						_result.value = _builder.CreateMul(left.value, right.value);
-						break;
+				// Do the division
+				_result = _builder.CreateSDiv(left, right);
+				break;
 
-					case ast::compute_binary_type::divide:
-						// Check for division by zero
-						_program.call_global(_builder, "zero_division_check", { right.value });
+			case ast::compute_binary_type::less:
+				_result = _builder.CreateICmpSLT(left, right);
+				break;
 
-						// Do the division
-						_result.value = _builder.CreateSDiv(left.value, right.value);
-						break;
+			case ast::compute_binary_type::less_or_equal:
+				_result = _builder.CreateICmpSLE(left, right);
+				break;
 
-					default:
-						assert(0);
+			case ast::compute_binary_type::equal:
+				// The type checker ensures basic types are only compared with themselves
+				if (left_cls == _builtin_string)
+				{
+					// String equality
+					_result = _program.call_global(_builder, "String$equals", { left, right });
 				}
-			}
-		}
-		else
-		{
-			// Comparison expression - only accepts ints, result is always bool
-			_result.cls = _builtin_bool;
-			if (left.cls != _builtin_int || right.cls != _builtin_int)
-			{
-				_log.error(expr.loc, "both inputs to a comparison expression must be Ints");
-				_result.value = _builder.getFalse();
-			}
-			else if (expr.op == ast::compute_binary_type::less)
-			{
-				_result.value = _builder.CreateICmpSLT(left.value, right.value);
-			}
-			else
-			{
-				_result.value = _builder.CreateICmpSLE(left.value, right.value);
-			}
+				else if (left_cls->is_subclass_of(right_cls) || right_cls->is_subclass_of(left_cls))
+				{
+					// Upcast one side to the other
+					if (left_cls->is_subclass_of(right_cls))
+						left = left_cls->upcast_to(_builder, left, right_cls);
+					else
+						right = right_cls->upcast_to(_builder, right, left_cls);
+
+					// Eveyrthing else compares pointers / values for equality
+					_result = _builder.CreateICmpEQ(left, right);
+				}
+				else
+				{
+					// The types can never be equal
+					_result = _builder.getFalse();
+				}
+				break;
+
+			default:
+				assert(0);
 		}
 	}
 };
@@ -1005,7 +710,7 @@ void gen_copy_constructor(cool_program& output, cool_class* cls)
 
 	// Get this and other pointers
 	llvm::Value* pthis_obj = &func->getArgumentList().front();
-	llvm::Value* other_obj = &*(func->getArgumentList().begin()++);
+	llvm::Value* other_obj = &*std::next(func->getArgumentList().begin());
 	llvm::Value* pthis = cls->downcast(builder, pthis_obj);
 	llvm::Value* other = cls->downcast(builder, other_obj);
 
@@ -1017,11 +722,42 @@ void gen_copy_constructor(cool_program& output, cool_class* cls)
 	// Copy each attribute
 	for (cool_attribute* attr : cls->attributes())
 	{
+		if (attr->cold)
+			continue;
+
 		auto value = load_attribute(builder, other, attr);
 		attr->type->refcount_inc(builder, value);
 		store_attribute(builder, pthis, attr, value);
 	}
 
+	// Copy the side object (if the other object has allocated one)
+	if (cls->cold_struct_index() != 0)
+	{
+		auto copy_block = llvm::BasicBlock::Create(context, "copy_cold", func);
+		auto done_block = llvm::BasicBlock::Create(context, "", func);
+
+		llvm::Value* this_ptr = get_slot_pointer(builder, pthis, cls->cold_struct_index());
+		llvm::Value* other_cold = builder.CreateLoad(get_slot_pointer(builder, other, cls->cold_struct_index()));
+		builder.CreateStore(llvm::Constant::getNullValue(other_cold->getType()), this_ptr);
+		builder.CreateCondBr(builder.CreateIsNull(other_cold), done_block, copy_block);
+
+		builder.SetInsertPoint(copy_block);
+		llvm::Value* this_cold = alloc_cold_object(builder, module, cls);
+		for (cool_attribute* attr : cls->attributes())
+		{
+			if (!attr->cold)
+				continue;
+
+			auto value = load_slot(builder, get_slot_pointer(builder, other_cold, attr->struct_index), attr);
+			attr->type->refcount_inc(builder, value);
+			store_slot(builder, get_slot_pointer(builder, this_cold, attr->struct_index), attr, value);
+		}
+
+		builder.CreateStore(this_cold, this_ptr);
+		builder.CreateBr(done_block);
+		builder.SetInsertPoint(done_block);
+	}
+
 	builder.CreateRetVoid();
 }
 
@@ -1045,7 +781,31 @@ void gen_destructor(cool_program& output, cool_class* cls)
 
 	// Destroy each attribute
 	for (cool_attribute* attr : cls->attributes())
-		attr->type->refcount_dec(builder, load_attribute(builder, to_destroy, attr));
+	{
+		if (!attr->cold)
+			attr->type->refcount_dec(builder, load_attribute(builder, to_destroy, attr));
+	}
+
+	// Destroy the side object (if it was ever allocated)
+	if (cls->cold_struct_index() != 0)
+	{
+		auto destroy_block = llvm::BasicBlock::Create(context, "destroy_cold", func);
+		auto done_block = llvm::BasicBlock::Create(context, "", func);
+
+		llvm::Value* cold = builder.CreateLoad(get_slot_pointer(builder, to_destroy, cls->cold_struct_index()));
+		builder.CreateCondBr(builder.CreateIsNull(cold), done_block, destroy_block);
+
+		builder.SetInsertPoint(destroy_block);
+		for (cool_attribute* attr : cls->attributes())
+		{
+			if (attr->cold)
+				attr->type->refcount_dec(builder, load_slot(builder, get_slot_pointer(builder, cold, attr->struct_index), attr));
+		}
+
+		output.call_global(builder, "free", { builder.CreateBitCast(cold, builder.getInt8PtrTy()) });
+		builder.CreateBr(done_block);
+		builder.SetInsertPoint(done_block);
+	}
 
 	// Call parent destructor
 	llvm::Function* parent_func = cls->parent()->destructor();
@@ -1055,13 +815,51 @@ void gen_destructor(cool_program& output, cool_class* cls)
 	builder.CreateRetVoid();
 }
 
+// Generates the function which returns a class's side object, allocating it
+//  (with all its attributes default initialized) if it does not exist yet
+void gen_cold_accessor(cool_program& output, cool_class* cls)
+{
+	llvm::Module* module = output.module();
+	llvm::LLVMContext& context = module->getContext();
+
+	// Get llvm function
+	llvm::Function* func = cls->cold_accessor();
+	assert(func->empty());
+
+	auto entry_block = llvm::BasicBlock::Create(context, "", func);
+	auto exists_block = llvm::BasicBlock::Create(context, "exists", func);
+	auto alloc_block = llvm::BasicBlock::Create(context, "alloc", func);
+	llvm::IRBuilder<> builder(entry_block);
+
+	// Return the existing object if there is one
+	llvm::Value* ptr = get_slot_pointer(builder, &func->getArgumentList().front(), cls->cold_struct_index());
+	llvm::Value* existing = builder.CreateLoad(ptr);
+	builder.CreateCondBr(builder.CreateIsNull(existing), alloc_block, exists_block);
+
+	builder.SetInsertPoint(exists_block);
+	builder.CreateRet(existing);
+
+	// Otherwise allocate a new one
+	builder.SetInsertPoint(alloc_block);
+	llvm::Value* cold = alloc_cold_object(builder, module, cls);
+	for (cool_attribute* attr : cls->attributes())
+	{
+		if (attr->cold)
+			store_slot(builder, get_slot_pointer(builder, cold, attr->struct_index), attr, attr->type->default_value(builder));
+	}
+
+	builder.CreateStore(cold, ptr);
+	builder.CreateRet(cold);
+}
+
 // Generates a class's constructor
-void gen_constructor(const ast::cls& input, cool_program& output, cool_class* cls, logger& log)
+void gen_constructor(const typed::cls& input, cool_program& output)
 {
 #warning Remove code duplication between gen_constructor and gen_method
 	// Create a code generator
+	cool_class* cls = input.cls;
 	llvm::Function* func = cls->constructor();
-	expr_codegen the_generator(output, cls, func, log);
+	expr_codegen the_generator(output, func);
 
 	// Create the init and user blocks
 	llvm::LLVMContext& context = output.module()->getContext();
@@ -1073,7 +871,7 @@ void gen_constructor(const ast::cls& input, cool_program& output, cool_class* cl
 	llvm::Value* self_ptr = builder.CreateAlloca(cls->llvm_type());
 	llvm::Value* self = builder.CreateBitCast(&func->getArgumentList().front(), cls->llvm_type());
 	builder.CreateStore(self, self_ptr);
-	the_generator.add_argument("self", { self_ptr, cls });
+	the_generator.add_argument({ self_ptr, cls });
 
 	// Call parent constructor
 	llvm::Value* raw_object = &func->getArgumentList().front();
@@ -1082,32 +880,29 @@ void gen_constructor(const ast::cls& input, cool_program& output, cool_class* cl
 	call_inst->setCallingConv(llvm::CallingConv::Fast);
 
 	// Default initialize all attributes
+	//  The side object is only allocated when a cold attribute is first used
 	for (auto attr : cls->attributes())
-		store_attribute(builder, self, attr, default_initializer(builder, attr->type));
+	{
+		if (!attr->cold)
+			store_attribute(builder, self, attr, attr->type->default_value(builder));
+	}
+
+	if (cls->cold_struct_index() != 0)
+	{
+		llvm::Value* cold_ptr = get_slot_pointer(builder, self, cls->cold_struct_index());
+		builder.CreateStore(llvm::Constant::getNullValue(cold_struct_type(cls)->getPointerTo()), cold_ptr);
+	}
 
-	// Call each attribute's initializer (if it exists)
+	// Call each attribute's initializer
 #warning refcounting?
-	for (auto& ast_attr : input.attributes)
+	for (auto& init : input.initializers)
 	{
-		if (ast_attr.initial)
-		{
-			auto result = the_generator.evaluate(*ast_attr.initial, builder.GetInsertBlock());
-			builder.SetInsertPoint(the_generator.get_insert_block());
+		auto result = the_generator.evaluate(*init.initial, builder.GetInsertBlock());
+		builder.SetInsertPoint(the_generator.get_insert_block());
 
-			// Coerce result to attribute's type
-			auto attr = cls->lookup_attribute(ast_attr.name);
-			auto upcasted = result.cls->upcast_to(builder, result.value, attr->type);
-			if (upcasted == nullptr)
-			{
-				log.error(ast_attr.loc, boost::format("invalid conversion from '%s' to '%s'") %
-					result.cls->name() % attr->type->name());
-			}
-			else
-			{
-				// Store result
-				store_attribute(builder, self, attr, upcasted);
-			}
-		}
+		// Coerce result to attribute's type and store it
+		auto upcasted = init.initial->type->upcast_to(builder, result, init.attribute->type);
+		store_attribute(builder, self, init.attribute, upcasted);
 	}
 
 	// Do the final stitchup
@@ -1126,18 +921,18 @@ std::vector<llvm::Value*> get_func_arguments(llvm::Function* func)
 }
 
 // Generates code for the given method
-void gen_method(const ast::method& input, cool_program& output, cool_class* cls, logger& log)
+void gen_method(const typed::method& input, cool_program& output, cool_class* cls)
 {
-	// Lookup method
-	cool_method* method = cls->lookup_method(input.name);
-	assert(method != nullptr);
+	cool_method* method = input.method;
+	const cool_method_slot* slot = method->slot();
+	time_scope timer("codegen method", slot->name.str());
 
 	// Create a code generator
-	expr_codegen the_generator(output, method, log);
+	llvm::Function* func = method->llvm_func();
+	expr_codegen the_generator(output, func);
 
 	// Create the init block which will hold self, args and locals
 	llvm::LLVMContext& context = output.module()->getContext();
-	llvm::Function* func = method->llvm_func();
 	std::vector<llvm::Value*> func_args = get_func_arguments(func);
 
 	auto init_block = llvm::BasicBlock::Create(context, "init", func);
@@ -1149,36 +944,26 @@ void gen_method(const ast::method& input, cool_program& output, cool_class* cls,
 	llvm::Value* self_ptr = builder.CreateAlloca(cls->llvm_type());
 	llvm::Value* self = cls->downcast(builder, func_args[0]);
 	builder.CreateStore(self, self_ptr);
-	the_generator.add_argument("self", { self_ptr, cls });
+	the_generator.add_argument({ self_ptr, cls });
 
 	// Add all arguments
-	for (unsigned i = 0; i < input.params.size(); i++)
+	for (unsigned i = 0; i < slot->parameter_types.size(); i++)
 	{
-		cool_class* arg_cls = method->slot()->parameter_types[i];
+		cool_class* arg_cls = slot->parameter_types[i];
 		llvm::Value* arg_ptr = builder.CreateAlloca(arg_cls->llvm_type());
 		llvm::Value* arg = func_args[i + 1];
 		builder.CreateStore(arg, arg_ptr);
-		the_generator.add_argument(input.params[i].first, { arg_ptr, arg_cls });
+		the_generator.add_argument({ arg_ptr, arg_cls });
 	}
 
 	// Generate the main code body
 	auto user_block = llvm::BasicBlock::Create(context, "", func);
 	auto result = the_generator.evaluate(*input.body, user_block);
 
-	// Coerce the result to the correct return type
+	// Coerce the result to the correct return type and return it
 #warning Refcounting?
 	builder.SetInsertPoint(the_generator.get_insert_block());
-	auto upcasted = result.cls->upcast_to(builder, result.value, method->slot()->return_type);
-	if (upcasted == nullptr)
-	{
-		log.error(input.loc, boost::format("returning: invalid conversion from '%s' to '%s'") %
-			result.cls->name() % method->slot()->return_type->name());
-	}
-	else
-	{
-		// Do the final return
-		builder.CreateRet(upcasted);
-	}
+	builder.CreateRet(input.body->type->upcast_to(builder, result, slot->return_type));
 
 	// Finally, insert a branch from the init block to the first user block
 	builder.SetInsertPoint(init_block);
@@ -1186,24 +971,80 @@ void gen_method(const ast::method& input, cool_program& output, cool_class* cls,
 }
 
 // Generates the code for a given class
-void codegen_cls(const ast::cls& input, cool_program& output, logger& log)
+void codegen_cls(const typed::cls& input, cool_program& output)
 {
-	cool_class* cls = output.lookup_class(input.name);
-	assert(cls != nullptr);
+	cool_class* cls = input.cls;
+	time_scope timer("codegen class", cls->name().str());
 
 	// Generate simple functions (copy constructor + destructor)
 	gen_copy_constructor(output, cls);
 	gen_destructor(output, cls);
 
+	if (cls->cold_struct_index() != 0)
+		gen_cold_accessor(output, cls);
+
 	// Generate constructor
-	gen_constructor(input, output, cls, log);
+	gen_constructor(input, output);
 
 	// Generata all methods
 	for (auto& method : input.methods)
-		gen_method(method, output, cls, log);
+		gen_method(method, output, cls);
+}
+
+// Generates a call which writes the use counters of every attribute to the profile
+void gen_profile_write(cool_program& output, llvm::IRBuilder<>& builder)
+{
+	llvm::Module* module = output.module();
+
+	// Sort the counters by name so the profile is always written in the same order
+	std::vector<std::pair<std::string, llvm::GlobalVariable*>> counters;
+	for (cool_class* cls : output.classes())
+	{
+		for (cool_attribute* attr : cls->attributes())
+		{
+			if (attr->use_counter != nullptr)
+				counters.emplace_back(cls->name().str() + "." + attr->name.str(), attr->use_counter);
+		}
+	}
+
+	std::sort(counters.begin(), counters.end(), [](
+		const std::pair<std::string, llvm::GlobalVariable*>& a,
+		const std::pair<std::string, llvm::GlobalVariable*>& b)
+	{
+		return a.first < b.first;
+	});
+
+	// Create a table of (name, counter) pairs
+	llvm::StructType* entry_type = module->getTypeByName("profile_entry");
+	assert(entry_type != nullptr);
+
+	std::vector<llvm::Constant*> entries;
+	for (auto& counter : counters)
+	{
+		auto name = llvm::cast<llvm::Constant>(builder.CreateGlobalStringPtr(counter.first));
+		entries.push_back(llvm::ConstantStruct::get(entry_type, { name, counter.second }));
+	}
+
+	auto table_type = llvm::ArrayType::get(entry_type, entries.size());
+	auto table = new llvm::GlobalVariable(
+		*module,
+		table_type,
+		true,
+		llvm::GlobalVariable::PrivateLinkage,
+		llvm::ConstantArray::get(table_type, entries),
+		"profile_table");
+
+	llvm::Constant* zero = builder.getInt32(0);
+	llvm::Constant* indices[] = { zero, zero };
+	auto table_ptr = llvm::ConstantExpr::getInBoundsGetElementPtr(table_type, table, indices);
+
+	output.call_global(builder, "profile_write", {
+		builder.CreateGlobalStringPtr(output.profile_output()),
+		table_ptr,
+		builder.getInt32(entries.size()) });
 }
 
-void gen_main_func(cool_program& output, logger& log)
+void gen_main_func(const typed::program& input, cool_program& output)
 {
 	llvm::Module* module = output.module();
 	llvm::LLVMContext& context = output.module()->getContext();
@@ -1218,54 +1059,241 @@ void gen_main_func(cool_program& output, logger& log)
 
 	// Create main class
 	llvm::IRBuilder<> builder(block);
-	cool_class* main_cls = output.lookup_class("Main");
-	if (main_cls == nullptr)
+	cool_class* main_cls = input.main_class;
+	llvm::Value* main_obj = main_cls->create_object(builder);
+
+	// Call main function (possibly declared in a parent of Main)
+	cool_method* main_obj_func = input.main_method;
+	if (main_obj_func->declaring_class() != main_cls)
+		main_obj = main_cls->upcast_to(builder, main_obj, main_obj_func->declaring_class());
+
+	auto return_value = main_obj_func->call(builder, { main_obj }, true);
+
+	// Decrement refcounts
+	main_obj_func->slot()->return_type->refcount_dec(builder, return_value);
+	main_cls->refcount_dec(builder, main_obj);
+
+	// Write the attribute counts of instrumented programs
+	if (!output.profile_output().empty())
+		gen_profile_write(output, builder);
+
+	// Return
+	builder.CreateRet(builder.getInt32(0));
+}
+
+// Each shard costs a runtime load, a full layout and a trip through bitcode,
+//  so only split the program when there are enough functions to go round
+const size_t min_shard_functions = 256;
+
+// Returns the number of functions generated for a class
+size_t class_functions(const typed::cls& input)
+{
+	// Constructor, copy constructor and destructor + methods
+	return 3 + input.methods.size();
+}
+
+// Splits the classes of a program into (at most) the given number of shards
+//  with roughly the same number of functions in each
+std::vector<std::vector<size_t>> partition_classes(const typed::program& input, unsigned shards)
+{
+	size_t total_functions = 0;
+	for (auto& cls : input)
+		total_functions += class_functions(cls);
+
+	shards = std::min<size_t>(shards, total_functions / min_shard_functions);
+	if (shards <= 1)
+		return {};
+
+	// Give the biggest remaining class to the smallest shard
+	std::vector<size_t> order(input.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
 	{
-		log.error("'Main' class not defined");
-		return;
+		return class_functions(input[a]) > class_functions(input[b]);
+	});
+
+	std::vector<std::vector<size_t>> result(shards);
+	std::vector<size_t> shard_functions(shards);
+	for (size_t i : order)
+	{
+		size_t smallest = std::min_element(shard_functions.begin(), shard_functions.end()) - shard_functions.begin();
+		result[smallest].push_back(i);
+		shard_functions[smallest] += class_functions(input[i]);
 	}
 
-	llvm::Value* main_obj = main_cls->create_object(builder);
+	return result;
+}
 
-	// Call main function
-	cool_method* main_obj_func = main_cls->lookup_method("main", true);
-	if (main_obj_func == nullptr)
+// Prepares a shard module for linking into the output module
+//  Everything generated in the shard is exported. Everything else (the
+//  runtime and the vtables) becomes a declaration which is resolved against
+//  the output module's copy when linking.
+void export_shard(llvm::Module& module)
+{
+	for (llvm::Function& func : module)
 	{
-		log.error("method 'Main.main' not defined");
-		return;
+		if (func.hasInternalLinkage())
+			func.setLinkage(llvm::GlobalValue::ExternalLinkage);
+		else if (!func.isDeclaration())
+			func.deleteBody();
 	}
 
-	if (!main_obj_func->slot()->parameter_types.empty())
+	for (llvm::GlobalVariable& var : module.globals())
 	{
-		log.error("method 'Main.main' must have no parameters");
-		return;
+		if (!var.hasPrivateLinkage() && var.hasInitializer())
+		{
+			var.setInitializer(nullptr);
+			var.setLinkage(llvm::GlobalValue::ExternalLinkage);
+		}
 	}
 
-	// We can handle this case fine, so it's just a warning
-	if (main_obj_func->declaring_class() != main_cls)
+	// Drop the strings which were only used by the runtime and vtables
+	for (auto it = module.global_begin(); it != module.global_end(); )
 	{
-		log.warning("method 'Main.main' not declared in 'Main' class");
-		main_obj = main_cls->upcast_to(builder, main_obj, main_obj_func->declaring_class());
+		llvm::GlobalVariable& var = *it++;
+		var.removeDeadConstantUsers();
+		if (var.hasPrivateLinkage() && var.use_empty())
+			var.eraseFromParent();
 	}
+}
 
-	auto return_value = main_obj_func->call(builder, { main_obj }, true);
+// Generates code for a subset of the classes in a new LLVM context
+//  The result is written as bitcode which can be linked into the real output
+void codegen_shard(
+	const ast::program& input,
+	const cool_program& output,
+	const std::vector<size_t>& classes,
+	llvm::SmallVectorImpl<char>& bitcode)
+{
+	time_scope timer("codegen shard");
+
+	llvm::LLVMContext context;
+	cool_program shard(context);
+	shard.set_profile(output.profile());
+	shard.set_profile_output(output.profile_output());
+
+	// The layout (using the same attribute profile) and type checking have
+	//  already succeeded once for the real output, so this produces exactly
+	//  the same types, vtables, function names and typed ASTs (but pointing
+	//  into the shard's program)
+	logger_buffer shard_log;
+	layout(input, shard, shard_log);
+	assert(!shard_log.has_errors());
+
+	typed::program typed_shard;
+	for (size_t i : classes)
+		typecheck(input[i], shard, typed_shard, shard_log);
+	assert(!shard_log.has_errors());
+
+	for (auto& cls : typed_shard)
+		codegen_cls(cls, shard);
+
+	export_shard(*shard.module());
+	builtins_materialize(*shard.module());
+
+	llvm::raw_svector_ostream stream(bitcode);
+	llvm::WriteBitcodeToFile(shard.module(), stream);
+}
 
-	// Decrement refcounts
-	main_obj_func->slot()->return_type->refcount_dec(builder, return_value);
-	main_cls->refcount_dec(builder, main_obj);
+// Links the bitcode of some shards into the output program
+void link_shards(
+	const typed::program& input,
+	cool_program& output,
+	const std::vector<llvm::SmallString<0>>& shards,
+	logger& log)
+{
+	time_scope timer("link shards");
 
-	// Return
-	builder.CreateRet(builder.getInt32(0));
+	llvm::Module* module = output.module();
+
+	// Temporarily export all the internal symbols so they can be resolved
+	//  against the shards
+	std::vector<std::string> exported;
+	auto export_value = [&](llvm::GlobalValue& value)
+	{
+		if (value.hasInternalLinkage())
+		{
+			value.setLinkage(llvm::GlobalValue::ExternalLinkage);
+			exported.push_back(value.getName().str());
+		}
+	};
+
+	for (llvm::Function& func : *module)
+		export_value(func);
+	for (llvm::GlobalVariable& var : module->globals())
+		export_value(var);
+
+	// Linking replaces the stub of every generated function
+	std::vector<std::pair<cool_method*, std::string>> methods;
+	std::vector<std::pair<cool_class*, std::string>> accessors;
+	for (auto& cls : input)
+	{
+		for (cool_method* method : cls.cls->methods())
+			methods.emplace_back(method, method->llvm_func()->getName().str());
+
+		if (cls.cls->cold_accessor() != nullptr)
+			accessors.emplace_back(cls.cls, cls.cls->cold_accessor()->getName().str());
+	}
+
+	for (auto& bitcode : shards)
+	{
+		llvm::MemoryBufferRef buffer(bitcode.str(), module->getModuleIdentifier());
+		auto shard = llvm::parseBitcodeFile(buffer, module->getContext());
+		if (!shard || llvm::Linker::linkModules(*module, std::move(shard.get())))
+		{
+			log.error("error linking code generation shards");
+			return;
+		}
+	}
+
+	for (auto& name : exported)
+		module->getNamedValue(name)->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+	for (auto& method : methods)
+		method.first->set_llvm_func(module->getFunction(method.second));
+	for (auto& accessor : accessors)
+		accessor.first->set_cold_accessor(module->getFunction(accessor.second));
 }
 
 }
 
-void lcool::codegen(const ast::program& input, cool_program& output, logger& log)
+void lcool::codegen(
+	const ast::program& input,
+	const typed::program& typed_input,
+	cool_program& output,
+	logger& log,
+	unsigned jobs)
 {
-	// Generate code for every class
-	for (auto& cls : input)
-		codegen_cls(cls, output, log);
+	if (jobs == 0)
+		jobs = std::max(std::thread::hardware_concurrency(), 1u);
+
+	auto shards = partition_classes(typed_input, jobs);
+	if (shards.empty())
+	{
+		// Generate code for every class
+		for (auto& cls : typed_input)
+			codegen_cls(cls, output);
+
+		// Create main function
+		gen_main_func(typed_input, output);
+		builtins_materialize(*output.module());
+		return;
+	}
+
+	// The current thread generates the first shard
+	std::vector<llvm::SmallString<0>> bitcode(shards.size());
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < shards.size(); i++)
+		threads.emplace_back(codegen_shard, std::cref(input), std::cref(output), std::cref(shards[i]), std::ref(bitcode[i]));
+
+	codegen_shard(input, output, shards[0], bitcode[0]);
+	for (std::thread& thread : threads)
+		thread.join();
 
-	// Create main function
-	gen_main_func(output, log);
+	// Create main function (which calls the stubs until they are linked)
+	gen_main_func(typed_input, output);
+	link_shards(typed_input, output, bitcode, log);
+	builtins_materialize(*output.module());
 }
@@ -21,19 +21,36 @@
 #include "ast.hpp"
 #include "cool_program.hpp"
 #include "logger.hpp"
+#include "typed_ast.hpp"
 
 namespace lcool
 {
 	/**
 	 * Generates the LLVM code for all the classes in the input program
 	 *
-	 * Before calling this, all the classes must be created layed out first.
+	 * Before calling this, all the classes must be created layed out first
+	 * and then type checked without any errors (see typecheck).
 	 *
-	 * @param input program to read code from
+	 * Large programs are split into shards of classes which are generated
+	 * on separate threads (each with its own LLVM context) and then linked
+	 * into the output module. Afterwards, the output contains the same code
+	 * as if it had been generated on one thread.
+	 *
+	 * Finally, the runtime functions used by the program are read in and the
+	 * rest are removed (see builtins_materialize).
+	 *
+	 * @param input program the typed AST was checked from (used by the shards)
+	 * @param typed_input typed AST to read code from
 	 * @param output program to write code to
 	 * @param log logger to log errors to
+	 * @param jobs maximum number of threads to use (0 for one per CPU)
 	 */
-	void codegen(const ast::program& input, cool_program& output, logger& log);
+	void codegen(
+		const ast::program& input,
+		const typed::program& typed_input,
+		cool_program& output,
+		logger& log,
+		unsigned jobs = 1);
 }
 
 #endif
@@ -96,33 +96,61 @@ llvm::Value* lcool::cool_method::call(
 
 // ========= cool_class ==========================================
 
-lcool::cool_class::cool_class(const std::string& name, cool_class* parent)
+lcool::cool_class::cool_class(symbol name, cool_class* parent)
 	: _name(name), _parent(parent)
 {
-}
+	if (parent != nullptr)
+	{
+		_depth = parent->_depth + 1;
 
-bool lcool::cool_class::is_subclass_of(const cool_class* other) const
-{
-	return other == this ||
-	       (_parent != nullptr &&  _parent->is_subclass_of(other));
+		// Build the ancestor table from the parent's table
+		//  The (2 ^ n)th ancestor is the (2 ^ (n - 1))th ancestor of the
+		//  (2 ^ (n - 1))th ancestor
+		for (cool_class* ancestor = parent; ; )
+		{
+			_ancestors.push_back(ancestor);
+
+			size_t n = _ancestors.size() - 1;
+			if (n >= ancestor->_ancestors.size())
+				break;
+
+			ancestor = ancestor->_ancestors[n];
+		}
+	}
 }
 
 cool_class* lcool::cool_class::common_ancestor(cool_class* a, cool_class* b)
 {
-	for (;;)
+	// If b is a subclass of a, return it
+	if (b->is_subclass_of(a))
+		return a;
+
+	// Otherwise move a up as far as possible without reaching an ancestor
+	//  of b. Then a's parent is the common ancestor (eventually we get to
+	//  Object which b must be a subtype of).
+	for (size_t n = a->_ancestors.size(); n-- > 0; )
 	{
-		// We should never reach a stage where a is null. We should have got to
-		//  Object before that.
-		assert(a != nullptr);
+		if (n < a->_ancestors.size() && !b->is_subclass_of(a->_ancestors[n]))
+			a = a->_ancestors[n];
+	}
+
+	assert(a->_parent != nullptr);
+	return a->_parent;
+}
 
-		// If b is a subclass of a, return it
-		// Otherwise go to a's parent. Eventually we'll get to Object
-		//  which b must be a subtype of
-		if (b->is_subclass_of(a))
-			return a;
+const cool_class* lcool::cool_class::ancestor_at_depth(unsigned depth) const
+{
+	assert(depth <= _depth);
 
-		a = a->parent();
+	// Jump up by each power of two in the difference between the depths
+	const cool_class* result = this;
+	for (unsigned distance = _depth - depth, n = 0; distance != 0; distance >>= 1, n++)
+	{
+		if (distance & 1)
+			result = result->_ancestors[n];
 	}
+
+	return result;
 }
 
 bool lcool::cool_class::is_final() const
@@ -130,7 +158,7 @@ bool lcool::cool_class::is_final() const
 	return false;
 }
 
-cool_attribute* lcool::cool_class::lookup_attribute(const std::string& name)
+cool_attribute* lcool::cool_class::lookup_attribute(symbol name)
 {
 	auto iter = _attributes.find(name);
 	if (iter != _attributes.end())
@@ -139,41 +167,80 @@ cool_attribute* lcool::cool_class::lookup_attribute(const std::string& name)
 	return nullptr;
 }
 
-cool_method* lcool::cool_class::lookup_method(const std::string& name, bool recursive)
+cool_method* lcool::cool_class::lookup_method(symbol name, bool recursive)
 {
 	// Try this class first
 	auto iter = _methods.find(name);
 	if (iter != _methods.end())
 		return iter->second.get();
 
-	// Try subclasses
+	// The parent's method table contains all of its inherited methods
 	if (recursive && _parent != nullptr)
-		return _parent->lookup_method(name, true);
+	{
+		auto parent_iter = _parent->_method_lookup.find(name);
+		if (parent_iter != _parent->_method_lookup.end())
+			return parent_iter->second;
+	}
 
 	return nullptr;
 }
 
-std::vector<cool_attribute*> lcool::cool_class::attributes()
+cool_attribute* lcool::cool_class::insert_attribute(unique_ptr<cool_attribute> attribute)
 {
-	std::vector<cool_attribute*> result;
-	for (auto& pair : _attributes)
-		result.push_back(pair.second.get());
-	return result;
+	symbol name = attribute->name;
+	auto result = _attributes.emplace(name, std::move(attribute));
+	if (!result.second)
+		return nullptr;
+
+	_attribute_list.push_back(result.first->second.get());
+	return _attribute_list.back();
 }
 
-std::vector<cool_method*> lcool::cool_class::methods()
+cool_method* lcool::cool_class::insert_method(unique_ptr<cool_method> method)
 {
-	std::vector<cool_method*> result;
-	for (auto& pair : _methods)
-		result.push_back(pair.second.get());
-	return result;
+	symbol name = method->slot()->name;
+	auto result = _methods.emplace(name, std::move(method));
+	if (!result.second)
+		return nullptr;
+
+	_method_list.push_back(result.first->second.get());
+	return _method_list.back();
+}
+
+void lcool::cool_class::build_method_table()
+{
+	if (_parent != nullptr)
+	{
+		_method_table = _parent->_method_table;
+		_method_lookup = _parent->_method_lookup;
+	}
+
+	for (cool_method* method : _method_list)
+	{
+		cool_method_slot* slot = method->slot();
+
+		// New slots are added to the end of the table, overrides replace
+		//  the inherited method
+		if (slot->declaring_class == this)
+		{
+			slot->table_index = _method_table.size();
+			_method_table.push_back(method);
+		}
+		else
+		{
+			assert(_method_table[slot->table_index]->slot() == slot);
+			_method_table[slot->table_index] = method;
+		}
+
+		_method_lookup[slot->name] = method;
+	}
 }
 
-llvm::Constant* lcool::cool_class::llvm_object_vtable()
+llvm::Constant* lcool::cool_class::llvm_object_vtable() const
 {
 	// Bitcast vtable to %Object$vtabletype*
 	//  We can't use upcast_to due to Ints and Bools overriding it
-	auto vtable = llvm_vtable();
+	auto vtable = _vtable;
 	auto vtable_type = vtable->getParent()->getTypeByName("Object$vtabletype");
 	assert(vtable_type != nullptr);
 
@@ -183,42 +250,32 @@ llvm::Constant* lcool::cool_class::llvm_object_vtable()
 llvm::Value* lcool::cool_class::create_object(llvm::IRBuilder<>& builder) const
 {
 	// Invoke new_object on vtable pointer
-	auto value = call_global(builder, "new_object", { upcast_to_object(builder, _vtable) });
+	auto value = call_global(builder, "new_object", { llvm_object_vtable() });
 	return downcast(builder, value);
 }
 
+llvm::Value* lcool::cool_class::default_value(llvm::IRBuilder<>&) const
+{
+	return llvm::Constant::getNullValue(_llvm_type);
+}
+
 llvm::Value* lcool::cool_class::upcast_to(llvm::IRBuilder<>& builder, llvm::Value* value, const cool_class* to) const
 {
 	// Handle trivial case
 	if (to == this)
 		return value;
 
-	// We want to create a GEP with n zeros so that we get the correct struct type
-	int num_zeros = 1;
-	const cool_class* current = this;
-
-	while (current != to)
-	{
-		// If current is null, to is not a subclass of this class
-		if (current == nullptr)
-			return nullptr;
-
-		current = current->_parent;
-		num_zeros++;
-	}
+	if (to->_depth > _depth || ancestor_at_depth(to->_depth) != to)
+		return nullptr;
 
-	// Do the upcast
-	std::vector<llvm::Value*> gep_args(num_zeros, builder.getInt32(0));
-	return builder.CreateInBoundsGEP(value, gep_args);
+	// Every structure starts with the elements of its parent's structure, so
+	//  a bitcast is enough to upcast it
+	return builder.CreateBitCast(value, to->_llvm_type);
 }
 
 llvm::Value* lcool::cool_class::upcast_to_object(llvm::IRBuilder<>& builder, llvm::Value* value) const
 {
-	const cool_class* cls = this;
-	while (cls->_parent != nullptr)
-		cls = cls->_parent;
-
-	return upcast_to(builder, value, cls);
+	return upcast_to(builder, value, ancestor_at_depth(0));
 }
 
 llvm::Value* lcool::cool_class::downcast(llvm::IRBuilder<>& builder, llvm::Value* value) const
@@ -297,9 +354,10 @@ lcool::cool_program::cool_program(llvm::LLVMContext& context)
 	// Load builtins
 	_module = lcool::builtins_load_bitfile(context);
 	lcool::builtins_register(*this);
+	number_classes();
 }
 
-cool_class* lcool::cool_program::lookup_class(const std::string& name)
+cool_class* lcool::cool_program::lookup_class(symbol name)
 {
 	auto iter = _classes.find(name);
 	if (iter != _classes.end())
@@ -308,7 +366,7 @@ cool_class* lcool::cool_program::lookup_class(const std::string& name)
 	return nullptr;
 }
 
-const cool_class* lcool::cool_program::lookup_class(const std::string& name) const
+const cool_class* lcool::cool_program::lookup_class(symbol name) const
 {
 	auto iter = _classes.find(name);
 	if (iter != _classes.end())
@@ -317,9 +375,17 @@ const cool_class* lcool::cool_program::lookup_class(const std::string& name) con
 	return nullptr;
 }
 
+std::vector<cool_class*> lcool::cool_program::classes()
+{
+	std::vector<cool_class*> result;
+	for (auto& pair : _classes)
+		result.push_back(pair.second.get());
+	return result;
+}
+
 cool_class* lcool::cool_program::insert_class(unique_ptr<cool_class> cls)
 {
-	std::string name = cls->name();
+	symbol name = cls->name();
 	auto result = _classes.emplace(name, std::move(cls));
 	if (result.second)
 		return result.first->second.get();
@@ -327,6 +393,53 @@ cool_class* lcool::cool_program::insert_class(unique_ptr<cool_class> cls)
 	return nullptr;
 }
 
+void lcool::cool_program::number_classes()
+{
+	// Find the children of every class
+	std::unordered_map<cool_class*, std::vector<cool_class*>> children;
+	cool_class* root = nullptr;
+
+	for (auto& pair : _classes)
+	{
+		cool_class* cls = pair.second.get();
+		if (cls->_parent == nullptr)
+			root = cls;
+		else
+			children[cls->_parent].push_back(cls);
+	}
+
+	assert(root != nullptr);
+
+	// Walk the hierarchy in pre-order (without recursing since it can be
+	//  very deep). A class is on the stack twice: once to number it and
+	//  once (marked with a set bit) to finish its interval.
+	std::vector<std::pair<cool_class*, bool>> stack = { { root, false } };
+	unsigned next_order = 0;
+
+	while (!stack.empty())
+	{
+		cool_class* cls = stack.back().first;
+		bool finished = stack.back().second;
+		stack.pop_back();
+
+		if (finished)
+		{
+			cls->_order_end = next_order;
+			continue;
+		}
+
+		cls->_order_begin = next_order++;
+		stack.emplace_back(cls, true);
+
+		auto iter = children.find(cls);
+		if (iter != children.end())
+		{
+			for (cool_class* child : iter->second)
+				stack.emplace_back(child, false);
+		}
+	}
+}
+
 llvm::Constant* lcool::cool_program::create_string_literal(std::string content, std::string name)
 {
 	llvm::LLVMContext& context = module()->getContext();
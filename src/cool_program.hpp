@@ -21,33 +21,69 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
+#include <cassert>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "smart_ptr.hpp"
+#include "symbol.hpp"
 
 namespace lcool
 {
+	class attribute_profile;
 	class cool_class;
 
 	/** Contains information about an attribute */
 	struct cool_attribute
 	{
 		/** The name of this attribute */
-		std::string name;
+		symbol name;
 
 		/** The type of this attribute */
 		cool_class* type;
 
-		/** The index into the llvm_type of the parent class this attribute is stored at */
+		/** The class which this attribute is declared in */
+		cool_class* declaring_class;
+
+		/**
+		 * The index into the llvm_type of the parent class this attribute is stored at
+		 *
+		 * For cold attributes, this is an index into the side object instead.
+		 */
 		unsigned struct_index;
+
+		/**
+		 * True if this attribute is stored in the declaring class's side object
+		 *
+		 * See cool_class::cold_struct_index.
+		 */
+		bool cold;
+
+		/**
+		 * True if this attribute is a Bool packed into a flags word
+		 *
+		 * The attribute is then stored in bit bit_index of the element at struct_index.
+		 */
+		bool packed;
+
+		/** The bit this attribute is stored in (if packed) */
+		unsigned bit_index;
+
+		/**
+		 * Counter incremented each time the program accesses this attribute
+		 *
+		 * This is NULL unless the program is instrumented (see
+		 * cool_program::set_profile_output).
+		 */
+		llvm::GlobalVariable* use_counter;
 	};
 
 	/** Contains information about a method slot */
 	struct cool_method_slot
 	{
 		/** The name of this method */
-		std::string name;
+		symbol name;
 
 		/** The return type of this method */
 		cool_class* return_type;
@@ -69,6 +105,14 @@ namespace lcool
 		 * Is this field is 0, this method cannot be called through a vtable.
 		 */
 		unsigned vtable_index;
+
+		/**
+		 * Index of this slot within the method table of the declaring class
+		 * (and all of its subclasses)
+		 *
+		 * This is assigned by cool_class::build_method_table.
+		 */
+		unsigned table_index;
 	};
 
 	/**
@@ -130,6 +174,17 @@ namespace lcool
 			return _func;
 		}
 
+		/**
+		 * Sets this method's LLVM function
+		 *
+		 * Only needed if the original function has been replaced (for instance
+		 * by the module linker).
+		 */
+		void set_llvm_func(llvm::Function* func)
+		{
+			_func = func;
+		}
+
 		/**
 		 * The class which this method is defined in
 		 *
@@ -175,11 +230,11 @@ namespace lcool
 	class cool_class
 	{
 	public:
-		cool_class(const std::string& name, cool_class* parent);
+		cool_class(symbol name, cool_class* parent);
 		virtual ~cool_class() = default;
 
 		/** Returns the name of this class */
-		const std::string& name() const
+		symbol name() const
 		{
 			return _name;
 		}
@@ -190,10 +245,29 @@ namespace lcool
 			return _parent;
 		}
 
-		/** Returns true if this class is a subclass of some other class */
-		bool is_subclass_of(const cool_class* other) const;
+		/** Returns the number of ancestors of this class (0 for the Object class) */
+		unsigned depth() const
+		{
+			return _depth;
+		}
+
+		/**
+		 * Returns true if this class is a subclass of some other class
+		 *
+		 * This takes constant time, but can only be used after the classes
+		 * have been numbered (see cool_program::number_classes).
+		 */
+		bool is_subclass_of(const cool_class* other) const
+		{
+			assert(_order_end != 0 && other->_order_end != 0);
+			return other->_order_begin <= _order_begin && _order_begin < other->_order_end;
+		}
 
-		/** Finds lowest common ancestor of two classes */
+		/**
+		 * Finds lowest common ancestor of two classes
+		 *
+		 * This takes logarithmic time in the depth of the classes.
+		 */
 		static cool_class* common_ancestor(cool_class* a, cool_class* b);
 
 		/** Returns true if this class is final (can't be inherited from) */
@@ -203,22 +277,44 @@ namespace lcool
 		 * Lookup an attribute by its name
 		 * @return a pointer to the attribute or NULL if the attribute does not exist
 		 */
-		cool_attribute* lookup_attribute(const std::string& name);
+		cool_attribute* lookup_attribute(symbol name);
 
 		/**
 		 * Lookup a method by its name
 		 *
+		 * A recursive lookup uses the method table of the parent class, so
+		 * it can only be done once the parent's method table has been built.
+		 *
 		 * @param name name of the method
 		 * @param recursive search parent classes in addition to this class
 		 * @return a pointer to the method or NULL if the method does not exist
 		 */
-		cool_method* lookup_method(const std::string& name, bool recursive = false);
+		cool_method* lookup_method(symbol name, bool recursive = false);
+
+		/**
+		 * Returns the method which is called through the given slot for
+		 * objects of this class
+		 *
+		 * The slot must be declared in this class or one of its ancestors,
+		 * and this class's method table must have been built.
+		 */
+		cool_method* resolve_method(const cool_method_slot* slot)
+		{
+			assert(slot->table_index < _method_table.size());
+			return _method_table[slot->table_index];
+		}
 
-		/** Returns a vector containing all the attributes declared in this class */
-		std::vector<cool_attribute*> attributes();
+		/** Returns all the attributes declared in this class (in declaration order) */
+		const std::vector<cool_attribute*>& attributes() const
+		{
+			return _attribute_list;
+		}
 
-		/** Returns a vector containing all the methods declared in this class */
-		std::vector<cool_method*> methods();
+		/** Returns all the methods declared in this class (in declaration order) */
+		const std::vector<cool_method*>& methods() const
+		{
+			return _method_list;
+		}
 
 		/**
 		 * Returns the LLVM type used for this class
@@ -232,6 +328,39 @@ namespace lcool
 			return _llvm_type;
 		}
 
+		/**
+		 * Returns the index of the pointer to this class's side object within llvm_type
+		 *
+		 * Rarely used (cold) attributes are moved into a separate object
+		 * which is allocated the first time one of them is used. The pointer
+		 * is NULL until then. Returns 0 if the class has no cold attributes.
+		 */
+		unsigned cold_struct_index() const
+		{
+			return _cold_struct_index;
+		}
+
+		/**
+		 * Returns the function which returns this class's side object (allocating it if needed)
+		 *
+		 * Returns NULL if the class has no cold attributes.
+		 */
+		llvm::Function* cold_accessor()
+		{
+			return _cold_accessor;
+		}
+
+		/**
+		 * Sets the function returned by cold_accessor
+		 *
+		 * Only needed if the original function has been replaced (for instance
+		 * by the module linker).
+		 */
+		void set_cold_accessor(llvm::Function* func)
+		{
+			_cold_accessor = func;
+		}
+
 		/**
 		 * Returns a pointer to the LLVM vtable object used for this class
 		 */
@@ -243,7 +372,7 @@ namespace lcool
 		/**
 		 * Returns a pointer to the LLVM vtable object upcasted to $Object$vtabletype*
 		 */
-		llvm::Constant* llvm_object_vtable();
+		llvm::Constant* llvm_object_vtable() const;
 
 		/**
 		 * Creates an instance of this object
@@ -254,6 +383,14 @@ namespace lcool
 		 */
 		virtual llvm::Value* create_object(llvm::IRBuilder<>& builder) const;
 
+		/**
+		 * Returns the value variables of this class are initialized to
+		 *
+		 * For Ints, Bools and Strings this is the same as create_object.
+		 * Otherwise it is void (null).
+		 */
+		virtual llvm::Value* default_value(llvm::IRBuilder<>& builder) const;
+
 		/**
 		 * Upcasts an object of this class's type to one of it's parent types
 		 *
@@ -316,19 +453,66 @@ namespace lcool
 		llvm::Function* destructor();
 
 	protected:
-		std::string _name;
+		symbol _name;
 		cool_class* _parent = nullptr;
-		std::unordered_map<std::string, unique_ptr<cool_attribute>> _attributes;
-		std::unordered_map<std::string, unique_ptr<cool_method>> _methods;
+		unsigned _depth = 0;
+
+		// Ancestor table: the nth item is this class's (2 ^ n)th ancestor
+		std::vector<cool_class*> _ancestors;
+
+		// Position of this class in a pre-order walk of the class hierarchy
+		//  Its subclasses are numbered from _order_begin to _order_end - 1.
+		unsigned _order_begin = 0;
+		unsigned _order_end = 0;
+
+		std::unordered_map<symbol, unique_ptr<cool_attribute>> _attributes;
+		std::unordered_map<symbol, unique_ptr<cool_method>> _methods;
+		std::vector<cool_attribute*> _attribute_list;
+		std::vector<cool_method*> _method_list;
+
+		// Every method callable on this class (including inherited ones)
+		//  The table is indexed by cool_method_slot::table_index.
+		std::vector<cool_method*> _method_table;
+		std::unordered_map<symbol, cool_method*> _method_lookup;
 
 		llvm::Type* _llvm_type = nullptr;
 		llvm::GlobalVariable* _vtable = nullptr;
+		unsigned _cold_struct_index = 0;
+		llvm::Function* _cold_accessor = nullptr;
 
 		/** Returns the function pointed to by the nth item in this class's Object vtable */
 		llvm::Function* get_object_vtable_func(unsigned index);
 
 		/** Calls a global function */
 		llvm::CallInst* call_global(llvm::IRBuilder<>& builder, std::string name, std::initializer_list<llvm::Value*> args) const;
+
+		/**
+		 * Inserts an attribute into this class
+		 *
+		 * @return a pointer to the inserted attribute or NULL if an attribute with that name already exists
+		 */
+		cool_attribute* insert_attribute(unique_ptr<cool_attribute> attribute);
+
+		/**
+		 * Inserts a method into this class
+		 *
+		 * @return a pointer to the inserted method or NULL if a method with that name already exists
+		 */
+		cool_method* insert_method(unique_ptr<cool_method> method);
+
+		/**
+		 * Builds the method table from the parent's table and the methods
+		 * declared in this class
+		 *
+		 * This must be called once all the methods have been inserted, and
+		 * after the parent's method table has been built.
+		 */
+		void build_method_table();
+
+		/** Returns the ancestor of this class with the given depth (which must not exceed this class's depth) */
+		const cool_class* ancestor_at_depth(unsigned depth) const;
+
+		friend class cool_program;
 	};
 
 	/**
@@ -358,17 +542,31 @@ namespace lcool
 			return _module.get();
 		}
 
+		/**
+		 * Releases ownership of this program's LLVM module
+		 *
+		 * Afterwards module() returns NULL, so no more code can be generated
+		 * using this program.
+		 */
+		unique_ptr<llvm::Module> release_module()
+		{
+			return std::move(_module);
+		}
+
 		/**
 		 * Lookup a class by its name
 		 * @return a pointer to the class or NULL if the class does not exist
 		 */
-		cool_class* lookup_class(const std::string& name);
+		cool_class* lookup_class(symbol name);
 
 		/**
 		 * Lookup a class by its name
 		 * @return a pointer to the class or NULL if the class does not exist
 		 */
-		const cool_class* lookup_class(const std::string& name) const;
+		const cool_class* lookup_class(symbol name) const;
+
+		/** Returns a vector containing all the classes in this program (in no particular order) */
+		std::vector<cool_class*> classes();
 
 		/**
 		 * Inserts a class into the program
@@ -379,6 +577,50 @@ namespace lcool
 		 */
 		cool_class* insert_class(unique_ptr<cool_class> cls);
 
+		/**
+		 * Numbers the classes in the program for fast subclass tests
+		 *
+		 * This must be called after inserting classes, but before calling
+		 * cool_class::is_subclass_of or cool_class::common_ancestor.
+		 */
+		void number_classes();
+
+		/**
+		 * Sets the attribute access counts used to lay out classes
+		 *
+		 * Rarely accessed attributes are moved into a side object (see
+		 * cool_class::cold_struct_index). The profile must outlive this
+		 * program. It may be NULL (which is the default).
+		 */
+		void set_profile(const attribute_profile* profile)
+		{
+			_profile = profile;
+		}
+
+		/** Returns the attribute access counts used to lay out classes (or NULL) */
+		const attribute_profile* profile() const
+		{
+			return _profile;
+		}
+
+		/**
+		 * Instruments the program to count the accesses to each attribute
+		 *
+		 * The counts are written to the given file when Main.main returns.
+		 * If filename is empty (the default), the program is not
+		 * instrumented. This must be set before the program is laid out.
+		 */
+		void set_profile_output(std::string filename)
+		{
+			_profile_output = std::move(filename);
+		}
+
+		/** Returns the file the attribute counts are written to (or an empty string) */
+		const std::string& profile_output() const
+		{
+			return _profile_output;
+		}
+
 		/**
 		 * Constructs and inserts a class into the program
 		 *
@@ -419,8 +661,10 @@ namespace lcool
 			llvm::Module* module, llvm::IRBuilder<>& builder, std::string name, std::initializer_list<llvm::Value*> args);
 
 	private:
-		std::unordered_map<std::string, unique_ptr<cool_class>> _classes;
+		std::unordered_map<symbol, unique_ptr<cool_class>> _classes;
 		unique_ptr<llvm::Module> _module;
+		const attribute_profile* _profile = nullptr;
+		std::string _profile_output;
 	};
 }
 
@@ -0,0 +1,669 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "ast.hpp"
+#include "flat_ast.hpp"
+
+namespace ast = lcool::ast;
+namespace flat_ast = lcool::flat_ast;
+using flat_ast::node_kind;
+
+namespace
+{
+	// Visitor which appends an expression tree to a list of flat nodes
+	class flattener : public ast::expr_visitor
+	{
+	public:
+		std::vector<flat_ast::node> nodes;
+		std::vector<std::string> strings;
+
+		// Starts a new node and returns its index
+		std::size_t begin_node(node_kind kind, lcool::location loc)
+		{
+			flat_ast::node n = {};
+			n.kind = kind;
+			n.loc = loc;
+			nodes.push_back(n);
+			return nodes.size() - 1;
+		}
+
+		// Finishes a node once all its children have been added
+		void end_node(std::size_t index)
+		{
+			nodes[index].size = nodes.size() - index;
+		}
+
+		// Adds a leaf node (with no children)
+		flat_ast::node& leaf_node(node_kind kind, lcool::location loc)
+		{
+			std::size_t index = begin_node(kind, loc);
+			end_node(index);
+			return nodes[index];
+		}
+
+		void add_expr(const ast::expr* expr)
+		{
+			if (expr)
+				expr->accept(*this);
+		}
+
+		void add_attribute(const ast::attribute& attribute)
+		{
+			std::size_t index = begin_node(node_kind::attribute, attribute.loc);
+			nodes[index].name = attribute.name;
+			nodes[index].type = attribute.type;
+			add_expr(attribute.initial);
+			end_node(index);
+		}
+
+		void add_method(const ast::method& method)
+		{
+			std::size_t index = begin_node(node_kind::method, method.loc);
+			nodes[index].name = method.name;
+			nodes[index].type = method.type;
+
+			for (auto& param : method.params)
+			{
+				flat_ast::node& n = leaf_node(node_kind::param, method.loc);
+				n.name = param.first;
+				n.type = param.second;
+			}
+
+			add_expr(method.body);
+			end_node(index);
+		}
+
+		void add_class(const ast::cls& cls)
+		{
+			std::size_t index = begin_node(node_kind::cls, cls.loc);
+			nodes[index].name = cls.name;
+			if (cls.parent)
+				nodes[index].type = *cls.parent;
+
+			for (auto& attribute : cls.attributes)
+				add_attribute(attribute);
+			for (auto& method : cls.methods)
+				add_method(method);
+
+			end_node(index);
+		}
+
+		void visit(const ast::assign& e) override
+		{
+			std::size_t index = begin_node(node_kind::assign, e.loc);
+			nodes[index].name = e.id;
+			add_expr(e.value);
+			end_node(index);
+		}
+
+		void visit(const ast::dispatch& e) override
+		{
+			std::size_t index = begin_node(node_kind::dispatch, e.loc);
+			nodes[index].name = e.method_name;
+			nodes[index].type = e.object_type;
+			nodes[index].op = (e.object != nullptr);
+
+			add_expr(e.object);
+			for (auto arg : e.arguments)
+				add_expr(arg);
+
+			end_node(index);
+		}
+
+		void visit(const ast::conditional& e) override
+		{
+			std::size_t index = begin_node(node_kind::conditional, e.loc);
+			add_expr(e.predicate);
+			add_expr(e.if_true);
+			add_expr(e.if_false);
+			end_node(index);
+		}
+
+		void visit(const ast::loop& e) override
+		{
+			std::size_t index = begin_node(node_kind::loop, e.loc);
+			add_expr(e.predicate);
+			add_expr(e.body);
+			end_node(index);
+		}
+
+		void visit(const ast::block& e) override
+		{
+			std::size_t index = begin_node(node_kind::block, e.loc);
+			for (auto statement : e.statements)
+				add_expr(statement);
+			end_node(index);
+		}
+
+		void visit(const ast::let& e) override
+		{
+			std::size_t index = begin_node(node_kind::let, e.loc);
+			for (auto& var : e.vars)
+				add_attribute(var);
+			add_expr(e.body);
+			end_node(index);
+		}
+
+		void visit(const ast::type_case& e) override
+		{
+			std::size_t index = begin_node(node_kind::type_case, e.loc);
+			add_expr(e.value);
+
+			for (auto& branch : e.branches)
+			{
+				std::size_t branch_index = begin_node(node_kind::case_branch, e.loc);
+				nodes[branch_index].name = branch.id;
+				nodes[branch_index].type = branch.type;
+				add_expr(branch.body);
+				end_node(branch_index);
+			}
+
+			end_node(index);
+		}
+
+		void visit(const ast::new_object& e) override
+		{
+			leaf_node(node_kind::new_object, e.loc).type = e.type;
+		}
+
+		void visit(const ast::constant_bool& e) override
+		{
+			leaf_node(node_kind::constant_bool, e.loc).value = e.value;
+		}
+
+		void visit(const ast::constant_int& e) override
+		{
+			leaf_node(node_kind::constant_int, e.loc).value = e.value;
+		}
+
+		void visit(const ast::constant_string& e) override
+		{
+			leaf_node(node_kind::constant_string, e.loc).value = strings.size();
+			strings.push_back(e.value.str());
+		}
+
+		void visit(const ast::identifier& e) override
+		{
+			leaf_node(node_kind::identifier, e.loc).name = e.id;
+		}
+
+		void visit(const ast::compute_unary& e) override
+		{
+			std::size_t index = begin_node(node_kind::compute_unary, e.loc);
+			nodes[index].op = static_cast<std::uint8_t>(e.op);
+			add_expr(e.body);
+			end_node(index);
+		}
+
+		void visit(const ast::compute_binary& e) override
+		{
+			std::size_t index = begin_node(node_kind::compute_binary, e.loc);
+			nodes[index].op = static_cast<std::uint8_t>(e.op);
+			add_expr(e.left);
+			add_expr(e.right);
+			end_node(index);
+		}
+	};
+}
+
+flat_ast::tree flat_ast::flatten(const ast::program& program)
+{
+	flattener builder;
+	for (auto& cls : program)
+		builder.add_class(cls);
+
+	return tree(std::move(builder.nodes), std::move(builder.strings));
+}
+
+namespace
+{
+	// Checks the structure of a node and all its children
+	class structure_checker
+	{
+	public:
+		explicit structure_checker(const flat_ast::tree& tree)
+			: _tree(tree)
+		{
+		}
+
+		// Checks that a range of nodes contains whole subtrees
+		bool check_siblings(const flat_ast::node* begin, const flat_ast::node* end)
+		{
+			for (const flat_ast::node* n = begin; n != end; n += n->size)
+			{
+				if (n->size == 0 || n->size > static_cast<std::size_t>(end - n) || !check(*n))
+					return false;
+			}
+
+			return true;
+		}
+
+	private:
+		// Consumes a child of the given kind (or any expression)
+		bool next_child(flat_ast::sibling_iterator& child, const flat_ast::sibling_iterator& end, node_kind kind)
+		{
+			if (child == end || child->kind != kind)
+				return false;
+
+			++child;
+			return true;
+		}
+
+		bool next_expr(flat_ast::sibling_iterator& child, const flat_ast::sibling_iterator& end)
+		{
+			if (child == end || !flat_ast::is_expr(child->kind))
+				return false;
+
+			++child;
+			return true;
+		}
+
+		// Consumes a number of expressions and checks there are no more children
+		bool last_exprs(flat_ast::sibling_iterator& child, const flat_ast::sibling_iterator& end, unsigned count)
+		{
+			for (unsigned i = 0; i < count; i++)
+			{
+				if (!next_expr(child, end))
+					return false;
+			}
+
+			return child == end;
+		}
+
+		// Checks that the parts of a node the parser always fills in are present
+		static bool has_operands(const flat_ast::node& n)
+		{
+			switch (n.kind)
+			{
+			case node_kind::cls:
+			case node_kind::assign:
+			case node_kind::dispatch:
+			case node_kind::identifier:
+				return !n.name.empty();
+
+			case node_kind::attribute:
+			case node_kind::method:
+			case node_kind::param:
+			case node_kind::case_branch:
+				return !n.name.empty() && !n.type.empty();
+
+			case node_kind::new_object:
+				return !n.type.empty();
+
+			default:
+				return true;
+			}
+		}
+
+		bool check(const flat_ast::node& n)
+		{
+			if (!has_operands(n) || !check_siblings(&n + 1, &n + n.size))
+				return false;
+
+			auto range = flat_ast::children(n);
+			auto child = range.begin();
+			auto end = range.end();
+
+			switch (n.kind)
+			{
+			case node_kind::cls:
+				while (next_child(child, end, node_kind::attribute))
+					;
+				while (next_child(child, end, node_kind::method))
+					;
+				return child == end;
+
+			case node_kind::attribute:
+				return child == end || last_exprs(child, end, 1);
+
+			case node_kind::method:
+				while (next_child(child, end, node_kind::param))
+					;
+				return last_exprs(child, end, 1);
+
+			case node_kind::param:
+			case node_kind::new_object:
+			case node_kind::constant_bool:
+			case node_kind::constant_int:
+			case node_kind::identifier:
+				return child == end;
+
+			case node_kind::constant_string:
+				return child == end &&
+					n.value >= 0 && static_cast<std::size_t>(n.value) < _tree.strings().size();
+
+			case node_kind::case_branch:
+			case node_kind::assign:
+				return last_exprs(child, end, 1);
+
+			case node_kind::dispatch:
+				if (n.op > 1)
+					return false;
+
+				while (next_expr(child, end))
+					;
+				return child == end && (n.op == 0 || !range.empty());
+
+			case node_kind::conditional:
+				return last_exprs(child, end, 3);
+
+			case node_kind::loop:
+				return last_exprs(child, end, 2);
+
+			case node_kind::block:
+				while (next_expr(child, end))
+					;
+				return child == end && !range.empty();
+
+			case node_kind::let:
+				if (!next_child(child, end, node_kind::attribute))
+					return false;
+				while (next_child(child, end, node_kind::attribute))
+					;
+				return last_exprs(child, end, 1);
+
+			case node_kind::type_case:
+				if (!next_expr(child, end) || !next_child(child, end, node_kind::case_branch))
+					return false;
+				while (next_child(child, end, node_kind::case_branch))
+					;
+				return child == end;
+
+			case node_kind::compute_unary:
+				return n.op <= static_cast<std::uint8_t>(ast::compute_unary_type::logical_not) &&
+					last_exprs(child, end, 1);
+
+			case node_kind::compute_binary:
+				return n.op <= static_cast<std::uint8_t>(ast::compute_binary_type::equal) &&
+					last_exprs(child, end, 2);
+			}
+
+			// Unknown node kind
+			return false;
+		}
+
+		const flat_ast::tree& _tree;
+	};
+
+	// Rebuilds the expressions of a flat tree in a program's arena
+	class unflattener
+	{
+	public:
+		unflattener(const flat_ast::tree& tree, ast::program& program)
+			: _tree(tree), _program(program)
+		{
+		}
+
+		ast::cls build_class(const flat_ast::node& n)
+		{
+			ast::cls result;
+			result.loc = n.loc;
+			result.name = n.name;
+			if (!n.type.empty())
+				result.parent = n.type;
+
+			for (const flat_ast::node& feature : flat_ast::children(n))
+			{
+				if (feature.kind == node_kind::attribute)
+					result.attributes.push_back(build_attribute(feature));
+				else
+					result.methods.push_back(build_method(feature));
+			}
+
+			return result;
+		}
+
+	private:
+		template <typename T>
+		T* make_expr(const flat_ast::node& n)
+		{
+			T* result = _program.nodes().create<T>();
+			result->loc = n.loc;
+			return result;
+		}
+
+		// Builds a list from a range of sibling nodes (placing it straight in the arena)
+		template <typename T, typename Builder>
+		ast::node_list<T> make_list(flat_ast::sibling_iterator begin, flat_ast::sibling_iterator end, Builder build)
+		{
+			std::size_t size = 0;
+			for (auto iter = begin; iter != end; ++iter)
+				size++;
+
+			T* items = _program.nodes().create_array<T>(size);
+			for (std::size_t i = 0; i < size; i++)
+				items[i] = build(*begin++);
+
+			return ast::node_list<T>(items, size);
+		}
+
+		ast::node_list<ast::expr*> make_expr_list(flat_ast::sibling_iterator begin, flat_ast::sibling_iterator end)
+		{
+			return make_list<ast::expr*>(begin, end, [this](const flat_ast::node& n)
+			{
+				return build_expr(n);
+			});
+		}
+
+		ast::attribute build_attribute(const flat_ast::node& n)
+		{
+			ast::attribute result;
+			result.loc = n.loc;
+			result.name = n.name;
+			result.type = n.type;
+
+			auto initial = flat_ast::children(n);
+			if (!initial.empty())
+				result.initial = build_expr(*initial.begin());
+
+			return result;
+		}
+
+		ast::method build_method(const flat_ast::node& n)
+		{
+			ast::method result;
+			result.loc = n.loc;
+			result.name = n.name;
+			result.type = n.type;
+
+			for (const flat_ast::node& child : flat_ast::children(n))
+			{
+				if (child.kind == node_kind::param)
+					result.params.emplace_back(child.name, child.type);
+				else
+					result.body = build_expr(child);
+			}
+
+			return result;
+		}
+
+		ast::expr* build_expr(const flat_ast::node& n)
+		{
+			auto child = flat_ast::children(n).begin();
+
+			switch (n.kind)
+			{
+			case node_kind::assign:
+			{
+				auto result = make_expr<ast::assign>(n);
+				result->id = n.name;
+				result->value = build_expr(*child);
+				return result;
+			}
+
+			case node_kind::dispatch:
+			{
+				auto result = make_expr<ast::dispatch>(n);
+				result->method_name = n.name;
+				result->object_type = n.type;
+				if (n.op)
+					result->object = build_expr(*child++);
+
+				result->arguments = make_expr_list(child, flat_ast::children(n).end());
+				return result;
+			}
+
+			case node_kind::conditional:
+			{
+				auto result = make_expr<ast::conditional>(n);
+				result->predicate = build_expr(*child++);
+				result->if_true = build_expr(*child++);
+				result->if_false = build_expr(*child);
+				return result;
+			}
+
+			case node_kind::loop:
+			{
+				auto result = make_expr<ast::loop>(n);
+				result->predicate = build_expr(*child++);
+				result->body = build_expr(*child);
+				return result;
+			}
+
+			case node_kind::block:
+			{
+				auto result = make_expr<ast::block>(n);
+				result->statements = make_expr_list(child, flat_ast::children(n).end());
+				return result;
+			}
+
+			case node_kind::let:
+			{
+				auto result = make_expr<ast::let>(n);
+
+				// The body is the last child
+				auto body = child;
+				while (body->kind == node_kind::attribute)
+					++body;
+
+				result->vars = make_list<ast::attribute>(child, body, [this](const flat_ast::node& var)
+				{
+					return build_attribute(var);
+				});
+
+				result->body = build_expr(*body);
+				return result;
+			}
+
+			case node_kind::type_case:
+			{
+				auto result = make_expr<ast::type_case>(n);
+				result->value = build_expr(*child++);
+				result->branches = make_list<ast::type_case_branch>(child, flat_ast::children(n).end(),
+					[this](const flat_ast::node& b)
+					{
+						ast::type_case_branch branch;
+						branch.id = b.name;
+						branch.type = b.type;
+						branch.body = build_expr(*flat_ast::children(b).begin());
+						return branch;
+					});
+
+				return result;
+			}
+
+			case node_kind::new_object:
+			{
+				auto result = make_expr<ast::new_object>(n);
+				result->type = n.type;
+				return result;
+			}
+
+			case node_kind::constant_bool:
+			{
+				auto result = make_expr<ast::constant_bool>(n);
+				result->value = (n.value != 0);
+				return result;
+			}
+
+			case node_kind::constant_int:
+			{
+				auto result = make_expr<ast::constant_int>(n);
+				result->value = n.value;
+				return result;
+			}
+
+			case node_kind::constant_string:
+			{
+				// Strings must be copied into the arena with the expressions
+				const std::string& value = _tree.string_value(n);
+				auto result = make_expr<ast::constant_string>(n);
+				result->value = llvm::StringRef(_program.nodes().copy_array(value.data(), value.size()), value.size());
+				return result;
+			}
+
+			case node_kind::identifier:
+			{
+				auto result = make_expr<ast::identifier>(n);
+				result->id = n.name;
+				return result;
+			}
+
+			case node_kind::compute_unary:
+			{
+				auto result = make_expr<ast::compute_unary>(n);
+				result->op = static_cast<ast::compute_unary_type>(n.op);
+				result->body = build_expr(*child);
+				return result;
+			}
+
+			case node_kind::compute_binary:
+			{
+				auto result = make_expr<ast::compute_binary>(n);
+				result->op = static_cast<ast::compute_binary_type>(n.op);
+				result->left = build_expr(*child++);
+				result->right = build_expr(*child);
+				return result;
+			}
+
+			default:
+				// Declarations are handled separately
+				return nullptr;
+			}
+		}
+
+		const flat_ast::tree& _tree;
+		ast::program& _program;
+	};
+}
+
+bool flat_ast::is_well_formed(const tree& tree)
+{
+	const std::vector<node>& nodes = tree.nodes();
+	structure_checker checker(tree);
+	if (!checker.check_siblings(nodes.data(), nodes.data() + nodes.size()))
+		return false;
+
+	// Only classes are allowed at the top level
+	for (const node& cls : tree.classes())
+	{
+		if (cls.kind != node_kind::cls)
+			return false;
+	}
+
+	return true;
+}
+
+ast::program flat_ast::unflatten(const tree& tree)
+{
+	ast::program program;
+	unflattener builder(tree, program);
+
+	for (const node& cls : tree.classes())
+		program.push_back(builder.build_class(cls));
+
+	return program;
+}
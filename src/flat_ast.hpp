@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LCOOL_FLAT_AST_HPP
+#define LCOOL_FLAT_AST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+#include "logger.hpp"
+#include "symbol.hpp"
+
+namespace lcool { namespace flat_ast
+{
+	/** Types of nodes in a flat AST */
+	enum class node_kind : std::uint8_t
+	{
+		// Declarations
+		cls,                /**< Class: name, type = parent, children = attributes then methods */
+		attribute,          /**< Attribute / let variable: name, type, children = [initial] */
+		method,             /**< Method: name, type = return type, children = params then body */
+		param,              /**< Method parameter: name, type */
+		case_branch,        /**< Type case branch: name, type, children = body */
+
+		// Expressions
+		assign,             /**< name = identifier, children = value */
+		dispatch,           /**< name = method, type = static type, op = has object, children = [object] args */
+		conditional,        /**< children = predicate, if true, if false */
+		loop,               /**< children = predicate, body */
+		block,              /**< children = statements */
+		let,                /**< children = attributes then body */
+		type_case,          /**< children = value then case branches */
+		new_object,         /**< type */
+		constant_bool,      /**< value */
+		constant_int,       /**< value */
+		constant_string,    /**< value = index into the string table */
+		identifier,         /**< name */
+		compute_unary,      /**< op = ast::compute_unary_type, children = body */
+		compute_binary,     /**< op = ast::compute_binary_type, children = left, right */
+	};
+
+	/** Returns true if nodes of the given kind are expressions */
+	inline bool is_expr(node_kind kind)
+	{
+		return kind >= node_kind::assign;
+	}
+
+	/**
+	 * A single node in a flat AST
+	 *
+	 * Nodes are stored in pre-order so the children of a node immediately
+	 * follow it. The next sibling of a node is found by skipping over all
+	 * the nodes in its subtree.
+	 */
+	struct node
+	{
+		/** Type of node (decides how the other fields are used) */
+		node_kind kind;
+
+		/** Operator of compute nodes / whether a dispatch has an explicit object */
+		std::uint8_t op;
+
+		/** Number of nodes in this subtree (including this one) */
+		std::uint32_t size;
+
+		/** Location of the start of the node */
+		location loc;
+
+		/** Integer / boolean constant or string table index */
+		std::int32_t value;
+
+		/** Name of the declaration / identifier / method */
+		symbol name;
+
+		/** Type of the declaration / new object / static dispatch */
+		symbol type;
+	};
+
+	/** Iterates over a sequence of sibling nodes */
+	class sibling_iterator
+	{
+	public:
+		explicit sibling_iterator(const node* pos)
+			: _pos(pos)
+		{
+		}
+
+		const node& operator*() const   { return *_pos; }
+		const node* operator->() const  { return _pos; }
+
+		sibling_iterator& operator++()
+		{
+			_pos += _pos->size;
+			return *this;
+		}
+
+		sibling_iterator operator++(int)
+		{
+			sibling_iterator old = *this;
+			++*this;
+			return old;
+		}
+
+		bool operator==(const sibling_iterator& other) const { return _pos == other._pos; }
+		bool operator!=(const sibling_iterator& other) const { return _pos != other._pos; }
+
+	private:
+		const node* _pos;
+	};
+
+	/** A range of sibling nodes (usable in range based for loops) */
+	class sibling_range
+	{
+	public:
+		sibling_range(const node* begin, const node* end)
+			: _begin(begin), _end(end)
+		{
+		}
+
+		sibling_iterator begin() const  { return sibling_iterator(_begin); }
+		sibling_iterator end() const    { return sibling_iterator(_end); }
+		bool empty() const              { return _begin == _end; }
+
+	private:
+		const node* _begin;
+		const node* _end;
+	};
+
+	/** Returns the direct children of a node */
+	inline sibling_range children(const node& parent)
+	{
+		return sibling_range(&parent + 1, &parent + parent.size);
+	}
+
+	/**
+	 * An entire program stored in a flat array of nodes
+	 *
+	 * The top-level nodes are the classes of the program. Walking the whole
+	 * array from start to finish visits every node in pre-order.
+	 */
+	class tree
+	{
+	public:
+		tree() = default;
+
+		/** Creates a tree from existing nodes and string table */
+		tree(std::vector<node> nodes, std::vector<std::string> strings)
+			: _nodes(std::move(nodes)), _strings(std::move(strings))
+		{
+		}
+
+		/** Returns every node in the tree (in pre-order) */
+		const std::vector<node>& nodes() const
+		{
+			return _nodes;
+		}
+
+		/** Returns the classes in the tree */
+		sibling_range classes() const
+		{
+			return sibling_range(_nodes.data(), _nodes.data() + _nodes.size());
+		}
+
+		/** Returns the string table */
+		const std::vector<std::string>& strings() const
+		{
+			return _strings;
+		}
+
+		/** Returns the value of a constant_string node */
+		const std::string& string_value(const node& n) const
+		{
+			return _strings[n.value];
+		}
+
+	private:
+		std::vector<node> _nodes;
+		std::vector<std::string> _strings;
+	};
+
+	/** Converts a program into a flat tree */
+	tree flatten(const ast::program& program);
+
+	/**
+	 * Checks that a tree has the structure produced by flatten
+	 *
+	 * This should be used on trees from untrusted sources before passing
+	 * them to unflatten (which assumes the tree is well formed).
+	 */
+	bool is_well_formed(const tree& tree);
+
+	/** Converts a (well formed) flat tree back into a program */
+	ast::program unflatten(const tree& tree);
+}}
+
+#endif
@@ -17,8 +17,12 @@
 
 #include <boost/format.hpp>
 #include <boost/logic/tribool.hpp>
+#include <llvm/IR/DataLayout.h>
+#include <algorithm>
+#include <cstdint>
 
 #include "ast.hpp"
+#include "attribute_profile.hpp"
 #include "builtins.hpp"
 #include "cool_program.hpp"
 #include "layout.hpp"
@@ -33,18 +37,21 @@ using boost::logic::indeterminate;
 namespace
 {
 
+// Names the layout treats specially
+const symbol object_symbol("Object");
+
 /** A user-defined class */
 class user_class : public lcool::cool_class
 {
 public:
-	user_class(const std::string& name, cool_class* parent)
+	user_class(symbol name, cool_class* parent)
 		: cool_class(name, parent)
 	{
 		// Also create an empty StructType for this class
 		//  This is needed to handle references to types which have not been
 		//  layed out yet
 		auto& llvm_context = parent->llvm_type()->getContext();
-		_llvm_type = llvm::StructType::create(llvm_context, name)->getPointerTo();
+		_llvm_type = llvm::StructType::create(llvm_context, name.str())->getPointerTo();
 	}
 
 	// We know this must be a PointerType
@@ -59,9 +66,12 @@ public:
 		return llvm::cast<llvm::StructType>(llvm_type()->getElementType());
 	}
 
-	using cool_class::_attributes;
-	using cool_class::_methods;
+	using cool_class::insert_attribute;
+	using cool_class::insert_method;
+	using cool_class::build_method_table;
 	using cool_class::_vtable;
+	using cool_class::_cold_struct_index;
+	using cool_class::_cold_accessor;
 };
 
 // Processing state of class sorter
@@ -71,7 +81,7 @@ struct insert_empty_classes_state
 	cool_program& output;
 	logger& log;
 
-	std::unordered_map<std::string, unsigned> input_index;
+	std::unordered_map<symbol, unsigned> input_index;
 	std::vector<const ast::cls*> layout_list;
 	std::vector<tribool> visited_list;
 
@@ -86,7 +96,7 @@ struct insert_empty_classes_state
 
 void log_class_loop(insert_empty_classes_state& state, unsigned class_index)
 {
-	std::string loop_str = state.input[class_index].name;
+	std::string loop_str = state.input[class_index].name.str();
 	unsigned current_class = class_index;
 
 	// Construct the loop string by traversing each class's parent until
@@ -98,7 +108,7 @@ void log_class_loop(insert_empty_classes_state& state, unsigned class_index)
 
 		// Print it
 		loop_str += " -> ";
-		loop_str += state.input[current_class].name;
+		loop_str += state.input[current_class].name.str();
 	}
 	while(current_class != class_index);
 
@@ -120,7 +130,7 @@ void insert_empty_classes_visit(insert_empty_classes_state& state, unsigned clas
 	else if (!state.visited_list[class_index])
 	{
 		// Lookup parent class
-		std::string parent_name = cls.parent.get_value_or("Object");
+		symbol parent_name = cls.parent ? *cls.parent : object_symbol;
 		cool_class* parent = state.output.lookup_class(parent_name);
 
 		if (parent == nullptr)
@@ -198,11 +208,171 @@ llvm::Function* create_fast_function(
 	return func;
 }
 
+// A field of a class's llvm structure which has not been placed yet
+struct pending_field
+{
+	llvm::Type* type;
+
+	// The attributes stored in this field (more than one for flags words)
+	std::vector<cool_attribute*> attributes;
+};
+
+// Rounds offset up to a multiple of align
+std::uint64_t align_offset(std::uint64_t offset, std::uint64_t align)
+{
+	return (offset + align - 1) / align * align;
+}
+
+// Returns the offset just after the last element of a structure
+//  This excludes the tail padding of the structure.
+std::uint64_t data_end(const llvm::DataLayout& data_layout, const std::vector<llvm::Type*>& elements)
+{
+	std::uint64_t offset = 0;
+	for (llvm::Type* type : elements)
+	{
+		offset = align_offset(offset, data_layout.getABITypeAlignment(type));
+		offset += data_layout.getTypeAllocSize(type);
+	}
+
+	return offset;
+}
+
+// Appends some fields to a structure's elements, ordering them to minimize
+//  the amount of padding inserted between them
+void place_fields(const llvm::DataLayout& data_layout, std::vector<llvm::Type*>& elements, std::vector<pending_field> fields)
+{
+	std::uint64_t offset = data_end(data_layout, elements);
+
+	while (!fields.empty())
+	{
+		// Choose the most aligned field which can be placed without any
+		//  padding, or the most aligned field if there are none
+		auto best = fields.begin();
+		std::uint64_t best_align = 0;
+		bool best_fits = false;
+
+		for (auto iter = fields.begin(); iter != fields.end(); ++iter)
+		{
+			std::uint64_t align = data_layout.getABITypeAlignment(iter->type);
+			bool fits = (offset % align == 0);
+
+			if ((fits && !best_fits) || (fits == best_fits && align > best_align))
+			{
+				best = iter;
+				best_align = align;
+				best_fits = fits;
+			}
+		}
+
+		// Add it to the structure
+		for (cool_attribute* attrib : best->attributes)
+			attrib->struct_index = elements.size();
+
+		elements.push_back(best->type);
+		offset = align_offset(offset, best_align) + data_layout.getTypeAllocSize(best->type);
+		fields.erase(best);
+	}
+}
+
+// Packs a list of Bool attributes into as few flags words as possible
+std::vector<pending_field> pack_bools(llvm::LLVMContext& context, const std::vector<cool_attribute*>& bools)
+{
+	const unsigned max_bits = 32;
+	std::vector<pending_field> result;
+
+	for (unsigned i = 0; i < bools.size(); i++)
+	{
+		unsigned bit = i % max_bits;
+		if (bit == 0)
+		{
+			// Use the smallest word which can hold the remaining bools
+			unsigned remaining = std::min<size_t>(bools.size() - i, max_bits);
+			unsigned width = (remaining <= 8) ? 8 : (remaining <= 16) ? 16 : 32;
+			result.push_back({ llvm::IntegerType::get(context, width), {} });
+		}
+
+		bools[i]->packed = true;
+		bools[i]->bit_index = bit;
+		result.back().attributes.push_back(bools[i]);
+	}
+
+	return result;
+}
+
+// Attributes used less than 1 / cold_ratio times as often as the most used
+//  attribute of their class are cold
+const std::uint64_t cold_ratio = 100;
+
+// Marks the attributes of a class which should be moved into its side object
+//  Attributes with initializers are never cold, since they would force every
+//  object to allocate its side object in its constructor anyway.
+void mark_cold_attributes(
+	const attribute_profile* profile,
+	user_class* cls,
+	const std::vector<cool_attribute*>& attributes,
+	const std::vector<bool>& initialized)
+{
+	if (profile == nullptr || !profile->has_class(cls->name()))
+		return;
+
+	std::uint64_t max_count = 0;
+	for (cool_attribute* attrib : attributes)
+		max_count = std::max(max_count, profile->count(cls->name(), attrib->name));
+
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		std::uint64_t count = profile->count(cls->name(), attributes[i]->name);
+		if (!initialized[i] && count < max_count / cold_ratio)
+			attributes[i]->cold = true;
+	}
+}
+
+// Creates the fields needed to store some attributes (either the hot or the cold ones)
+std::vector<pending_field> attribute_fields(
+	llvm::LLVMContext& context, const std::vector<cool_attribute*>& attributes, bool cold)
+{
+	std::vector<pending_field> fields;
+	std::vector<cool_attribute*> attrib_bool;
+
+	for (cool_attribute* attrib : attributes)
+	{
+		if (attrib->cold != cold)
+			continue;
+
+		// Bools are packed later, everything else gets its own field
+		llvm::Type* type = attrib->type->llvm_type();
+		if (type->isIntegerTy(1))
+			attrib_bool.push_back(attrib);
+		else
+			fields.push_back({ type, { attrib } });
+	}
+
+	auto flags = pack_bools(context, attrib_bool);
+	fields.insert(fields.end(), flags.begin(), flags.end());
+	return fields;
+}
+
 // Processes a class's attributes and creates its llvm structure
+//
+// The structure starts with the elements of the parent class's structure so
+// that objects can be upcast with a bitcast. The class's own attributes are
+// placed after them (possibly filling the tail padding of the parent) in the
+// order which wastes the least space. Bools are packed into flags words.
+//
+// If there is an attribute profile, rarely used attributes are moved into
+// a separate side object (as long as they take up more space than the
+// pointer to it).
+//
+// The module usually has no target at this point, so LLVM's default data
+// layout (with 64-bit pointers) is used to choose the order.
 void process_attributes(const ast::cls& ast_cls, user_class* cls, cool_program& output, logger& log)
 {
+	llvm::Module* module = output.module();
+	llvm::LLVMContext& context = module->getContext();
+	const llvm::DataLayout& data_layout = module->getDataLayout();
 	std::vector<llvm::Type*> elements;
-	std::vector<cool_attribute*> attrib_int, attrib_bool;
+	std::vector<cool_attribute*> attributes;
+	std::vector<bool> initialized;
 
 	// Ensure the parent class is not final
 	if (cls->parent()->is_final())
@@ -213,10 +383,10 @@ void process_attributes(const ast::cls& ast_cls, user_class* cls, cool_program&
 	}
 	else
 	{
-		// Add parent class to structure
-		//  We want to add the content of the parent rather than a pointer to it
+		// Copy the parent's elements into the structure
 		auto parent_pointer = llvm::cast<llvm::PointerType>(cls->parent()->llvm_type());
-		elements.push_back(parent_pointer->getElementType());
+		auto parent_struct = llvm::cast<llvm::StructType>(parent_pointer->getElementType());
+		elements.assign(parent_struct->element_begin(), parent_struct->element_end());
 	}
 
 	for (const ast::attribute& ast_attrib : ast_cls.attributes)
@@ -224,54 +394,82 @@ void process_attributes(const ast::cls& ast_cls, user_class* cls, cool_program&
 		cool_class* type = output.lookup_class(ast_attrib.type);
 		if (type == nullptr)
 		{
-			log.error(ast_attrib.loc, "unknown type '" + ast_attrib.type + "'");
+			log.error(ast_attrib.loc, "unknown type '" + ast_attrib.type.str() + "'");
 			continue;
 		}
 
 		// Create and insert cool_attribute
-		auto result = cls->_attributes.emplace(ast_attrib.name, make_unique<cool_attribute>());
-		if (!result.second)
+		auto new_attrib = make_unique<cool_attribute>();
+		new_attrib->name = ast_attrib.name;
+		new_attrib->type = type;
+		new_attrib->declaring_class = cls;
+
+		cool_attribute* attrib = cls->insert_attribute(std::move(new_attrib));
+		if (attrib == nullptr)
 		{
-			log.error(ast_attrib.loc, "attribute already defined '" + ast_attrib.name + "'");
+			log.error(ast_attrib.loc, "attribute already defined '" + ast_attrib.name.str() + "'");
 			continue;
 		}
 
-		cool_attribute* attrib = result.first->second.get();
-		attrib->name = ast_attrib.name;
-		attrib->type = type;
-		attrib->struct_index = elements.size();
+		attributes.push_back(attrib);
+		initialized.push_back(ast_attrib.initial != nullptr);
+	}
+
+	// Move cold attributes into the side object if it saves any space
+	mark_cold_attributes(output.profile(), cls, attributes, initialized);
+
+	auto fields = attribute_fields(context, attributes, false);
+	auto cold_fields = attribute_fields(context, attributes, true);
+	llvm::PointerType* cold_pointer = nullptr;
 
-		// If the type is an integer or boolean, it will be added to the elements
-		//  list later at the end of the struct to reduce the amount of padding
-		auto int_type = llvm::dyn_cast<llvm::IntegerType>(type->llvm_type());
-		if (int_type != nullptr)
+	if (!cold_fields.empty())
+	{
+		std::vector<llvm::Type*> cold_elements;
+		place_fields(data_layout, cold_elements, std::move(cold_fields));
+
+		if (data_end(data_layout, cold_elements) > data_layout.getPointerSize())
 		{
-			if (int_type->getBitWidth() == 1)
-				attrib_bool.push_back(attrib);
-			else
-				attrib_int.push_back(attrib);
+			auto cold_struct = llvm::StructType::create(context, cold_elements, cls->name().str() + "$cold");
+			cold_pointer = cold_struct->getPointerTo();
+			fields.push_back({ cold_pointer, {} });
 		}
 		else
 		{
-			elements.push_back(type->llvm_type());
+			for (cool_attribute* attrib : attributes)
+				attrib->cold = false;
+			fields = attribute_fields(context, attributes, false);
 		}
 	}
 
-	// Add any ints or bools to the elements list
-	for (auto attrib : attrib_int)
+	// Finally, set the body of our llvm type
+	place_fields(data_layout, elements, std::move(fields));
+	cls->llvm_struct_type()->setBody(elements);
+
+	// Create a stub for the function which returns the side object
+	if (cold_pointer != nullptr)
 	{
-		attrib->struct_index = elements.size();
-		elements.push_back(attrib->type->llvm_type());
+		cls->_cold_struct_index = std::find(elements.begin(), elements.end(), cold_pointer) - elements.begin();
+		cls->_cold_accessor = create_fast_function(
+			module,
+			llvm::FunctionType::get(cold_pointer, cls->llvm_type(), false),
+			cls->name().str() + "$cold");
 	}
 
-	for (auto attrib : attrib_bool)
+	// Create the counters used by instrumented programs
+	if (!output.profile_output().empty())
 	{
-		attrib->struct_index = elements.size();
-		elements.push_back(attrib->type->llvm_type());
+		auto counter_type = llvm::Type::getInt64Ty(context);
+		for (cool_attribute* attrib : attributes)
+		{
+			attrib->use_counter = new llvm::GlobalVariable(
+				*module,
+				counter_type,
+				false,
+				llvm::GlobalVariable::InternalLinkage,
+				llvm::ConstantInt::get(counter_type, 0),
+				cls->name().str() + "." + attrib->name.str() + "$uses");
+		}
 	}
-
-	// Finally, set the body of our llvm type
-	cls->llvm_struct_type()->setBody(elements);
 }
 
 // Processes the list of methods and creates their slots and stub functions
@@ -286,7 +484,7 @@ void process_methods(const ast::cls& ast_cls, user_class* cls, cool_program& out
 		cool_class* return_type = output.lookup_class(method.type);
 		if (return_type == nullptr)
 		{
-			log.error(method.loc, "unknown type '" + method.type + "'");
+			log.error(method.loc, "unknown type '" + method.type.str() + "'");
 			continue;
 		}
 
@@ -295,7 +493,7 @@ void process_methods(const ast::cls& ast_cls, user_class* cls, cool_program& out
 		{
 			cool_class* type = output.lookup_class(param_pair.second);
 			if (type == nullptr)
-				log.error(method.loc, "unknown type '" + param_pair.second + "'");
+				log.error(method.loc, "unknown type '" + param_pair.second.str() + "'");
 			else
 				parameter_types.push_back(type);
 		}
@@ -324,10 +522,10 @@ void process_methods(const ast::cls& ast_cls, user_class* cls, cool_program& out
 
 			// Create a stub function
 			llvm::Function* func =
-				create_fast_function(module, func_type, cls->name() + "." + method.name);
+				create_fast_function(module, func_type, cls->name().str() + "." + method.name.str());
 
 			// Add to list of methods
-			cls->_methods.emplace(method.name, lcool::make_unique<cool_method>(std::move(slot), func));
+			cls->insert_method(lcool::make_unique<cool_method>(std::move(slot), func));
 		}
 		else if (existing_method->declaring_class() == cls)
 		{
@@ -347,12 +545,15 @@ void process_methods(const ast::cls& ast_cls, user_class* cls, cool_program& out
 			llvm::Function* func = create_fast_function(
 				module,
 				existing_method->llvm_func()->getFunctionType(),
-				cls->name() + "." + method.name);
+				cls->name().str() + "." + method.name.str());
 
 			// Add method override
-			cls->_methods.emplace(method.name, lcool::make_unique<cool_method>(cls, existing_method, func));
+			cls->insert_method(lcool::make_unique<cool_method>(cls, existing_method, func));
 		}
 	}
+
+	// Freeze the methods of this class for its subclasses and the vtable
+	cls->build_method_table();
 }
 
 // Creates an initializer for the vtable for the given class
@@ -371,7 +572,7 @@ llvm::Constant* create_partial_vtable_init(user_class* top_cls, cool_program& ou
 		auto ptr_object_type = cls->llvm_type();
 
 		// 0 Pointer to parent vtable
-		auto object_vtabletype = output.lookup_class("Object")->llvm_vtable()->getType();
+		auto object_vtabletype = output.lookup_class(object_symbol)->llvm_vtable()->getType();
 		elements.push_back(llvm::ConstantExpr::getBitCast(
 			top_cls->parent()->llvm_vtable(),
 			object_vtabletype));
@@ -385,26 +586,26 @@ llvm::Constant* create_partial_vtable_init(user_class* top_cls, cool_program& ou
 		elements.push_back(final_size);
 
 		// 2 Pointer to name string
-		elements.push_back(output.create_string_literal(top_cls->name(), top_cls->name() + "$name"));
+		elements.push_back(output.create_string_literal(top_cls->name().str(), top_cls->name().str() + "$name"));
 
 		// 3 Constructor
 		elements.push_back(create_fast_function(
 			output.module(),
 			llvm::FunctionType::get(void_type, ptr_object_type, false),
-			top_cls->name() + "$construct"));
+			top_cls->name().str() + "$construct"));
 
 		// 4 Copy constructor
 		std::vector<llvm::Type*> cc_func_params = { ptr_object_type, ptr_object_type };
 		elements.push_back(create_fast_function(
 			output.module(),
 			llvm::FunctionType::get(void_type, cc_func_params, false),
-			top_cls->name() + "$copyconstruct"));
+			top_cls->name().str() + "$copyconstruct"));
 
 		// 5 Destructor
 		elements.push_back(create_fast_function(
 			output.module(),
 			llvm::FunctionType::get(void_type, ptr_object_type, false),
-			top_cls->name() + "$destroy"));
+			top_cls->name().str() + "$destroy"));
 	}
 	else
 	{
@@ -421,8 +622,7 @@ llvm::Constant* create_partial_vtable_init(user_class* top_cls, cool_program& ou
 		if (slot->declaring_class == cls)
 		{
 			// Lookup the method which this slot will resolve to at runtime
-			auto resolved_method = top_cls->lookup_method(slot->name, true);
-			assert(resolved_method != nullptr);
+			auto resolved_method = top_cls->resolve_method(slot);
 			assert(resolved_method->slot() == slot);
 
 			// Add the correct function into the correct vtable slot
@@ -434,14 +634,14 @@ llvm::Constant* create_partial_vtable_init(user_class* top_cls, cool_program& ou
 	}
 
 	// Get vtable struct's type
-	llvm::StructType * vtabletype = output.module()->getTypeByName(cls->name() + "$vtabletype");
+	llvm::StructType * vtabletype = output.module()->getTypeByName(cls->name().str() + "$vtabletype");
 	if (vtabletype == nullptr)
 	{
 		std::vector<llvm::Type*> element_types;
 		for (auto element : elements)
 			element_types.push_back(element->getType());
 
-		vtabletype = llvm::StructType::create(element_types, cls->name() + "$vtabletype");
+		vtabletype = llvm::StructType::create(element_types, cls->name().str() + "$vtabletype");
 	}
 
 	// Return final struct
@@ -461,7 +661,7 @@ void create_vtable(user_class* cls, cool_program& output)
 		true,
 		llvm::GlobalVariable::InternalLinkage,
 		initializer,
-		cls->name() + "$vtable");
+		cls->name().str() + "$vtable");
 }
 
 // Layout a single class
@@ -487,7 +687,7 @@ void layout_cls(const ast::cls& ast_cls, cool_program& output, logger& log)
 void lcool::layout(const ast::program& input, cool_program& output, logger& log)
 {
 	// Basic sanity check
-	assert(output.lookup_class("Object") != nullptr);
+	assert(output.lookup_class(object_symbol) != nullptr);
 
 	// Insert empty versions of all classes
 	auto layout_list = insert_empty_classes(input, output, log);
@@ -497,5 +697,8 @@ void lcool::layout(const ast::program& input, cool_program& output, logger& log)
 		// Layout each of them in turn
 		for (auto cls : layout_list)
 			layout_cls(*cls, output, log);
+
+		// Number the new hierarchy
+		output.number_classes();
 	}
 }
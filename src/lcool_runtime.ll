@@ -49,12 +49,14 @@
 ; (all Object and IO functions are called through a vtable)
 ;
 ; abort_case
+; alloc_side_object
 ; instance_of
 ; new_object
 ; null_check
 ; refcount_inc
 ; refcount_dec
 ; zero_division_check
+; profile_write
 ;
 ; Int$box
 ; Bool$box
@@ -215,6 +217,10 @@ declare void @exit(i32) noreturn nounwind
 declare noalias i8* @malloc(i32) nounwind
 declare void @free(i8*) nounwind
 
+declare %IO$File* @fopen(i8*, i8*) nounwind
+declare i32 @fclose(%IO$File*) nounwind
+declare i32 @fprintf(%IO$File*, i8*, ...) nounwind
+
 declare i32 @printf(i8*, ...) nounwind
 declare i32 @fputs(i8*, %IO$File*) nounwind
 declare i32 @fputc(i32, %IO$File*) nounwind
@@ -238,6 +244,12 @@ declare void @llvm.memcpy.p0i8.p0i8.i32(i8*, i8*, i32, i32, i1)
 @err_range = private unnamed_addr constant [35 x i8] c"Bad range for String.substr() call\00"
 @err_div_zero = private unnamed_addr constant [17 x i8] c"Division by zero\00"
 @err_case = private unnamed_addr constant [29 x i8] c"Case without matching branch\00"
+@err_profile = private unnamed_addr constant [29 x i8] c"Could not write profile data\00"
+@profile_mode = private unnamed_addr constant [2 x i8] c"w\00"
+@format_profile = private unnamed_addr constant [9 x i8] c"%s %llu\0A\00"
+
+; Attribute use counter (see profile_write)
+%profile_entry = type { i8*, i64* }
 
 ; Builtin method implementations
 
@@ -327,6 +339,24 @@ Empty:
 	ret %String* @String$empty
 }
 
+; Allocates space for the side object containing an object's cold attributes
+define hidden fastcc i8* @alloc_side_object(i32 %size)
+{
+	%ptr = call i8* @malloc(i32 %size)
+
+	; Test if result was null
+	%ptr_is_null = icmp eq i8* %ptr, null
+	br i1 %ptr_is_null, label %Null, label %NotNull
+
+NotNull:
+	ret i8* %ptr
+
+Null:
+	; Abort out of memory
+	call fastcc void @abort_with_msg(i8* getelementptr inbounds ([14 x i8], [14 x i8]* @err_oom, i32 0, i32 0))
+	unreachable
+}
+
 ; Determines if an object is an instance of the given class (or a subclass)
 define hidden fastcc i1 @instance_of(%Object* %this, %Object$vtabletype* %cls) readonly
 {
@@ -462,6 +492,44 @@ Zero:
 	unreachable
 }
 
+; Writes the attribute use counters of an instrumented program to a file
+;  Each line contains the name of an attribute and the number of uses
+define hidden fastcc void @profile_write(i8* %filename, %profile_entry* %entries, i32 %count)
+{
+	%mode = getelementptr inbounds [2 x i8], [2 x i8]* @profile_mode, i32 0, i32 0
+	%file = call %IO$File* @fopen(i8* %filename, i8* %mode)
+	%file_is_null = icmp eq %IO$File* %file, null
+	br i1 %file_is_null, label %Error, label %LoopStart
+
+LoopStart:
+	; Stop after the last entry
+	%i = phi i32 [ 0, %0 ], [ %next_i, %LoopBody ]
+	%done = icmp eq i32 %i, %count
+	br i1 %done, label %Done, label %LoopBody
+
+LoopBody:
+	; Print the name and count of this entry
+	%name_ptr = getelementptr inbounds %profile_entry, %profile_entry* %entries, i32 %i, i32 0
+	%name = load i8*, i8** %name_ptr
+	%counter_ptr = getelementptr inbounds %profile_entry, %profile_entry* %entries, i32 %i, i32 1
+	%counter = load i64*, i64** %counter_ptr
+	%value = load i64, i64* %counter
+
+	%format = getelementptr inbounds [9 x i8], [9 x i8]* @format_profile, i32 0, i32 0
+	call i32 (%IO$File*, i8*, ...) @fprintf(%IO$File* %file, i8* %format, i8* %name, i64 %value)
+
+	%next_i = add i32 %i, 1
+	br label %LoopStart
+
+Done:
+	call i32 @fclose(%IO$File* %file)
+	ret void
+
+Error:
+	call fastcc void @abort_with_msg(i8* getelementptr inbounds ([29 x i8], [29 x i8]* @err_profile, i32 0, i32 0))
+	unreachable
+}
+
 ; Destroy the given object
 define hidden fastcc void @Object$destroy(%Object* %this)
 {
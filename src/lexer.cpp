@@ -17,51 +17,167 @@
 
 #include <boost/format.hpp>
 #include <cctype>
-#include <istream>
-#include <map>
+#include <cstddef>
+#include <cstdio>
 #include <string>
 
 #include "lexer.hpp"
 #include "logger.hpp"
 #include "smart_ptr.hpp"
 
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
 using lcool::lexer;
 using lcool::token_type;
 
 namespace
 {
-	// List of keywords in lowercase
-	const std::map<std::string, token_type> kw_mappings =
+	// Returns true if c is whitespace (the same as isspace in the C locale)
+	bool is_whitespace(char c)
+	{
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+
+	// Returns the first character in [pos, end) which is not whitespace
+	const char* skip_whitespace(const char* pos, const char* end)
+	{
+		// Most runs of whitespace are short, so check a few characters first
+		for (int i = 0; i < 4; i++, pos++)
+		{
+			if (pos == end || !is_whitespace(*pos))
+				return pos;
+		}
+
+#if defined(__SSE2__)
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i four = _mm_set1_epi8(4);
+
+		for (; end - pos >= 16; pos += 16)
+		{
+			// Whitespace is ' ' or '\t' to '\r' (c - '\t' <= 4 when unsigned)
+			__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+			__m128i from_tab = _mm_sub_epi8(chars, tab);
+			__m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(from_tab, four), from_tab);
+			__m128i is_space = _mm_or_si128(is_control, _mm_cmpeq_epi8(chars, space));
+
+			unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_space)) & 0xFFFF;
+			if (mask != 0)
+				return pos + __builtin_ctz(mask);
+		}
+#endif
+
+		while (pos != end && is_whitespace(*pos))
+			pos++;
+
+		return pos;
+	}
+
+	// Returns the first occurrence of any of the given characters in
+	//  [pos, end) or end if there are none (repeat characters to search
+	//  for fewer than 4)
+	const char* find_first_of(const char* pos, const char* end, char a, char b, char c, char d)
 	{
-		{ "case",       token_type::kw_case },
-		{ "class",      token_type::kw_class },
-		{ "else",       token_type::kw_else },
-		{ "esac",       token_type::kw_esac },
-		{ "fi",         token_type::kw_fi },
-		{ "if",         token_type::kw_if },
-		{ "in",         token_type::kw_in },
-		{ "inherits",   token_type::kw_inherits },
-		{ "isvoid",     token_type::kw_isvoid },
-		{ "let",        token_type::kw_let },
-		{ "loop",       token_type::kw_loop },
-		{ "new",        token_type::kw_new },
-		{ "not",        token_type::kw_not },
-		{ "of",         token_type::kw_of },
-		{ "pool",       token_type::kw_pool },
-		{ "then",       token_type::kw_then },
-		{ "while",      token_type::kw_while },
-	};
-
-	// Convert string to lowercase
-	std::string str_tolower(const std::string& str)
+#if defined(__SSE2__)
+		const __m128i va = _mm_set1_epi8(a);
+		const __m128i vb = _mm_set1_epi8(b);
+		const __m128i vc = _mm_set1_epi8(c);
+		const __m128i vd = _mm_set1_epi8(d);
+
+		for (; end - pos >= 16; pos += 16)
+		{
+			__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+			__m128i found = _mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chars, va), _mm_cmpeq_epi8(chars, vb)),
+				_mm_or_si128(_mm_cmpeq_epi8(chars, vc), _mm_cmpeq_epi8(chars, vd)));
+
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+			if (mask != 0)
+				return pos + __builtin_ctz(mask);
+		}
+#endif
+
+		while (pos != end && *pos != a && *pos != b && *pos != c && *pos != d)
+			pos++;
+
+		return pos;
+	}
+
+	// Lowercases an ASCII character
+	constexpr char ascii_tolower(char c)
 	{
-		std::string result;
-		result.reserve(str.length());
+		return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+	}
 
+	// Packs the length and the (lowercase) first and last characters of a
+	//  word into a key. No two keywords have the same key, so it can be
+	//  switched on directly.
+	constexpr unsigned keyword_key(std::size_t length, char first, char last)
+	{
+		return (static_cast<unsigned>(length) << 16) |
+			(static_cast<unsigned>(static_cast<unsigned char>(ascii_tolower(first))) << 8) |
+			static_cast<unsigned char>(ascii_tolower(last));
+	}
+
+	template <std::size_t N>
+	constexpr unsigned keyword_key(const char (&keyword)[N])
+	{
+		return keyword_key(N - 1, keyword[0], keyword[N - 2]);
+	}
+
+	// Returns type if str is the given lowercase keyword (ignoring case)
+	token_type match_keyword(llvm::StringRef str, const char* keyword, token_type type)
+	{
 		for (char c : str)
-			result += std::tolower(c);
+		{
+			if (ascii_tolower(c) != *keyword++)
+				return token_type::eof;
+		}
 
-		return result;
+		return type;
+	}
+
+	// Returns type if str is exactly the given keyword
+	token_type match_exact(llvm::StringRef str, const char* keyword, token_type type)
+	{
+		return (str == keyword) ? type : token_type::eof;
+	}
+
+	// Classifies a word as a keyword or boolean constant
+	//  Keywords are case insensitive, but true and false must be lowercase.
+	//  Returns eof if the word is not a keyword.
+	token_type classify_keyword(llvm::StringRef str)
+	{
+		// The longest keyword is "inherits"
+		if (str.size() < 2 || str.size() > 8)
+			return token_type::eof;
+
+		switch (keyword_key(str.size(), str.front(), str.back()))
+		{
+			case keyword_key("case"):      return match_keyword(str, "case", token_type::kw_case);
+			case keyword_key("class"):     return match_keyword(str, "class", token_type::kw_class);
+			case keyword_key("else"):      return match_keyword(str, "else", token_type::kw_else);
+			case keyword_key("esac"):      return match_keyword(str, "esac", token_type::kw_esac);
+			case keyword_key("fi"):        return match_keyword(str, "fi", token_type::kw_fi);
+			case keyword_key("if"):        return match_keyword(str, "if", token_type::kw_if);
+			case keyword_key("in"):        return match_keyword(str, "in", token_type::kw_in);
+			case keyword_key("inherits"):  return match_keyword(str, "inherits", token_type::kw_inherits);
+			case keyword_key("isvoid"):    return match_keyword(str, "isvoid", token_type::kw_isvoid);
+			case keyword_key("let"):       return match_keyword(str, "let", token_type::kw_let);
+			case keyword_key("loop"):      return match_keyword(str, "loop", token_type::kw_loop);
+			case keyword_key("new"):       return match_keyword(str, "new", token_type::kw_new);
+			case keyword_key("not"):       return match_keyword(str, "not", token_type::kw_not);
+			case keyword_key("of"):        return match_keyword(str, "of", token_type::kw_of);
+			case keyword_key("pool"):      return match_keyword(str, "pool", token_type::kw_pool);
+			case keyword_key("then"):      return match_keyword(str, "then", token_type::kw_then);
+			case keyword_key("while"):     return match_keyword(str, "while", token_type::kw_while);
+			case keyword_key("true"):      return match_exact(str, "true", token_type::boolean);
+			case keyword_key("false"):     return match_exact(str, "false", token_type::boolean);
+		}
+
+		return token_type::eof;
 	}
 }
 
@@ -75,11 +191,9 @@ lcool::parse_error::parse_error(const lcool::location& loc, const boost::format&
 {
 }
 
-lexer::lexer(std::istream& input, lcool::shared_ptr<const std::string>& filename)
-	: input(input), loc { filename, 1, 1 }, lookahead(EOF)
+lexer::lexer(llvm::StringRef input, lcool::location start)
+	: begin(input.begin()), pos(input.begin()), end(input.end()), start(start)
 {
-	// Consume first character
-	consume_char();
 }
 
 lcool::token lexer::scan_token()
@@ -99,22 +213,24 @@ lcool::token lexer::scan_token()
 lcool::token lexer::scan_token_all()
 {
 	// Skip leading whitespace
-	while (isspace(lookahead))
-		consume_char();
+	pos = skip_whitespace(pos, end);
 
 	// Initialize result
 	token result;
-	result.loc = loc;
-
-	// Test based on first character
-	int first = consume_char(result);
+	result.loc = current_loc();
 
-	switch (first)
+	if (pos == end)
 	{
-	case EOF:
 		result.type = token_type::eof;
-		break;
+		return result;
+	}
+
+	// Test based on first character (which is never a new line)
+	const char* start = pos;
+	char first = *pos++;
 
+	switch (first)
+	{
 	// Symbols and comments
 	case ';': result.type = token_type::semicolon; break;
 	case ':': result.type = token_type::colon;     break;
@@ -131,14 +247,14 @@ lcool::token lexer::scan_token_all()
 
 	case '<':
 		// < <- <=
-		if (lookahead == '-')
+		if (peek() == '-')
 		{
-			consume_char(result);
+			pos++;
 			result.type = token_type::assign;
 		}
-		else if (lookahead == '=')
+		else if (peek() == '=')
 		{
-			consume_char(result);
+			pos++;
 			result.type = token_type::less_equal;
 		}
 		else
@@ -150,9 +266,9 @@ lcool::token lexer::scan_token_all()
 
 	case '=':
 		// = =>
-		if (lookahead == '>')
+		if (peek() == '>')
 		{
-			consume_char(result);
+			pos++;
 			result.type = token_type::case_arrow;
 		}
 		else
@@ -164,7 +280,7 @@ lcool::token lexer::scan_token_all()
 
 	case '-':
 		// - or single line comment
-		if (lookahead == '-')
+		if (peek() == '-')
 		{
 			parse_comment_single();
 			result.type = token_type::comment;
@@ -178,8 +294,9 @@ lcool::token lexer::scan_token_all()
 
 	case '(':
 		// ( or multi line comment
-		if (lookahead == '*')
+		if (peek() == '*')
 		{
+			pos++;
 			parse_comment_multi();
 			result.type = token_type::comment;
 		}
@@ -197,74 +314,156 @@ lcool::token lexer::scan_token_all()
 
 	default:
 		// Test for special terminals
-		if (isalpha(first))
+		if (isalpha(static_cast<unsigned char>(first)))
 		{
-			parse_identifier(result);
+			parse_identifier(result, start);
 		}
-		else if (isdigit(first))
+		else if (isdigit(static_cast<unsigned char>(first)))
 		{
 			parse_integer(result);
 		}
 		else
 		{
-			throw parse_error(result.loc, boost::format("lexical error: %1%") % static_cast<char>(first));
+			throw parse_error(result.loc, boost::format("lexical error: %1%") % first);
 		}
 	}
 
+	result.value = llvm::StringRef(start, pos - start);
 	return result;
 }
 
-void lexer::parse_identifier(token& into)
+std::vector<std::size_t> lexer::scan_class_keywords()
 {
-	// Consume as many characters as possible
-	while (isalnum(lookahead) || lookahead == '_')
-		consume_char(into);
+	std::vector<std::size_t> result;
 
-	// Determine token type
-	auto iter = kw_mappings.find(str_tolower(into.value));
-	if (iter != kw_mappings.end())
+	try
 	{
-		into.type = iter->second;
+		for (;;)
+		{
+			pos = skip_whitespace(pos, end);
+			if (pos == end)
+				break;
+
+			// Token boundaries must match scan_token_all exactly
+			const char* start = pos;
+			char first = *pos++;
+
+			switch (first)
+			{
+			case '<':
+				// <- and <= (so "<--" is not a comment)
+				if (peek() == '-' || peek() == '=')
+					pos++;
+				break;
+
+			case '-':
+				if (peek() == '-')
+					parse_comment_single();
+				break;
+
+			case '(':
+				if (peek() == '*')
+				{
+					pos++;
+					parse_comment_multi();
+				}
+				break;
+
+			case '"':
+			{
+				token ignored;
+				parse_string(ignored);
+				break;
+			}
+
+			default:
+				if (isalpha(static_cast<unsigned char>(first)))
+				{
+					while (isalnum(peek()) || peek() == '_')
+						pos++;
+
+					llvm::StringRef word(start, pos - start);
+					if (word.size() == 5 && classify_keyword(word) == token_type::kw_class)
+						result.push_back(start - begin);
+				}
+				else if (isdigit(static_cast<unsigned char>(first)))
+				{
+					while (isdigit(peek()))
+						pos++;
+				}
+			}
+		}
 	}
-	else if (into.value == "true" || into.value == "false")
+	catch (parse_error&)
 	{
-		into.type = token_type::boolean;
+		// The rest of the input cannot be split up
 	}
-	else if (islower(into.value[0]))
+
+	return result;
+}
+
+void lexer::parse_identifier(token& into, const char* start)
+{
+	// Consume as many characters as possible
+	while (isalnum(peek()) || peek() == '_')
+		pos++;
+
+	// Determine token type
+	llvm::StringRef value(start, pos - start);
+
+	token_type keyword = classify_keyword(value);
+	if (keyword != token_type::eof)
 	{
-		into.type = token_type::id;
+		into.type = keyword;
 	}
 	else
 	{
-		into.type = token_type::type;
+		if (islower(static_cast<unsigned char>(value[0])))
+			into.type = token_type::id;
+		else
+			into.type = token_type::type;
+
+		symbol& name = symbols[value];
+		if (name.empty())
+			name = symbol(value);
+
+		into.name = name;
 	}
 }
 
 void lexer::parse_string(token& into)
 {
-	int c;
-
-	do
+	// The opening quote has already been consumed
+	for (;;)
 	{
-		// Get next character
-		c = consume_char(into);
+		// Skip to the next character which needs handling
+		pos = find_first_of(pos, end, '"', '\\', '\n', '\r');
+		if (pos == end)
+			throw parse_error(current_loc(), "unexpected end of file in string");
 
-		// Handle special characters
-		if (c == '\\')
+		char c = *pos++;
+
+		if (c == '"')
 		{
-			// Consume whatever the next character is
-			consume_char(into);
+			break;
 		}
-		else if (c == '\n')
+		else if (c == '\\')
 		{
-			throw parse_error(loc, "unexpected new line in string");
+			// Consume whatever the next character is (treating CRLF as one character)
+			if (peek() == '\r' && end - pos >= 2 && pos[1] == '\n')
+				pos += 2;
+			else if (peek() != EOF)
+				pos++;
 		}
-		else if (c == EOF)
+		else if (c == '\n' || c == '\r')
 		{
-			throw parse_error(loc, "unexpected end of file in string");
+			// The error is reported at the start of the next line
+			if (c == '\r' && peek() == '\n')
+				pos++;
+
+			throw parse_error(current_loc(), "unexpected new line in string");
 		}
 	}
-	while (c != '"');
 
 	into.type = token_type::string;
 }
@@ -272,17 +471,16 @@ void lexer::parse_string(token& into)
 void lexer::parse_integer(token& into)
 {
 	// Consume characters until the first non-digit
-	while (isdigit(lookahead))
-		consume_char(into);
+	while (isdigit(peek()))
+		pos++;
 
 	into.type = token_type::integer;
 }
 
 void lexer::parse_comment_single()
 {
-	// Consume everything until LF or EOF
-	while (lookahead != '\n' && lookahead != EOF)
-		consume_char();
+	// Consume everything until the end of the line
+	pos = find_first_of(pos, end, '\n', '\r', '\n', '\r');
 }
 
 void lexer::parse_comment_multi()
@@ -290,69 +488,42 @@ void lexer::parse_comment_multi()
 	// Consume characters while handling nested comments
 	for (;;)
 	{
-		int c = consume_char();
+		// Only the start and end of nested comments are interesting
+		pos = find_first_of(pos, end, '(', '*', '(', '*');
+		if (pos == end)
+			throw parse_error(current_loc(), "unterminated multi-line comment");
+
+		char c = *pos++;
 
 		switch (c)
 		{
-		case EOF:
-			throw parse_error(loc, "unterminated multi-line comment");
-
 		case '(':
-			if (lookahead == '*')
+			if (peek() == '*')
 			{
 				// Recurse to handle nested comment
+				pos++;
 				parse_comment_multi();
 			}
 
 			break;
 
 		case '*':
-			if (lookahead == ')')
+			if (peek() == ')')
 			{
 				// Consume braket and finish
-				consume_char();
+				pos++;
 				return;
 			}
 		}
 	}
 }
 
-int lexer::consume_char()
+lcool::location lexer::current_loc() const
 {
-	// Read next character
-	int prevLookahead = lookahead;
-	lookahead = input.get();
-
-	// Handle CRLF to LF conversion
-	if (lookahead == '\r')
-	{
-		// Skip if the next character is LF
-		if (input.peek() == '\n')
-			input.get();
-
-		lookahead = '\n';
-	}
-
-	// Update location pointer
-	if (prevLookahead == '\n')
-	{
-		loc.line++;
-		loc.column = 1;
-	}
-	else if (prevLookahead != EOF)
-	{
-		loc.column++;
-	}
-
-	return prevLookahead;
+	return location(start.offset() + static_cast<std::uint32_t>(pos - begin));
 }
 
-int lexer::consume_char(token& into)
+int lexer::peek() const
 {
-	int c = consume_char();
-
-	if (c != EOF)
-		into.value += c;
-
-	return c;
+	return (pos == end) ? EOF : static_cast<unsigned char>(*pos);
 }
@@ -19,11 +19,16 @@
 #define LCOOL_LEXER_HPP
 
 #include <boost/format/format_fwd.hpp>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <cstddef>
 #include <cstdint>
-#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "logger.hpp"
-#include "smart_ptr.hpp"
+#include "symbol.hpp"
 
 namespace lcool
 {
@@ -87,7 +92,12 @@ namespace lcool
 	{
 		lcool::location loc;
 		token_type      type;
-		std::string     value;
+
+		/** Text of the token (points into the lexer's input) */
+		llvm::StringRef value;
+
+		/** Interned text of identifiers and types (empty for other tokens) */
+		lcool::symbol name;
 	};
 
 	/**
@@ -103,38 +113,66 @@ namespace lcool
 		const lcool::location loc;
 	};
 
-	/** Class which generates a stream of tokens from a character stream */
+	/** Class which generates a stream of tokens from a block of memory */
 	class lexer
 	{
 	public:
-		lexer(std::istream& input, shared_ptr<const std::string>& filename);
+		/**
+		 * Creates a lexer which scans the given input
+		 *
+		 * The input is not copied, so it must outlive the lexer and all the
+		 * tokens it returns.
+		 *
+		 * @param input the text to scan
+		 * @param start location of the first character of input
+		 */
+		lexer(llvm::StringRef input, location start);
 
 		/**
-		 * Scans the next token from the input stream
+		 * Scans the next token from the input
 		 *  Throws parse_error if a lexical error occurs
 		 */
 		token scan_token();
 
+		/**
+		 * Scans the rest of the input for class keywords
+		 *
+		 * This is much faster than scanning every token since only comments,
+		 * strings and words need any work. Lexical errors are ignored, but
+		 * scanning stops at the first error which would end the input (an
+		 * unterminated string or comment).
+		 *
+		 * @return the offset of each class keyword from the start of the input
+		 */
+		std::vector<std::size_t> scan_class_keywords();
+
 	private:
-		std::istream& input;
-		location loc;
-		int lookahead;
+		const char* begin;
+		const char* pos;
+		const char* end;
+
+		// Location of begin (other locations are offsets from this)
+		location start;
+
+		// Symbols already interned by this lexer (so the global symbol table
+		//  is only locked once per distinct name when parsing in parallel)
+		llvm::DenseMap<llvm::StringRef, symbol> symbols;
 
 		// Scan a token without discarding comments
 		token scan_token_all();
 
 		// Special terminal parsers
-		void parse_identifier(token& into);
+		void parse_identifier(token& into, const char* start);
 		void parse_string(token& into);
 		void parse_integer(token& into);
 		void parse_comment_single();
 		void parse_comment_multi();
 
-		/** Consumes one character of input (returns the value in lookahead) */
-		int consume_char();
+		/** Returns the location of the next character */
+		location current_loc() const;
 
-		/** Consumes one character and appends it to a token's value */
-		int consume_char(token& into);
+		/** Returns the next character without consuming it (EOF at the end of the input) */
+		int peek() const;
 	};
 }
 
@@ -20,10 +20,19 @@
 #include <string>
 
 #include "logger.hpp"
+#include "source_manager.hpp"
 
 std::string lcool::location::to_string() const
 {
-	return boost::str(boost::format("%1%:%2%:%3%") % *filename % line % column);
+	source_position pos = source_manager::instance().decode(*this);
+	if (pos.filename == nullptr)
+		return "<unknown>";
+
+	// The source of an AST file which is missing or has changed
+	if (pos.line == 0)
+		return *pos.filename;
+
+	return boost::str(boost::format("%1%:%2%:%3%") % *pos.filename % pos.line % pos.column);
 }
 
 std::ostream& lcool::operator<< (std::ostream& stream, const lcool::location& loc)
@@ -87,3 +96,45 @@ void lcool::logger_ostream::error(const lcool::location& loc, const std::string&
 	stream << loc << ": error: " << str << std::endl;
 	errors_printed = true;
 }
+
+bool lcool::logger_buffer::has_errors() const
+{
+	return errors_logged;
+}
+
+void lcool::logger_buffer::warning(const std::string& str)
+{
+	messages.push_back({ false, boost::none, str });
+}
+
+void lcool::logger_buffer::warning(const lcool::location& loc, const std::string& str)
+{
+	messages.push_back({ false, loc, str });
+}
+
+void lcool::logger_buffer::error(const std::string& str)
+{
+	messages.push_back({ true, boost::none, str });
+	errors_logged = true;
+}
+
+void lcool::logger_buffer::error(const lcool::location& loc, const std::string& str)
+{
+	messages.push_back({ true, loc, str });
+	errors_logged = true;
+}
+
+void lcool::logger_buffer::replay(lcool::logger& to) const
+{
+	for (const message& msg : messages)
+	{
+		if (msg.is_error && msg.loc)
+			to.error(*msg.loc, msg.str);
+		else if (msg.is_error)
+			to.error(msg.str);
+		else if (msg.loc)
+			to.warning(*msg.loc, msg.str);
+		else
+			to.warning(msg.str);
+	}
+}
@@ -19,29 +19,52 @@
 #define LCOOL_LOGGER_HPP
 
 #include <boost/format/format_fwd.hpp>
+#include <boost/optional/optional.hpp>
 #include <cstdint>
 #include <iosfwd>
 #include <string>
-
-#include "smart_ptr.hpp"
+#include <vector>
 
 namespace lcool
 {
-	/** A position in a code file (used for logging errors and debugging) */
+	/**
+	 * A position in a code file (used for logging errors and debugging)
+	 *
+	 * Locations are offsets allocated by the source_manager, which is used to
+	 * turn them back into a filename, line and column.
+	 */
 	class location
 	{
 	public:
-		/** Filename of this position */
-		shared_ptr<const std::string> filename;
-
-		/** Start line of the position (first line is 1) */
-		std::uint32_t line;
-
-		/** Start column of the position (first column is 1) */
-		std::uint32_t column;
+		/** Creates an invalid location */
+		location()
+			: _offset(0)
+		{
+		}
+
+		/** Creates a location from an offset given by the source_manager */
+		explicit location(std::uint32_t offset)
+			: _offset(offset)
+		{
+		}
+
+		/** Returns the offset of this location */
+		std::uint32_t offset() const
+		{
+			return _offset;
+		}
+
+		/** Returns true if this is a valid location */
+		bool valid() const
+		{
+			return _offset != 0;
+		}
 
 		/** Convert this location into a string */
 		std::string to_string() const;
+
+	private:
+		std::uint32_t _offset;
 	};
 
 	/** Prints a location to an output stream (according to to_string) */
@@ -98,6 +121,39 @@ namespace lcool
 		std::ostream& stream;
 		bool errors_printed = false;
 	};
+
+	/**
+	 * Implementation of logger which stores messages so they can be printed later
+	 *
+	 * This is used when multiple threads are logging messages at once and the
+	 * messages must be printed in a deterministic order.
+	 */
+	class logger_buffer : public logger
+	{
+	public:
+		virtual bool has_errors() const override;
+		virtual void warning(const std::string& str) override;
+		virtual void warning(const location& loc, const std::string& str) override;
+		virtual void error(const std::string& str) override;
+		virtual void error(const location& loc, const std::string& str) override;
+
+		using logger::warning;
+		using logger::error;
+
+		/** Logs all the stored messages to another logger (in the order they were logged) */
+		void replay(logger& to) const;
+
+	private:
+		struct message
+		{
+			bool is_error;
+			boost::optional<location> loc;
+			std::string str;
+		};
+
+		std::vector<message> messages;
+		bool errors_logged = false;
+	};
 }
 
 #endif
@@ -18,159 +18,508 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
 #include <boost/program_options.hpp>
+#include <llvm/ADT/SmallString.h>
 #include <llvm/Bitcode/ReaderWriter.h>
+#include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
-#include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
 #include <fstream>
 #include <iostream>
 
 #include "ast.hpp"
+#include "ast_file.hpp"
+#include "attribute_profile.hpp"
 #include "codegen.hpp"
 #include "cool_program.hpp"
 #include "layout.hpp"
 #include "logger.hpp"
+#include "memory.hpp"
+#include "native.hpp"
+#include "optimize.hpp"
 #include "parser.hpp"
+#include "server.hpp"
+#include "symbol.hpp"
+#include "timing.hpp"
+#include "typecheck.hpp"
 
 #define LCOOL_VERSION "0.1"
 
 namespace po = boost::program_options;
 
-int main(int argc, char* argv[])
+namespace
 {
-	po::options_description visible("Allowed options");
-	visible.add_options()
-		("help,h", "print help message")
-		("version", "print version")
-		("parse", "dump the parse tree instead of doing a full compile")
-		("output,o", po::value<std::string>(), "specify output file");
-
-	po::options_description config("Hidden options");
-	config.add(visible);
-	config.add_options()
-		("input", po::value<std::vector<std::string>>(), "specify input files");
-
-	po::positional_options_description p;
-	p.add("input", -1);
-
-	po::variables_map vm;
-	po::store(po::command_line_parser(argc, argv).options(config).positional(p).run(), vm);
-	po::notify(vm);
-
-	if (vm.count("version"))
+	// Types of file which can be written
+	enum class output_type
 	{
-		std::cerr << "lcoolc version " << LCOOL_VERSION << std::endl;
-		return 1;
-	}
+		bitcode,
+		assembly,
+		object,
+		executable,
+		ast,
+	};
 
-	if (vm.count("help"))
+	// Returns the default output filename to use for the given input
+	std::string default_output_filename(const std::string& input, output_type type)
 	{
-		std::cerr << "lcoolc [options] input files..." << std::endl;
-		std::cerr << " Compiles COOL sources into LLVM bitcode" << std::endl;
-		std::cerr << visible << std::endl;
-		return 1;
+		if (input == "-")
+			return (type == output_type::executable) ? "a.out" : "-";
+
+		std::string base = input;
+		if (boost::algorithm::ends_with(base, ".cl"))
+			base.resize(base.size() - 3);
+		else if (boost::algorithm::ends_with(base, ".clast") && type != output_type::ast)
+			base.resize(base.size() - 6);
+		else if (type == output_type::executable)
+			return input + ".out";
+
+		switch (type)
+		{
+			case output_type::bitcode:  return base + ".bc";
+			case output_type::assembly: return base + ".s";
+			case output_type::object:   return base + ".o";
+			case output_type::ast:      return base + ".clast";
+			default:                    return base;
+		}
 	}
 
-	// Parse input files
-	lcool::logger_ostream log;
-	if (!vm.count("input"))
+	// Prints the compile time and memory reports when a compile finishes
+	class profile_reporter
 	{
-		log.error("no input files");
-		return 1;
-	}
+	public:
+		profile_reporter(bool time_report, std::ofstream trace_file, bool mem_report)
+			: _time_report(time_report), _trace_file(std::move(trace_file))
+		{
+			if (_time_report || _trace_file.is_open())
+				_time_profiler = lcool::make_unique<lcool::time_profiler>();
+			if (mem_report)
+				_memory_profiler = lcool::make_unique<lcool::memory_profiler>();
+		}
+
+		~profile_reporter()
+		{
+			if (_time_report)
+				_time_profiler->write_report(std::clog);
+			if (_trace_file.is_open())
+				_time_profiler->write_trace(_trace_file);
+			if (_memory_profiler)
+				_memory_profiler->write_report(std::clog);
+		}
+
+	private:
+		bool _time_report;
+		std::ofstream _trace_file;
+		lcool::unique_ptr<lcool::time_profiler> _time_profiler;
+		lcool::unique_ptr<lcool::memory_profiler> _memory_profiler;
+	};
+
+	// Records the time and memory used by one of the main phases of the compiler
+	class phase_scope
+	{
+	public:
+		explicit phase_scope(const char* name)
+			: _timer(name), _memory(name)
+		{
+		}
 
-	auto inputs = vm["input"].as<std::vector<std::string>>();
-	lcool::ast::program program;
+	private:
+		lcool::time_scope _timer;
+		lcool::memory_scope _memory;
+	};
 
-	for (std::string filename : inputs)
+	// Records the sizes of the compiler's main data structures
+	void add_structure_statistics(
+		lcool::memory_profiler& profiler,
+		const lcool::ast::program& input,
+		lcool::cool_program& output)
 	{
-		lcool::ast::program parse_result;
+		std::uint64_t ast_attributes = 0, ast_methods = 0;
+		for (auto& cls : input)
+		{
+			ast_attributes += cls.attributes.size();
+			ast_methods += cls.methods.size();
+		}
+
+		profiler.add_statistic("AST classes", input.size());
+		profiler.add_statistic("AST attributes", ast_attributes);
+		profiler.add_statistic("AST methods", ast_methods);
+		profiler.add_statistic("AST expressions", lcool::ast::count_exprs(input));
+		profiler.add_statistic("AST arena bytes", input.arena_capacity());
+
+		// These include the builtin classes
+		std::uint64_t attributes = 0, methods = 0;
+		auto classes = output.classes();
+		for (lcool::cool_class* cls : classes)
+		{
+			attributes += cls->attributes().size();
+			methods += cls->methods().size();
+		}
+
+		profiler.add_statistic("Classes", classes.size());
+		profiler.add_statistic("Attributes", attributes);
+		profiler.add_statistic("Methods", methods);
+		profiler.add_statistic("Symbols", lcool::symbol::count());
+
+		std::uint64_t functions = 0, blocks = 0, instructions = 0;
+		for (llvm::Function& func : *output.module())
+		{
+			functions++;
+			blocks += func.size();
+			for (llvm::BasicBlock& block : func)
+				instructions += block.size();
+		}
+
+		profiler.add_statistic("LLVM functions", functions);
+		profiler.add_statistic("LLVM basic blocks", blocks);
+		profiler.add_statistic("LLVM instructions", instructions);
+	}
+
+	// Runs the compiler with the given command line arguments
+	//  If warm_program is given, it is used as the (empty) output program instead
+	//  of loading the runtime again
+	int compile(const std::vector<std::string>& args, lcool::cool_program* warm_program)
+	{
+		po::options_description visible("Allowed options");
+		visible.add_options()
+			("help,h", "print help message")
+			("version", "print version")
+			("parse", "dump the parse tree instead of doing a full compile")
+			("output,o", po::value<std::string>(), "specify output file")
+			("optimize,O", po::value<unsigned>()->default_value(0)->implicit_value(1), "optimization level (0-3)")
+			("time-passes", "print the time taken by each optimization pass")
+			("ftime-report", "print the time taken by each phase of the compiler")
+			("ftime-trace", po::value<std::string>(), "write a trace of the compile (in Chrome's JSON format) to the given file")
+			("mem-report", "print the memory used by each phase of the compiler")
+			("compile,c", "compile to a native object file")
+			("assembly,S", "compile to native assembly")
+			("link", "compile and link a native executable")
+			("emit-ast", "write the parsed program to a binary AST file (.clast)")
+			("run", "compile the program in memory and run it immediately")
+			("march", po::value<std::string>()->default_value(""), "CPU to generate native code for ('native' for the host CPU)")
+			("jobs,j", po::value<unsigned>()->default_value(0), "number of threads to use (0 for one per CPU)")
+			("profile-generate", po::value<std::string>(), "count the uses of each attribute and write them to the given file when the program finishes")
+			("profile-use", po::value<std::string>(), "move rarely used attributes (according to a --profile-generate profile) into separate objects")
+			("server", po::value<std::string>(), "run a compile server listening on the given socket")
+			("connect", po::value<std::string>(), "send this compile to the server listening on the given socket");
+
+		po::options_description config("Hidden options");
+		config.add(visible);
+		config.add_options()
+			("input", po::value<std::vector<std::string>>(), "specify input files");
+
+		po::positional_options_description p;
+		p.add("input", -1);
+
+		po::variables_map vm;
+		// Long options can also be given with a single dash (eg -march=native)
+		auto style = (po::command_line_style::default_style & ~po::command_line_style::allow_guessing) |
+			po::command_line_style::allow_long_disguise;
+
+		po::store(po::command_line_parser(args).options(config).positional(p).style(style).run(), vm);
+		po::notify(vm);
+
+		if (vm.count("version"))
+		{
+			std::cerr << "lcoolc version " << LCOOL_VERSION << std::endl;
+			return 1;
+		}
+
+		if (vm.count("help"))
+		{
+			std::cerr << "lcoolc [options] input files..." << std::endl;
+			std::cerr << " Compiles COOL sources into LLVM bitcode or native code" << std::endl;
+			std::cerr << visible << std::endl;
+			return 1;
+		}
+
+		lcool::logger_ostream log;
+
+		// The server ignores --connect in the arguments it is sent
+		if (vm.count("connect") && warm_program == nullptr)
+			return lcool::run_client(vm["connect"].as<std::string>(), args, log);
+
+		if (vm.count("server"))
+		{
+			if (warm_program != nullptr)
+			{
+				log.error("--server cannot be sent to a compile server");
+				return 1;
+			}
+
+			// Load the runtime once. Each request gets its own copy of it in a
+			//  forked process.
+			llvm::LLVMContext llvm_context;
+			lcool::cool_program warm(llvm_context);
+
+			return lcool::run_server(vm["server"].as<std::string>(), log, [&](const std::vector<std::string>& request)
+			{
+				int status = compile(request, &warm);
+
+				// Print any timing reports before the client is told we are finished
+				llvm::llvm_shutdown();
+				return status;
+			});
+		}
+
+		// Parse input files
+		if (!vm.count("input"))
+		{
+			log.error("no input files");
+			return 1;
+		}
+
+		unsigned opt_level = vm["optimize"].as<unsigned>();
+		if (opt_level > lcool::max_opt_level)
+		{
+			log.error(boost::format("invalid optimization level '%u'") % opt_level);
+			return 1;
+		}
+
+		output_type out_type = output_type::bitcode;
+		bool run_mode = vm.count("run");
+		if (vm.count("compile") + vm.count("assembly") + vm.count("link") + vm.count("emit-ast") + run_mode > 1)
+		{
+			log.error("only one of -c, -S, --link, --emit-ast and --run may be given");
+			return 1;
+		}
+		else if (run_mode && vm.count("output"))
+		{
+			log.error("--run does not write an output file");
+			return 1;
+		}
+		else if (vm.count("compile"))
+		{
+			out_type = output_type::object;
+		}
+		else if (vm.count("assembly"))
+		{
+			out_type = output_type::assembly;
+		}
+		else if (vm.count("link"))
+		{
+			out_type = output_type::executable;
+		}
+		else if (vm.count("emit-ast"))
+		{
+			out_type = output_type::ast;
+		}
+
+		// Setup compile time and memory profiling
+		std::ofstream trace_file;
+		if (vm.count("ftime-trace"))
+		{
+			std::string trace_filename = vm["ftime-trace"].as<std::string>();
+			trace_file.open(trace_filename, std::ios::out | std::ios::trunc);
+			if (trace_file.fail())
+			{
+				log.error(boost::format("error opening '%s': %s") % trace_filename % std::strerror(errno));
+				return 1;
+			}
+		}
+
+		profile_reporter reports(vm.count("ftime-report"), std::move(trace_file), vm.count("mem-report"));
+
+		auto inputs = vm["input"].as<std::vector<std::string>>();
+		lcool::ast::program program;
+		{
+			phase_scope phase("parse");
+			program = lcool::parse_files(inputs, log, vm["jobs"].as<unsigned>());
+		}
+
+		if (log.has_errors())
+			return 1;
 
-		if (filename == "-")
+		// Dump parse tree if requested
+		if (vm.count("parse"))
 		{
-			parse_result = lcool::parse(std::cin, "stdin", log);
+			lcool::dump_ast(std::cout, program);
+			return 0;
 		}
+
+		// Get output filename
+		std::string out_filename;
+		if (vm.count("output"))
+			out_filename = vm["output"].as<std::string>();
 		else
+			out_filename = default_output_filename(inputs[0], out_type);
+
+		// Write the binary AST instead of compiling the program
+		if (out_type == output_type::ast)
 		{
-			std::ifstream file(filename, std::ios::in | std::ios::binary);
-			if (file.fail())
+			std::error_code error;
+			llvm::raw_fd_ostream stream(out_filename, error, llvm::sys::fs::F_None);
+			if (error)
+			{
+				log.error(boost::format("error opening '%s': %s") % out_filename % error.message());
+				return 1;
+			}
+
+			phase_scope phase("write output");
+			lcool::write_ast_file(stream, lcool::flat_ast::flatten(program));
+
+			stream.flush();
+			if (stream.has_error())
 			{
-				log.error(boost::format("error opening '%s': %s") % filename % std::strerror(errno));
-				continue;
+				log.error(boost::format("error writing '%s'") % out_filename);
+				stream.clear_error();
+				return 1;
 			}
 
-			parse_result = lcool::parse(file, filename, log);
+			return 0;
 		}
 
-		program.insert(
-			program.end(),
-			std::make_move_iterator(parse_result.begin()),
-			std::make_move_iterator(parse_result.end()));
-	}
+		// Create empty cool_program
+		llvm::LLVMContext llvm_context;
+		lcool::unique_ptr<lcool::cool_program> new_program;
+		if (warm_program == nullptr)
+		{
+			new_program = lcool::make_unique<lcool::cool_program>(llvm_context);
+			warm_program = new_program.get();
+		}
 
-	if (log.has_errors())
-		return 1;
+		lcool::cool_program& output = *warm_program;
 
-	// Dump parse tree if requested
-	if (vm.count("parse"))
-	{
-		lcool::dump_ast(std::cout, program);
-		return 0;
-	}
+		// Load the attribute profile and setup instrumentation
+		lcool::attribute_profile profile;
+		if (vm.count("profile-use"))
+		{
+			if (!profile.load(vm["profile-use"].as<std::string>(), log))
+				return 1;
 
-	// Create empty cool_program
-	llvm::LLVMContext llvm_context;
-	lcool::cool_program output(llvm_context);
+			output.set_profile(&profile);
+		}
 
-	// Layout program
-	lcool::layout(program, output, log);
-	if (log.has_errors())
-		return 1;
+		if (vm.count("profile-generate"))
+			output.set_profile_output(vm["profile-generate"].as<std::string>());
 
-	// Generate code
-	lcool::codegen(program, output, log);
-	if (log.has_errors())
-		return 1;
+		// Layout program
+		{
+			phase_scope phase("layout");
+			lcool::layout(program, output, log);
+		}
 
-	// Verify module
-	std::string verify_errors_str;
-	llvm::raw_string_ostream verify_errors { verify_errors_str };
+		if (log.has_errors())
+			return 1;
 
-	if (llvm::verifyModule(*output.module(), &verify_errors))
-	{
-		log.error("internal compiler error: llvm verify failed");
-		std::clog << verify_errors.str();
-		return 1;
-	}
+		// Type check program
+		lcool::typed::program typed_program;
+		{
+			phase_scope phase("typecheck");
+			typed_program = lcool::typecheck(program, output, log);
+		}
 
-	// Get output filename
-	std::string out_filename;
-	if (vm.count("output"))
-		out_filename = vm["output"].as<std::string>();
-	else if (inputs[0] == "-")
-		out_filename = "-";
-	else if (boost::algorithm::ends_with(inputs[0], ".cl"))
-		out_filename = inputs[0].substr(0, inputs[0].size() - 2) + "bc";
-	else
-		out_filename = inputs[0] + ".bc";
-
-	// Write bitcode
-	if (out_filename == "-")
-	{
-		llvm::raw_os_ostream stream(std::cout);
-		llvm::WriteBitcodeToFile(output.module(), stream);
-	}
-	else
-	{
-		std::ofstream file(out_filename, std::ios::out | std::ios::binary | std::ios::trunc);
-		if (file.fail())
+		if (log.has_errors())
+			return 1;
+
+		// Generate code
+		{
+			phase_scope phase("codegen");
+			lcool::codegen(program, typed_program, output, log, vm["jobs"].as<unsigned>());
+		}
+
+		if (log.has_errors())
+			return 1;
+
+		if (auto profiler = lcool::memory_profiler::current())
+			add_structure_statistics(*profiler, program, output);
+
+		// Verify module
+		std::string verify_errors_str;
+		llvm::raw_string_ostream verify_errors { verify_errors_str };
+
+		bool verify_failed;
+		{
+			phase_scope phase("verify");
+			verify_failed = llvm::verifyModule(*output.module(), &verify_errors);
+		}
+
+		if (verify_failed)
 		{
-			log.error(boost::format("error opening '%s': %s") % out_filename % std::strerror(errno));
+			log.error("internal compiler error: llvm verify failed");
+			std::clog << verify_errors.str();
 			return 1;
 		}
 
-		llvm::raw_os_ostream stream(file);
-		llvm::WriteBitcodeToFile(output.module(), stream);
+		// Setup the target machine for native code (the optimizer needs the
+		//  target's data layout as well)
+		lcool::unique_ptr<llvm::TargetMachine> target_machine;
+		if (out_type != output_type::bitcode || run_mode)
+		{
+			target_machine = lcool::create_target_machine(vm["march"].as<std::string>(), opt_level, log);
+			if (!target_machine)
+				return 1;
+
+			output.module()->setTargetTriple(target_machine->getTargetTriple().str());
+			output.module()->setDataLayout(target_machine->createDataLayout());
+		}
+
+		// Optimize module
+		{
+			phase_scope phase("optimize");
+			lcool::optimize(*output.module(), opt_level, vm.count("time-passes"));
+		}
+
+		// Run the program instead of writing it anywhere
+		if (run_mode)
+			return lcool::jit_run(output.release_module(), std::move(target_machine), log);
+
+		// Generate native code
+		llvm::SmallString<0> native_code;
+		if (target_machine)
+		{
+			phase_scope phase("emit native");
+			bool assembly = (out_type == output_type::assembly);
+			if (!lcool::emit_native(*output.module(), *target_machine, assembly, native_code, log))
+				return 1;
+		}
+
+		// Executables are written by the linker
+		if (out_type == output_type::executable)
+		{
+			if (out_filename == "-")
+			{
+				log.error("cannot write an executable to stdout");
+				return 1;
+			}
+
+			phase_scope phase("link");
+			return lcool::link_executable(native_code, out_filename, log) ? 0 : 1;
+		}
+
+		// Write bitcode / native code straight to the file descriptor
+		//  ("-" is stdout)
+		std::error_code error;
+		llvm::raw_fd_ostream stream(out_filename, error, llvm::sys::fs::F_None);
+		if (error)
+		{
+			log.error(boost::format("error opening '%s': %s") % out_filename % error.message());
+			return 1;
+		}
+
+		phase_scope phase("write output");
+		if (out_type == output_type::bitcode)
+			llvm::WriteBitcodeToFile(output.module(), stream);
+		else
+			stream << native_code;
+
+		stream.flush();
+		if (stream.has_error())
+		{
+			log.error(boost::format("error writing '%s'") % out_filename);
+			stream.clear_error();
+			return 1;
+		}
+
+		return 0;
 	}
+}
+
+int main(int argc, char* argv[])
+{
+	// Cleans up LLVM (and prints any timing reports) on exit
+	llvm::llvm_shutdown_obj llvm_shutdown;
 
-	return 0;
+	return compile(std::vector<std::string>(argv + 1, argv + argc), nullptr);
 }
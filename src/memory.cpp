@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/format.hpp>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+
+#include <sys/resource.h>
+
+#include "memory.hpp"
+
+namespace
+{
+	// The profiler which memory_scopes are recorded in
+	lcool::memory_profiler* current_profiler = nullptr;
+
+	// Allocation counters (only updated while counting is enabled so that
+	//  threads don't fight over them the rest of the time)
+	std::atomic<bool> counting(false);
+	std::atomic<std::uint64_t> allocation_count(0);
+	std::atomic<std::uint64_t> allocation_bytes(0);
+
+	// Formats a number of bytes in KiB
+	boost::format kib(std::uint64_t bytes)
+	{
+		return boost::format("%.1f") % (bytes / 1024.0);
+	}
+}
+
+// Replace the global allocation functions so allocations can be counted
+//  (the array and nothrow versions all end up calling these)
+void* operator new(std::size_t size)
+{
+	if (counting.load(std::memory_order_relaxed))
+	{
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	if (size == 0)
+		size = 1;
+
+	for (;;)
+	{
+		void* ptr = std::malloc(size);
+		if (ptr != nullptr)
+			return ptr;
+
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+lcool::allocation_stats lcool::allocations()
+{
+	return allocation_stats {
+		allocation_count.load(std::memory_order_relaxed),
+		allocation_bytes.load(std::memory_order_relaxed),
+	};
+}
+
+std::uint64_t lcool::peak_rss()
+{
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * std::uint64_t(1024);
+#endif
+}
+
+lcool::memory_profiler::memory_profiler()
+{
+	assert(current_profiler == nullptr);
+	current_profiler = this;
+	counting = true;
+}
+
+lcool::memory_profiler::~memory_profiler()
+{
+	counting = false;
+	current_profiler = nullptr;
+}
+
+lcool::memory_profiler* lcool::memory_profiler::current()
+{
+	return current_profiler;
+}
+
+void lcool::memory_profiler::add_phase(const char* name, allocation_stats start, std::uint64_t start_rss)
+{
+	allocation_stats end = allocations();
+	allocation_stats allocated { end.count - start.count, end.bytes - start.bytes };
+	std::uint64_t end_rss = peak_rss();
+	_phases.push_back(phase { name, allocated, end_rss > start_rss ? end_rss - start_rss : 0 });
+}
+
+void lcool::memory_profiler::add_statistic(std::string name, std::uint64_t value)
+{
+	_statistics.emplace_back(std::move(name), value);
+}
+
+void lcool::memory_profiler::write_report(std::ostream& stream) const
+{
+	allocation_stats total = allocations();
+
+	stream << "===------------------------------------------------------------===" << std::endl;
+	stream << "                        Memory report" << std::endl;
+	stream << "===------------------------------------------------------------===" << std::endl;
+	stream << "  Peak RSS: " << kib(peak_rss()) << " KiB" << std::endl;
+	stream << boost::format("  Total allocations: %u (%s KiB)") % total.count % kib(total.bytes) << std::endl;
+	stream << std::endl;
+	stream << "     Allocs   Allocated (KiB)  RSS growth (KiB)  Phase" << std::endl;
+
+	for (const phase& p : _phases)
+	{
+		stream << boost::format("  %9u  %16s  %16s  %s") %
+			p.allocated.count % kib(p.allocated.bytes) % kib(p.rss_growth) % p.name << std::endl;
+	}
+
+	if (!_statistics.empty())
+	{
+		stream << std::endl;
+		for (auto& statistic : _statistics)
+			stream << boost::format("  %-24s %u") % (statistic.first + ":") % statistic.second << std::endl;
+	}
+}
+
+lcool::memory_scope::memory_scope(const char* name)
+	: _profiler(memory_profiler::current()), _name(name)
+{
+	if (_profiler != nullptr)
+	{
+		_start = allocations();
+		_start_rss = peak_rss();
+	}
+}
+
+lcool::memory_scope::~memory_scope()
+{
+	if (_profiler != nullptr)
+		_profiler->add_phase(_name, _start, _start_rss);
+}
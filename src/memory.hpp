@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_MEMORY_HPP
+#define LCOOL_MEMORY_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lcool
+{
+	/** Number and total size of a set of allocations */
+	struct allocation_stats
+	{
+		std::uint64_t count;
+		std::uint64_t bytes;
+	};
+
+	/**
+	 * Returns the allocations made (by all threads) while a memory_profiler exists
+	 *
+	 * Only allocations made through operator new are counted. LLVM
+	 * allocates some memory with malloc directly, so that is missing.
+	 */
+	allocation_stats allocations();
+
+	/** Returns the peak resident set size of the process in bytes (or 0 if unknown) */
+	std::uint64_t peak_rss();
+
+	/**
+	 * Records the memory used by each phase of the compiler
+	 *
+	 * While a profiler exists, every memory_scope is recorded into it and
+	 * allocations are counted. Only one profiler may exist at a time.
+	 */
+	class memory_profiler
+	{
+	public:
+		/** Creates a profiler and makes it the current one */
+		memory_profiler();
+		~memory_profiler();
+
+		memory_profiler(const memory_profiler&) = delete;
+		memory_profiler& operator=(const memory_profiler&) = delete;
+
+		/** Returns the current profiler or nullptr if profiling is disabled */
+		static memory_profiler* current();
+
+		/**
+		 * Records a finished phase (normally done by memory_scope)
+		 *
+		 * The peak RSS is only ever the peak of the whole process, so each
+		 * phase records how much it grew by while the phase ran (which is 0
+		 * if an earlier phase used more memory).
+		 *
+		 * @param name      name of the phase (must have static storage)
+		 * @param start     allocations made before the phase started
+		 * @param start_rss peak RSS before the phase started
+		 */
+		void add_phase(const char* name, allocation_stats start, std::uint64_t start_rss);
+
+		/** Records the size of one of the compiler's data structures */
+		void add_statistic(std::string name, std::uint64_t value);
+
+		/** Prints the memory used by each phase and the recorded statistics */
+		void write_report(std::ostream& stream) const;
+
+	private:
+		struct phase
+		{
+			const char* name;
+			allocation_stats allocated;
+			std::uint64_t rss_growth;
+		};
+
+		std::vector<phase> _phases;
+		std::vector<std::pair<std::string, std::uint64_t>> _statistics;
+	};
+
+	/** Records the memory allocated by the enclosing scope if profiling is enabled */
+	class memory_scope
+	{
+	public:
+		/** @param name name of the phase (must have static storage) */
+		explicit memory_scope(const char* name);
+		~memory_scope();
+
+		memory_scope(const memory_scope&) = delete;
+		memory_scope& operator=(const memory_scope&) = delete;
+
+	private:
+		memory_profiler* _profiler;
+		const char* _name;
+		allocation_stats _start;
+		std::uint64_t _start_rss;
+	};
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/format.hpp>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/MCJIT.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetOptions.h>
+#include <cassert>
+
+#include "native.hpp"
+#include "timing.hpp"
+
+namespace
+{
+	// Converts an optimization level into the code generator's version
+	llvm::CodeGenOpt::Level codegen_opt_level(unsigned opt_level)
+	{
+		switch (opt_level)
+		{
+			case 0:  return llvm::CodeGenOpt::None;
+			case 1:  return llvm::CodeGenOpt::Less;
+			case 2:  return llvm::CodeGenOpt::Default;
+			default: return llvm::CodeGenOpt::Aggressive;
+		}
+	}
+
+	// Returns the feature string of the host CPU
+	std::string host_cpu_features()
+	{
+		llvm::StringMap<bool> host_features;
+		llvm::SubtargetFeatures features;
+
+		if (llvm::sys::getHostCPUFeatures(host_features))
+		{
+			for (auto& feature : host_features)
+				features.AddFeature(feature.first(), feature.second);
+		}
+
+		return features.getString();
+	}
+}
+
+lcool::unique_ptr<llvm::TargetMachine> lcool::create_target_machine(
+	const std::string& cpu, unsigned opt_level, lcool::logger& log)
+{
+	// Only the host target is ever needed
+	llvm::InitializeNativeTarget();
+	llvm::InitializeNativeTargetAsmPrinter();
+
+	std::string triple = llvm::sys::getDefaultTargetTriple();
+	std::string error;
+	const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
+	if (target == nullptr)
+	{
+		log.error(boost::format("cannot generate code for '%s': %s") % triple % error);
+		return nullptr;
+	}
+
+	// Lookup the host CPU if requested
+	std::string cpu_name = cpu;
+	std::string features;
+	if (cpu == "native")
+	{
+		cpu_name = llvm::sys::getHostCPUName();
+		features = host_cpu_features();
+	}
+
+	// Always generate position independent code so the result can be linked
+	//  into PIE executables
+	llvm::TargetOptions options;
+	unique_ptr<llvm::TargetMachine> machine(target->createTargetMachine(
+		triple,
+		cpu_name,
+		features,
+		options,
+		llvm::Reloc::PIC_,
+		llvm::CodeModel::Default,
+		codegen_opt_level(opt_level)));
+
+	if (!machine)
+		log.error(boost::format("cannot generate code for '%s' (cpu '%s')") % triple % cpu_name);
+
+	return machine;
+}
+
+bool lcool::emit_native(
+	llvm::Module& module,
+	llvm::TargetMachine& machine,
+	bool assembly,
+	llvm::SmallVectorImpl<char>& output,
+	lcool::logger& log)
+{
+	llvm::raw_svector_ostream stream(output);
+	llvm::legacy::PassManager passes;
+
+	auto file_type = assembly ?
+		llvm::TargetMachine::CGFT_AssemblyFile :
+		llvm::TargetMachine::CGFT_ObjectFile;
+
+	if (machine.addPassesToEmitFile(passes, stream, file_type))
+	{
+		log.error("target does not support emitting this type of file");
+		return false;
+	}
+
+	passes.run(module);
+	return true;
+}
+
+bool lcool::link_executable(llvm::StringRef object, const std::string& out_filename, lcool::logger& log)
+{
+	// Write the object into a temporary file
+	int object_fd;
+	llvm::SmallString<128> object_filename;
+	if (auto error = llvm::sys::fs::createTemporaryFile("lcool", "o", object_fd, object_filename))
+	{
+		log.error("error creating temporary file: " + error.message());
+		return false;
+	}
+
+	llvm::FileRemover object_remover(object_filename);
+	{
+		llvm::raw_fd_ostream object_stream(object_fd, true);
+		object_stream << object;
+	}
+
+	// Let the C compiler driver find the C library and startup files
+	auto linker = llvm::sys::findProgramByName("cc");
+	if (!linker)
+	{
+		log.error("cannot find the system linker 'cc': " + linker.getError().message());
+		return false;
+	}
+
+	const char* args[] = {
+		linker->c_str(),
+		"-o", out_filename.c_str(),
+		object_filename.c_str(),
+		nullptr
+	};
+
+	std::string error;
+	int status = llvm::sys::ExecuteAndWait(*linker, args, nullptr, nullptr, 0, 0, &error);
+	if (status != 0)
+	{
+		if (error.empty())
+			log.error(boost::format("linker exited with status %d") % status);
+		else
+			log.error("error running linker: " + error);
+		return false;
+	}
+
+	return true;
+}
+
+int lcool::jit_run(
+	lcool::unique_ptr<llvm::Module> module,
+	lcool::unique_ptr<llvm::TargetMachine> machine,
+	lcool::logger& log)
+{
+	std::string error;
+	llvm::Module* module_ptr = module.get();
+
+	unique_ptr<llvm::ExecutionEngine> engine(llvm::EngineBuilder(std::move(module))
+		.setEngineKind(llvm::EngineKind::JIT)
+		.setErrorStr(&error)
+		.create(machine.release()));
+
+	if (!engine)
+	{
+		log.error("error creating JIT compiler: " + error);
+		return 1;
+	}
+
+	llvm::Function* main_func = module_ptr->getFunction("main");
+	assert(main_func != nullptr);
+
+	{
+		time_scope timer("jit compile");
+		engine->finalizeObject();
+	}
+
+	return engine->runFunctionAsMain(main_func, { module_ptr->getModuleIdentifier() }, nullptr);
+}
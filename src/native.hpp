@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_NATIVE_HPP
+#define LCOOL_NATIVE_HPP
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+#include <string>
+
+#include "logger.hpp"
+#include "smart_ptr.hpp"
+
+namespace lcool
+{
+	/**
+	 * Creates a target machine which generates code for the host
+	 *
+	 * The module which is going to be compiled should have its target triple
+	 * and data layout set from the returned machine before it is optimized.
+	 *
+	 * @param cpu       CPU to generate code for ("native" for the host CPU, or
+	 *                  an empty string for a generic CPU)
+	 * @param opt_level optimization level used by the code generator
+	 * @param log       logger to log any errors to
+	 * @return the new target machine or nullptr on error
+	 */
+	unique_ptr<llvm::TargetMachine> create_target_machine(
+		const std::string& cpu, unsigned opt_level, logger& log);
+
+	/**
+	 * Compiles a module into native assembly or an object file
+	 *
+	 * @param module   module to compile
+	 * @param machine  target machine to compile with
+	 * @param assembly write assembly instead of an object file
+	 * @param output   buffer to append the result to
+	 * @param log      logger to log any errors to
+	 * @return true on success
+	 */
+	bool emit_native(
+		llvm::Module& module,
+		llvm::TargetMachine& machine,
+		bool assembly,
+		llvm::SmallVectorImpl<char>& output,
+		logger& log);
+
+	/**
+	 * Links an object file into a standalone executable
+	 *
+	 * The object must contain the entire program (including the runtime).
+	 * The system C compiler is used to link it against the C library.
+	 *
+	 * @param object       content of the object file
+	 * @param out_filename filename of the executable to write
+	 * @param log          logger to log any errors to
+	 * @return true on success
+	 */
+	bool link_executable(llvm::StringRef object, const std::string& out_filename, logger& log);
+
+	/**
+	 * Compiles a program in memory using the JIT and runs it
+	 *
+	 * The program's main function is run in this process, so it shares
+	 * stdin / stdout with the compiler. If the program aborts, this function
+	 * never returns.
+	 *
+	 * @param module  module containing the entire program
+	 * @param machine target machine to compile with (see create_target_machine)
+	 * @param log     logger to log any errors to
+	 * @return the exit status of the program
+	 */
+	int jit_run(unique_ptr<llvm::Module> module, unique_ptr<llvm::TargetMachine> machine, logger& log);
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Pass.h>
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <cassert>
+
+#include "optimize.hpp"
+
+void lcool::optimize(llvm::Module& module, unsigned level, bool time_passes)
+{
+	assert(level <= max_opt_level);
+
+	// -O0 leaves the module exactly as codegen wrote it
+	if (level == 0)
+		return;
+
+	// The pass timers are printed by llvm_shutdown
+	llvm::TimePassesIsEnabled = time_passes;
+
+	// Use the standard pipelines, but with the full inliner at every level
+	//  so that the inlinehint runtime helpers (refcount_inc, null_check,
+	//  etc) are inlined into the generated code
+	llvm::PassManagerBuilder builder;
+	builder.OptLevel = level;
+	builder.SizeLevel = 0;
+	builder.Inliner = llvm::createFunctionInliningPass(level, 0);
+	builder.LoopVectorize = (level > 2);
+	builder.SLPVectorize = (level > 2);
+
+	llvm::legacy::FunctionPassManager function_passes(&module);
+	llvm::legacy::PassManager module_passes;
+
+	// We always have the whole program, so everything except main can be
+	//  made internal. This lets the module passes drop any runtime functions
+	//  which are never used.
+	module_passes.add(llvm::createInternalizePass({ "main" }));
+
+	builder.populateFunctionPassManager(function_passes);
+	builder.populateModulePassManager(module_passes);
+
+	// Run function passes (mem2reg, etc) over each function first
+	function_passes.doInitialization();
+	for (llvm::Function& func : module)
+		function_passes.run(func);
+	function_passes.doFinalization();
+
+	// Then run the interprocedural passes
+	module_passes.run(module);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_OPTIMIZE_HPP
+#define LCOOL_OPTIMIZE_HPP
+
+#include <llvm/IR/Module.h>
+
+namespace lcool
+{
+	/** Highest optimization level accepted by optimize */
+	const unsigned max_opt_level = 3;
+
+	/**
+	 * Runs the LLVM optimization pipeline over a complete program
+	 *
+	 * The module must be a whole program (containing the runtime and a main
+	 * function) since everything except main is internalized so that unused
+	 * runtime functions can be discarded and the rest inlined.
+	 *
+	 * @param module      module to optimize (must already be verified)
+	 * @param level       optimization level (0 to max_opt_level)
+	 * @param time_passes print the time taken by each pass to stderr on exit
+	 */
+	void optimize(llvm::Module& module, unsigned level, bool time_passes = false);
+}
+
+#endif
@@ -15,16 +15,28 @@
  * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <boost/format.hpp>
+#include <llvm/Support/MemoryBuffer.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <istream>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "ast.hpp"
+#include "ast_file.hpp"
 #include "lexer.hpp"
 #include "logger.hpp"
 #include "parser.hpp"
 #include "smart_ptr.hpp"
+#include "source_manager.hpp"
+#include "timing.hpp"
 
 namespace ast = lcool::ast;
 
@@ -33,9 +45,6 @@ using lcool::parse_error;
 using lcool::token;
 using lcool::token_type;
 
-using lcool::make_shared;
-using lcool::make_unique;
-using lcool::shared_ptr;
 using lcool::unique_ptr;
 
 // ########################
@@ -47,7 +56,7 @@ namespace
 	class parser
 	{
 	public:
-		parser(std::istream& input, shared_ptr<const std::string>& filename, lcool::logger& log);
+		parser(llvm::StringRef input, lcool::location start, lcool::logger& log);
 		ast::program parse();
 
 	private:
@@ -57,35 +66,45 @@ namespace
 		ast::method    parse_method();
 
 		// Expression parsers
-		unique_ptr<ast::expr> parse_expr();
-		unique_ptr<ast::expr> parse_expr_add();
-		unique_ptr<ast::expr> parse_expr_mult();
-		unique_ptr<ast::expr> parse_expr_isvoid();
-		unique_ptr<ast::expr> parse_expr_dispatch();
-		unique_ptr<ast::expr> parse_expr_base();
-
-		unique_ptr<ast::expr> parse_expr_not();
-		unique_ptr<ast::expr> parse_expr_let();
-		unique_ptr<ast::expr> parse_expr_lparen();
-		unique_ptr<ast::expr> parse_expr_if();
-		unique_ptr<ast::expr> parse_expr_while();
-		unique_ptr<ast::expr> parse_expr_block();
-		unique_ptr<ast::expr> parse_expr_case();
-		unique_ptr<ast::expr> parse_expr_new();
-		unique_ptr<ast::expr> parse_expr_identifier();
-		void parse_dispatch_tail(unique_ptr<ast::dispatch>& dispatch);
+		//  The parsers for parts of an expression return NULL when they
+		//  have pushed a construct which is waiting for a subexpression
+		ast::expr* parse_expr();
+		ast::expr* parse_operand();
+		ast::expr* parse_postfix(ast::expr* object);
+		ast::expr* parse_dispatch_head(ast::dispatch* dispatch);
+		ast::expr* parse_let_vars(bool next);
+		void parse_case_branch_head();
+
+		// Pops operators which bind at least as tightly as the given
+		//  precedence level, giving value to the innermost one
+		ast::expr* reduce_operators(ast::expr* value, std::size_t base, unsigned level);
+
+		// Gives a complete subexpression to the construct on top of the
+		//  pending stack
+		ast::expr* finish_pending(ast::expr* value);
 
 		// Literal parsers
-		unique_ptr<ast::expr> parse_boolean();
-		unique_ptr<ast::expr> parse_integer();
-		unique_ptr<ast::expr> parse_string();
+		ast::expr* parse_boolean();
+		ast::expr* parse_integer();
+		ast::expr* parse_string();
 
-		// Construct an expression and moves the location in the lookahead token into it
+		// Construct an expression in the program's arena using the location
+		//  of the lookahead token
 		template <typename T>
-		unique_ptr<T> make_expr()
+		T* make_expr()
 		{
-			auto result = make_unique<T>();
-			result->loc = std::move(lookahead.loc);
+			T* result = program.nodes().create<T>();
+			result->loc = lookahead.loc;
+			return result;
+		}
+
+		// Moves the nodes at the end of a pending list into the program's arena
+		template <typename T>
+		ast::node_list<T> make_list(std::vector<T>& items, std::size_t start)
+		{
+			std::size_t size = items.size() - start;
+			ast::node_list<T> result(program.nodes().copy_array(items.data() + start, size), size);
+			items.resize(start);
 			return result;
 		}
 
@@ -102,15 +121,61 @@ namespace
 		// Lexer and two lookahead tokens
 		lexer my_lexer;
 		token lookahead, lookahead2;
+
+		// Program being parsed (which owns all the expressions)
+		ast::program program;
+
+		// Types of construct waiting for a subexpression
+		enum class pending_type : std::uint8_t
+		{
+			unary,              // isvoid / negate
+			binary,             // right hand side of a binary operator
+			logical_not,
+			assign,
+			let_init,           // initial value of the last let variable
+			let_body,
+			paren,
+			if_predicate,
+			if_true,
+			if_false,
+			loop_predicate,
+			loop_body,
+			block,              // next statement
+			case_value,
+			case_branch,        // body of the last branch
+			arguments,          // next dispatch argument
+		};
+
+		struct pending_expr
+		{
+			pending_type type;
+
+			// Precedence level of binary operators
+			unsigned level;
+
+			// Expression being built (NULL for parentheses)
+			ast::expr* node;
+
+			// Index of the first item of this construct in its pending list
+			std::size_t start;
+		};
+
+		// Constructs waiting for subexpressions and the lists they are
+		//  collecting (shared between every construct)
+		std::vector<pending_expr> pending;
+		std::vector<ast::expr*> pending_exprs;
+		std::vector<ast::attribute> pending_vars;
+		std::vector<ast::type_case_branch> pending_branches;
 	};
+
 }
 
 // ########################
 // Top-Level Parsers
 // ########################
 
-parser::parser(std::istream& input, shared_ptr<const std::string>& filename, lcool::logger& log)
-	: log(log), my_lexer(input, filename)
+parser::parser(llvm::StringRef input, lcool::location start, lcool::logger& log)
+	: log(log), my_lexer(input, start)
 {
 	// Get first 2 tokens
 	consume();
@@ -119,17 +184,15 @@ parser::parser(std::istream& input, shared_ptr<const std::string>& filename, lco
 
 ast::program parser::parse()
 {
-	ast::program result;
-
 	// Consume all the classes
 	while (lookahead.type == token_type::kw_class)
 	{
-		result.push_back(parse_class());
+		program.push_back(parse_class());
 	}
 
 	// Must end with EOF
 	consume(token_type::eof);
-	return result;
+	return std::move(program);
 }
 
 ast::cls parser::parse_class()
@@ -138,10 +201,10 @@ ast::cls parser::parse_class()
 
 	// Extract class header
 	result.loc  = consume(token_type::kw_class).loc;
-	result.name = consume(token_type::type).value;
+	result.name = consume(token_type::type).name;
 	if (optional(token_type::kw_inherits))
 	{
-		result.parent = consume(token_type::type).value;
+		result.parent = consume(token_type::type).name;
 	}
 
 	// Extract features
@@ -176,8 +239,8 @@ ast::attribute parser::parse_attribute()
 
 	// Extract location and type
 	result.loc  = std::move(name.loc);
-	result.name = std::move(name.value);
-	result.type = consume(token_type::type).value;
+	result.name = name.name;
+	result.type = consume(token_type::type).name;
 
 	// Extract initial value
 	if (optional(token_type::assign))
@@ -193,7 +256,7 @@ ast::method parser::parse_method()
 	token name = consume(token_type::id);
 
 	result.loc  = std::move(name.loc);
-	result.name = std::move(name.value);
+	result.name = name.name;
 	consume(token_type::lparen);
 
 	// Extract parameters
@@ -213,7 +276,7 @@ ast::method parser::parse_method()
 		token type_token = consume(token_type::type);
 
 		result.params.push_back(
-			std::make_pair(std::move(name_token.value), std::move(type_token.value)));
+			std::make_pair(name_token.name, type_token.name));
 	}
 	while (optional(token_type::comma));
 
@@ -221,7 +284,7 @@ ast::method parser::parse_method()
 
 	// Extract return type and body
 	consume(token_type::colon);
-	result.type = consume(token_type::type).value;
+	result.type = consume(token_type::type).name;
 	consume(token_type::lbraket);
 	result.body = parse_expr();
 	consume(token_type::rbraket);
@@ -233,155 +296,188 @@ ast::method parser::parse_method()
 // Expression Parsers
 // ########################
 
-unique_ptr<ast::expr> parser::parse_expr()
-{
-	auto left = parse_expr_add();
+// Expressions are parsed without recursion so that arbitrarily deep
+//  expressions only use a fixed amount of native stack. Every construct
+//  which is waiting for a subexpression is kept on the pending stack:
+//   - unary and binary operators (reduced by precedence when an operator
+//      or the end of an expression is found)
+//   - everything else which contains a whole expression (parentheses,
+//      let, if, while, blocks, etc). These are finished when the
+//      subexpression ends and then either produce a value or wait for
+//      another subexpression.
+//
+// Tokens are consumed in exactly the same order as a recursive descent
+//  parser would, so all locations and errors are the same.
+//
+// Only the parser is free of recursion. The later passes (flattening,
+//  dumping, type checking and code generation) still recurse over the
+//  AST, so the depth of nested expressions the whole compiler can handle
+//  is still bounded by the native stack. Parentheses do not create AST
+//  nodes, so they can be nested to any depth.
 
-	for (;;)
+namespace
+{
+	// Returns the binary operation and precedence level of an operator token
+	//  (returns false for other tokens)
+	bool binary_operator(token_type type, ast::compute_binary_type& op, unsigned& level)
 	{
-		// Get type of operator
-		ast::compute_binary_type op_type;
-
-		switch (lookahead.type)
+		switch (type)
 		{
-			case token_type::less_equal: op_type = ast::compute_binary_type::less_or_equal; break;
-			case token_type::less:       op_type = ast::compute_binary_type::less; break;
-			case token_type::equal:      op_type = ast::compute_binary_type::equal; break;
-			default:
-				return left;
+			case token_type::less_equal: op = ast::compute_binary_type::less_or_equal; level = 0; return true;
+			case token_type::less:       op = ast::compute_binary_type::less;          level = 0; return true;
+			case token_type::equal:      op = ast::compute_binary_type::equal;         level = 0; return true;
+			case token_type::plus:       op = ast::compute_binary_type::add;           level = 1; return true;
+			case token_type::minus:      op = ast::compute_binary_type::subtract;      level = 1; return true;
+			case token_type::times:      op = ast::compute_binary_type::multiply;      level = 2; return true;
+			case token_type::divide:     op = ast::compute_binary_type::divide;        level = 2; return true;
+			default:                     return false;
 		}
-
-		// Create expression
-		auto new_left = make_expr<ast::compute_binary>();
-		consume();
-		new_left->op    = op_type;
-		new_left->left  = std::move(left);
-		new_left->right = parse_expr_add();
-		left            = std::move(new_left);
 	}
 }
 
-unique_ptr<ast::expr> parser::parse_expr_add()
+ast::expr* parser::parse_expr()
 {
-	auto left = parse_expr_mult();
+	// Only pending constructs above here belong to this expression
+	std::size_t base = pending.size();
 
 	for (;;)
 	{
-		// Get type of operator
-		ast::compute_binary_type op_type;
+		// Parse the start of an operand
+		ast::expr* value = parse_operand();
 
-		switch (lookahead.type)
+		// Handle everything after a complete operand until another operand
+		//  is needed
+		while (value)
 		{
-			case token_type::plus:  op_type = ast::compute_binary_type::add; break;
-			case token_type::minus: op_type = ast::compute_binary_type::subtract; break;
-			default:
-				return left;
-		}
-
-		// Create expression
-		auto new_left = make_expr<ast::compute_binary>();
-		consume();
-		new_left->op    = op_type;
-		new_left->left  = std::move(left);
-		new_left->right = parse_expr_mult();
-		left            = std::move(new_left);
-	}
-}
+			value = parse_postfix(value);
+			if (!value)
+				break;
 
-unique_ptr<ast::expr> parser::parse_expr_mult()
-{
-	auto left = parse_expr_isvoid();
+			ast::compute_binary_type op;
+			unsigned level;
+			if (binary_operator(lookahead.type, op, level))
+			{
+				// Left associative, so reduce operators of the same precedence first
+				value = reduce_operators(value, base, level);
+
+				auto binary = make_expr<ast::compute_binary>();
+				consume();
+				binary->op   = op;
+				binary->left = value;
+				pending.push_back(pending_expr { pending_type::binary, level, binary, 0 });
+				break;
+			}
 
-	for (;;)
-	{
-		// Get type of operator
-		ast::compute_binary_type op_type;
+			// This is the end of a whole expression
+			value = reduce_operators(value, base, 0);
+			if (pending.size() == base)
+				return value;
 
-		switch (lookahead.type)
-		{
-			case token_type::times:  op_type = ast::compute_binary_type::multiply; break;
-			case token_type::divide: op_type = ast::compute_binary_type::divide; break;
-			default:
-				return left;
+			value = finish_pending(value);
 		}
-
-		// Create expression
-		auto new_left = make_expr<ast::compute_binary>();
-		consume();
-		new_left->op    = op_type;
-		new_left->left  = std::move(left);
-		new_left->right = parse_expr_isvoid();
-		left            = std::move(new_left);
 	}
 }
 
-unique_ptr<ast::expr> parser::parse_expr_isvoid()
+ast::expr* parser::parse_operand()
 {
-	ast::compute_unary_type unary_type;
-
-	// Detect isvoid and negate
 	switch (lookahead.type)
 	{
 		case token_type::kw_isvoid:
-			unary_type = ast::compute_unary_type::isvoid;
-			break;
-
 		case token_type::negate:
-			unary_type = ast::compute_unary_type::negate;
-			break;
-
-		default:
-			return parse_expr_dispatch();
-	}
-
-	// Create unary expression
-	auto result = make_expr<ast::compute_unary>();
+		{
+			auto result = make_expr<ast::compute_unary>();
+			result->op = (lookahead.type == token_type::kw_isvoid) ?
+				ast::compute_unary_type::isvoid : ast::compute_unary_type::negate;
 
-	consume();
-	result->op   = unary_type;
-	result->body = parse_expr_isvoid();
+			consume();
+			pending.push_back(pending_expr { pending_type::unary, 0, result, 0 });
+			return nullptr;
+		}
 
-	return std::move(result);
-}
+		case token_type::kw_not:
+		{
+			auto result = make_expr<ast::compute_unary>();
+			consume(token_type::kw_not);
+			result->op = ast::compute_unary_type::logical_not;
+			pending.push_back(pending_expr { pending_type::logical_not, 0, result, 0 });
+			return nullptr;
+		}
 
-unique_ptr<ast::expr> parser::parse_expr_dispatch()
-{
-	auto left = parse_expr_base();
+		case token_type::kw_let:
+		{
+			auto result = make_expr<ast::let>();
+			consume(token_type::kw_let);
+			pending.push_back(pending_expr { pending_type::let_init, 0, result, pending_vars.size() });
+			return parse_let_vars(false);
+		}
 
-	while (lookahead.type == token_type::at ||
-	       lookahead.type == token_type::dot)
-	{
-		auto new_left = make_expr<ast::dispatch>();
-		new_left->object = std::move(left);
+		case token_type::lparen:
+			consume(token_type::lparen);
+			pending.push_back(pending_expr { pending_type::paren, 0, nullptr, 0 });
+			return nullptr;
 
-		// Extract object type
-		if (optional(token_type::at))
-			new_left->object_type = consume(token_type::type).value;
+		case token_type::kw_if:
+		{
+			auto result = make_expr<ast::conditional>();
+			consume(token_type::kw_if);
+			pending.push_back(pending_expr { pending_type::if_predicate, 0, result, 0 });
+			return nullptr;
+		}
 
-		consume(token_type::dot);
+		case token_type::kw_while:
+		{
+			auto result = make_expr<ast::loop>();
+			consume(token_type::kw_while);
+			pending.push_back(pending_expr { pending_type::loop_predicate, 0, result, 0 });
+			return nullptr;
+		}
 
-		// Parse dispatch tail
-		parse_dispatch_tail(new_left);
-		left = std::move(new_left);
-	}
+		case token_type::lbraket:
+		{
+			auto result = make_expr<ast::block>();
+			consume(token_type::lbraket);
+			pending.push_back(pending_expr { pending_type::block, 0, result, pending_exprs.size() });
+			return nullptr;
+		}
 
-	return left;
-}
+		case token_type::kw_case:
+		{
+			auto result = make_expr<ast::type_case>();
+			consume(token_type::kw_case);
+			pending.push_back(pending_expr { pending_type::case_value, 0, result, pending_branches.size() });
+			return nullptr;
+		}
 
-unique_ptr<ast::expr> parser::parse_expr_base()
-{
-	switch (lookahead.type)
-	{
-		case token_type::kw_not:   return parse_expr_not();
-		case token_type::kw_let:   return parse_expr_let();
+		case token_type::kw_new:
+		{
+			auto result = make_expr<ast::new_object>();
+			consume(token_type::kw_new);
+			result->type = consume(token_type::type).name;
+			return result;
+		}
 
-		case token_type::lparen:   return parse_expr_lparen();
-		case token_type::kw_if:    return parse_expr_if();
-		case token_type::kw_while: return parse_expr_while();
-		case token_type::lbraket:  return parse_expr_block();
-		case token_type::kw_case:  return parse_expr_case();
-		case token_type::kw_new:   return parse_expr_new();
-		case token_type::id:       return parse_expr_identifier();
+		case token_type::id:
+			if (lookahead2.type == token_type::assign)
+			{
+				// Assignment
+				auto result = make_expr<ast::assign>();
+				result->id = consume(token_type::id).name;
+				consume(token_type::assign);
+				pending.push_back(pending_expr { pending_type::assign, 0, result, 0 });
+				return nullptr;
+			}
+			else if (lookahead2.type == token_type::lparen)
+			{
+				// Dispatch to self
+				return parse_dispatch_head(make_expr<ast::dispatch>());
+			}
+			else
+			{
+				// Read identifier
+				auto result = make_expr<ast::identifier>();
+				result->id = consume(token_type::id).name;
+				return result;
+			}
 
 		case token_type::integer:  return parse_integer();
 		case token_type::string:   return parse_string();
@@ -393,187 +489,217 @@ unique_ptr<ast::expr> parser::parse_expr_base()
 	}
 }
 
-unique_ptr<ast::expr> parser::parse_expr_not()
+ast::expr* parser::parse_postfix(ast::expr* object)
 {
-	auto result = make_expr<ast::compute_unary>();
-
-	consume(token_type::kw_not);
-	result->op   = ast::compute_unary_type::logical_not;
-	result->body = parse_expr();
-
-	return std::move(result);
-}
+	while (lookahead.type == token_type::at ||
+	       lookahead.type == token_type::dot)
+	{
+		auto dispatch = make_expr<ast::dispatch>();
+		dispatch->object = object;
 
-unique_ptr<ast::expr> parser::parse_expr_let()
-{
-	auto result = make_expr<ast::let>();
+		// Extract object type
+		if (optional(token_type::at))
+			dispatch->object_type = consume(token_type::type).name;
 
-	consume(token_type::kw_let);
+		consume(token_type::dot);
 
-	do
-	{
-		result->vars.push_back(parse_attribute());
+		object = parse_dispatch_head(dispatch);
+		if (!object)
+			return nullptr;
 	}
-	while (optional(token_type::comma));
-
-	consume(token_type::kw_in);
-	result->body = parse_expr();
 
-	return std::move(result);
+	return object;
 }
 
-unique_ptr<ast::expr> parser::parse_expr_lparen()
+ast::expr* parser::parse_dispatch_head(ast::dispatch* dispatch)
 {
+	dispatch->method_name = consume(token_type::id).name;
 	consume(token_type::lparen);
-	auto result = parse_expr();
-	consume(token_type::rparen);
-	return result;
-}
 
-unique_ptr<ast::expr> parser::parse_expr_if()
-{
-	auto result = make_expr<ast::conditional>();
+	// Permit no arguments
+	if (optional(token_type::rparen))
+		return dispatch;
 
-	consume(token_type::kw_if);
-	result->predicate = parse_expr();
-	consume(token_type::kw_then);
-	result->if_true   = parse_expr();
-	consume(token_type::kw_else);
-	result->if_false  = parse_expr();
-	consume(token_type::kw_fi);
-
-	return std::move(result);
+	pending.push_back(pending_expr { pending_type::arguments, 0, dispatch, pending_exprs.size() });
+	return nullptr;
 }
 
-unique_ptr<ast::expr> parser::parse_expr_while()
+ast::expr* parser::parse_let_vars(bool next)
 {
-	auto result = make_expr<ast::loop>();
-
-	consume(token_type::kw_while);
-	result->predicate = parse_expr();
-	consume(token_type::kw_loop);
-	result->body      = parse_expr();
-	consume(token_type::kw_pool);
-
-	return std::move(result);
-}
-
-unique_ptr<ast::expr> parser::parse_expr_block()
-{
-	auto result = make_expr<ast::block>();
-
-	consume(token_type::lbraket);
+	// The let is on the top of the pending stack
+	pending_expr& let = pending.back();
 
-	do
+	while (!next || optional(token_type::comma))
 	{
-		result->statements.push_back(parse_expr());
-		consume(token_type::semicolon);
-	}
-	while (!optional(token_type::rbraket));
+		ast::attribute var;
 
-	return std::move(result);
-}
-
-unique_ptr<ast::expr> parser::parse_expr_case()
-{
-	auto result = make_expr<ast::type_case>();
-
-	consume(token_type::kw_case);
-	result->value = parse_expr();
-	consume(token_type::kw_of);
+		token name = consume(token_type::id);
+		consume(token_type::colon);
 
-	do
-	{
-		ast::type_case_branch branch;
+		var.loc  = name.loc;
+		var.name = name.name;
+		var.type = consume(token_type::type).name;
+		pending_vars.push_back(var);
 
-		branch.id = consume(token_type::id).value;
-		consume(token_type::colon);
-		branch.type = consume(token_type::type).value;
-		consume(token_type::case_arrow);
-		branch.body = parse_expr();
-		consume(token_type::semicolon);
+		// Wait for the initial value
+		if (optional(token_type::assign))
+			return nullptr;
 
-		result->branches.push_back(std::move(branch));
+		next = true;
 	}
-	while (!optional(token_type::kw_esac));
 
-	return std::move(result);
+	static_cast<ast::let*>(let.node)->vars = make_list(pending_vars, let.start);
+	consume(token_type::kw_in);
+	let.type = pending_type::let_body;
+	return nullptr;
 }
 
-unique_ptr<ast::expr> parser::parse_expr_new()
+void parser::parse_case_branch_head()
 {
-	auto result = make_expr<ast::new_object>();
+	ast::type_case_branch branch;
 
-	consume(token_type::kw_new);
-	result->type = consume(token_type::type).value;
+	branch.id = consume(token_type::id).name;
+	consume(token_type::colon);
+	branch.type = consume(token_type::type).name;
+	consume(token_type::case_arrow);
 
-	return std::move(result);
+	pending_branches.push_back(branch);
 }
 
-unique_ptr<ast::expr> parser::parse_expr_identifier()
+ast::expr* parser::reduce_operators(ast::expr* value, std::size_t base, unsigned level)
 {
-	if (lookahead2.type == token_type::assign)
+	while (pending.size() > base)
 	{
-		// Assignment
-		auto result = make_expr<ast::assign>();
+		pending_expr& top = pending.back();
 
-		result->id    = consume(token_type::id).value;
-		consume(token_type::assign);
-		result->value = parse_expr();
+		if (top.type == pending_type::unary)
+			static_cast<ast::compute_unary*>(top.node)->body = value;
+		else if (top.type == pending_type::binary && top.level >= level)
+			static_cast<ast::compute_binary*>(top.node)->right = value;
+		else
+			break;
 
-		return std::move(result);
-	}
-	else if (lookahead2.type == token_type::lparen)
-	{
-		// Dispatch to self
-		auto result = make_expr<ast::dispatch>();
-		parse_dispatch_tail(result);
-		return std::move(result);
-	}
-	else
-	{
-		// Read identifier
-		auto result = make_expr<ast::identifier>();
-		result->id = consume(token_type::id).value;
-		return std::move(result);
+		value = top.node;
+		pending.pop_back();
 	}
+
+	return value;
 }
 
-void parser::parse_dispatch_tail(unique_ptr<ast::dispatch>& dispatch)
+ast::expr* parser::finish_pending(ast::expr* value)
 {
-	// Extract method name and arguments
-	dispatch->method_name = consume(token_type::id).value;
-	consume(token_type::lparen);
+	pending_expr& top = pending.back();
+	ast::expr* result = top.node;
 
-	do
+	switch (top.type)
 	{
-		// Handle first argument
-		if (dispatch->arguments.empty())
+	case pending_type::logical_not:
+		static_cast<ast::compute_unary*>(result)->body = value;
+		break;
+
+	case pending_type::assign:
+		static_cast<ast::assign*>(result)->value = value;
+		break;
+
+	case pending_type::let_init:
+		pending_vars.back().initial = value;
+		return parse_let_vars(true);
+
+	case pending_type::let_body:
+		static_cast<ast::let*>(result)->body = value;
+		break;
+
+	case pending_type::paren:
+		consume(token_type::rparen);
+		result = value;
+		break;
+
+	case pending_type::if_predicate:
+		static_cast<ast::conditional*>(result)->predicate = value;
+		consume(token_type::kw_then);
+		top.type = pending_type::if_true;
+		return nullptr;
+
+	case pending_type::if_true:
+		static_cast<ast::conditional*>(result)->if_true = value;
+		consume(token_type::kw_else);
+		top.type = pending_type::if_false;
+		return nullptr;
+
+	case pending_type::if_false:
+		static_cast<ast::conditional*>(result)->if_false = value;
+		consume(token_type::kw_fi);
+		break;
+
+	case pending_type::loop_predicate:
+		static_cast<ast::loop*>(result)->predicate = value;
+		consume(token_type::kw_loop);
+		top.type = pending_type::loop_body;
+		return nullptr;
+
+	case pending_type::loop_body:
+		static_cast<ast::loop*>(result)->body = value;
+		consume(token_type::kw_pool);
+		break;
+
+	case pending_type::block:
+		pending_exprs.push_back(value);
+		consume(token_type::semicolon);
+		if (!optional(token_type::rbraket))
+			return nullptr;
+
+		static_cast<ast::block*>(result)->statements = make_list(pending_exprs, top.start);
+		break;
+
+	case pending_type::case_value:
+		static_cast<ast::type_case*>(result)->value = value;
+		consume(token_type::kw_of);
+		parse_case_branch_head();
+		top.type = pending_type::case_branch;
+		return nullptr;
+
+	case pending_type::case_branch:
+		pending_branches.back().body = value;
+		consume(token_type::semicolon);
+		if (!optional(token_type::kw_esac))
 		{
-			// Permit no arguments
-			if (lookahead.type == token_type::rparen)
-				break;
+			parse_case_branch_head();
+			return nullptr;
 		}
 
-		// Append argument
-		dispatch->arguments.push_back(parse_expr());
+		static_cast<ast::type_case*>(result)->branches = make_list(pending_branches, top.start);
+		break;
+
+	case pending_type::arguments:
+		pending_exprs.push_back(value);
+		if (optional(token_type::comma))
+			return nullptr;
+
+		consume(token_type::rparen);
+		static_cast<ast::dispatch*>(result)->arguments = make_list(pending_exprs, top.start);
+		break;
+
+	case pending_type::unary:
+	case pending_type::binary:
+		// Operators are always reduced first
+		break;
 	}
-	while (optional(token_type::comma));
 
-	consume(token_type::rparen);
+	pending.pop_back();
+	return result;
 }
 
-unique_ptr<ast::expr> parser::parse_boolean()
+ast::expr* parser::parse_boolean()
 {
 	auto result = make_expr<ast::constant_bool>();
 	result->value = (consume(token_type::boolean).value == "true");
-	return std::move(result);
+	return result;
 }
 
-unique_ptr<ast::expr> parser::parse_integer()
+ast::expr* parser::parse_integer()
 {
 	auto result = make_expr<ast::constant_int>();
-	std::string str_value = consume(token_type::integer).value;
+	llvm::StringRef str_value = consume(token_type::integer).value;
 	std::int32_t int_value = 0;
 
 	// Convert string to integer
@@ -585,7 +711,7 @@ unique_ptr<ast::expr> parser::parse_integer()
 		// Check for overflow
 		if (new_int_value > std::numeric_limits<int32_t>::max())
 		{
-			log.warning(result->loc, "number cannot be represented: " + str_value);
+			log.warning(result->loc, "number cannot be represented: " + str_value.str());
 			break;
 		}
 
@@ -593,19 +719,32 @@ unique_ptr<ast::expr> parser::parse_integer()
 	}
 
 	result->value = int_value;
-	return std::move(result);
+	return result;
 }
 
-unique_ptr<ast::expr> parser::parse_string()
+ast::expr* parser::parse_string()
 {
 	auto result = make_expr<ast::constant_string>();
-	std::string raw_value = consume(token_type::string).value;
+	llvm::StringRef raw_value = consume(token_type::string).value;
 	bool escaped = false;
 
-	for (char c : raw_value)
+	// Unescaping never makes the string longer, so write it straight into the arena
+	char* value = static_cast<char*>(program.nodes().allocate(raw_value.size(), 1));
+	std::size_t length = 0;
+
+	for (auto it = raw_value.begin(); it != raw_value.end(); ++it)
 	{
+		char c = *it;
 		if (escaped)
 		{
+			// An escaped line break (CR, LF or CRLF) is always stored as LF
+			if (c == '\r')
+			{
+				c = '\n';
+				if (it + 1 != raw_value.end() && it[1] == '\n')
+					++it;
+			}
+
 			// Escaped characters are copied verbatim except for some special ones
 			switch (c)
 			{
@@ -616,7 +755,7 @@ unique_ptr<ast::expr> parser::parse_string()
 				case 't': c = '\t'; break;
 			}
 
-			result->value += c;
+			value[length++] = c;
 			escaped = false;
 		}
 		else if (c == '\\')
@@ -626,11 +765,12 @@ unique_ptr<ast::expr> parser::parse_string()
 		else if (c != '"')
 		{
 			// Ignore unescaped quotes (start or end of string)
-			result->value += c;
+			value[length++] = c;
 		}
 	}
 
-	return std::move(result);
+	result->value = llvm::StringRef(value, length);
+	return result;
 }
 
 // ########################
@@ -667,21 +807,225 @@ bool parser::optional(token_type type)
 	return false;
 }
 
+// ########################
+// Parallel Parsing
+// ########################
+
+namespace
+{
+	// Smallest amount of source worth parsing on another thread
+	const std::size_t min_chunk_size = 64 * 1024;
+
+	// Returns the number of threads to use when 0 (one per CPU) is given
+	unsigned default_jobs(unsigned jobs)
+	{
+		return (jobs == 0) ? std::max(std::thread::hardware_concurrency(), 1u) : jobs;
+	}
+
+	// Calls func(i) for each i in [0, count) using up to jobs threads
+	//  (including the current thread)
+	template <typename Func>
+	void run_workers(std::size_t count, unsigned jobs, Func func)
+	{
+		// Each worker takes the next item until there are none left
+		std::atomic<std::size_t> next(0);
+		auto worker = [&]()
+		{
+			for (std::size_t i = next++; i < count; i = next++)
+				func(i);
+		};
+
+		jobs = std::min<std::size_t>(default_jobs(jobs), count);
+
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < jobs; i++)
+			threads.emplace_back(worker);
+
+		worker();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	// Replays the messages of each result in order and merges the results
+	ast::program merge_results(
+		std::vector<ast::program>& results,
+		std::vector<lcool::logger_buffer>& logs,
+		lcool::logger& log)
+	{
+		std::size_t total_classes = 0;
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			logs[i].replay(log);
+			total_classes += results[i].size();
+		}
+
+		if (results.size() == 1)
+			return std::move(results[0]);
+
+		ast::program program;
+		program.reserve(total_classes);
+
+		for (ast::program& result : results)
+			program.append(std::move(result));
+
+		return program;
+	}
+
+	// Parses some classes starting at the given location
+	ast::program parse_chunk(llvm::StringRef data, lcool::location start, lcool::logger& log)
+	{
+		try
+		{
+			return parser(data, start, log).parse();
+		}
+		catch (parse_error& e)
+		{
+			// Log error and die
+			log.error(e.loc, e.what());
+			return ast::program();
+		}
+	}
+
+	// Splits a file into roughly equal sized chunks, each starting at a class
+	//  keyword (the first chunk also contains anything before the first class)
+	//  Returns the offsets of the chunks followed by the end of the file.
+	std::vector<std::size_t> find_chunks(llvm::StringRef data, unsigned jobs)
+	{
+		std::vector<std::size_t> classes = lexer(data, lcool::location()).scan_class_keywords();
+
+		// A few chunks per thread evens out differences in parse speed
+		std::size_t chunk_count = std::min<std::size_t>(
+			std::size_t(default_jobs(jobs)) * 4,
+			data.size() / min_chunk_size);
+
+		std::vector<std::size_t> chunks { 0 };
+		for (std::size_t i = 1; i < chunk_count; i++)
+		{
+			// Use the first class after the ideal split point
+			auto iter = std::lower_bound(classes.begin(), classes.end(), data.size() * i / chunk_count);
+			if (iter != classes.end() && *iter > chunks.back())
+				chunks.push_back(*iter);
+		}
+
+		chunks.push_back(data.size());
+		return chunks;
+	}
+
+	// Parses each chunk of a file in parallel
+	//  Returns false if any chunk has an error (in which case nothing is logged)
+	bool parse_chunks(
+		llvm::StringRef data,
+		lcool::location start,
+		const std::vector<std::size_t>& chunks,
+		lcool::logger& log,
+		unsigned jobs,
+		ast::program& program)
+	{
+		std::size_t chunk_count = chunks.size() - 1;
+		std::vector<ast::program> results(chunk_count);
+		std::vector<lcool::logger_buffer> logs(chunk_count);
+
+		run_workers(chunk_count, jobs, [&](std::size_t i)
+		{
+			lcool::time_scope timer("parse chunk");
+
+			llvm::StringRef chunk = data.slice(chunks[i], chunks[i + 1]);
+			lcool::location chunk_start(start.offset() + static_cast<std::uint32_t>(chunks[i]));
+			results[i] = parse_chunk(chunk, chunk_start, logs[i]);
+		});
+
+		// An error may be caused by splitting the file in the wrong place (or
+		//  be after an earlier error which would have stopped the parser), so
+		//  leave it to the caller to parse the whole file again
+		for (lcool::logger_buffer& chunk_log : logs)
+		{
+			if (chunk_log.has_errors())
+				return false;
+		}
+
+		program = merge_results(results, logs, log);
+		return true;
+	}
+}
+
 // ########################
 // External Functions
 // ########################
 
 ast::program lcool::parse(std::istream& input, const std::string& filename, lcool::logger& log)
 {
-	try
+	// The lexer works on a contiguous buffer, so read everything first
+	std::string data(std::istreambuf_iterator<char>(input), (std::istreambuf_iterator<char>()));
+	return parse(llvm::MemoryBuffer::getMemBufferCopy(data, filename), filename, log);
+}
+
+ast::program lcool::parse(unique_ptr<llvm::MemoryBuffer> input, const std::string& filename, lcool::logger& log, unsigned jobs)
+{
+	// The source manager keeps the file so locations can be decoded later
+	llvm::StringRef data = input->getBuffer();
+	location start = source_manager::instance().add_file(filename, std::move(input));
+	if (!start.valid())
 	{
-		auto filename_shared = make_shared<const std::string>(filename);
-		return parser(input, filename_shared, log).parse();
+		log.error(boost::format("error reading '%s': too much source code") % filename);
+		return ast::program();
+	}
+
+	// Large files are split into chunks of whole classes which are parsed in parallel
+	if (jobs != 1 && data.size() >= 2 * min_chunk_size)
+	{
+		std::vector<std::size_t> chunks = find_chunks(data, jobs);
+		if (chunks.size() > 2)
+		{
+			ast::program program;
+			if (parse_chunks(data, start, chunks, log, jobs, program))
+				return program;
+
+			// Parse the whole file again to get the errors a single thread would
+			time_scope timer("parse fallback");
+			return parse_chunk(data, start, log);
+		}
 	}
-	catch (parse_error& e)
+
+	return parse_chunk(data, start, log);
+}
+
+ast::program lcool::parse_files(const std::vector<std::string>& filenames, lcool::logger& log, unsigned jobs)
+{
+	// Standard input can only be read once (and not from two threads at once)
+	if (std::count(filenames.begin(), filenames.end(), "-") > 1)
 	{
-		// Log error and die
-		log.error(e.loc, e.what());
+		log.error("standard input ('-') given more than once");
 		return ast::program();
 	}
+
+	// Each file gets its own result and log so the threads never share anything
+	std::vector<ast::program> results(filenames.size());
+	std::vector<lcool::logger_buffer> logs(filenames.size());
+
+	// Any threads left over are used to split up large files
+	jobs = default_jobs(jobs);
+	unsigned file_jobs = std::max<std::size_t>(jobs / filenames.size(), 1);
+
+	run_workers(filenames.size(), jobs, [&](size_t i)
+	{
+		const std::string& filename = filenames[i];
+		time_scope timer("parse file", filename);
+
+		// This maps the file if it can, or reads it otherwise (handling "-" too)
+		auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(filename, -1, false);
+		if (!buffer)
+		{
+			logs[i].error(boost::format("error opening '%s': %s") % filename % buffer.getError().message());
+			return;
+		}
+
+		// Binary AST files are loaded directly instead of being parsed
+		if (is_ast_file((*buffer)->getBuffer()))
+			results[i] = load_ast_file(std::move(*buffer), filename, logs[i]);
+		else
+			results[i] = parse(std::move(*buffer), (filename == "-") ? "stdin" : filename, logs[i], file_jobs);
+	});
+
+	// Replay messages in command line order and merge the results
+	return merge_results(results, logs, log);
 }
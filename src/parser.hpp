@@ -18,16 +18,23 @@
 #ifndef LCOOL_PARSER_HPP
 #define LCOOL_PARSER_HPP
 
+#include <llvm/Support/MemoryBuffer.h>
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 #include "ast.hpp"
+#include "flat_ast.hpp"
 #include "logger.hpp"
+#include "smart_ptr.hpp"
 
 namespace lcool
 {
 	/**
 	 * Parses the given input file into the output program
 	 *
+	 * The whole stream is read into memory before parsing.
+	 *
 	 * @param input    the input stream containing the file data
 	 * @param filename the name of the file being parsed
 	 * @param log      the logger to print any errors / warnings to
@@ -35,6 +42,42 @@ namespace lcool
 	 */
 	ast::program parse(std::istream& input, const std::string& filename, logger& log);
 
+	/**
+	 * Parses the given input file (already in memory) into the output program
+	 *
+	 * The contents are given to the source manager (which keeps them until
+	 * the program exits) so that locations in the file can be decoded.
+	 *
+	 * Large files are split between their classes and parsed in parallel.
+	 * The result and any errors / warnings are the same as if the file was
+	 * parsed in one go.
+	 *
+	 * @param input    the contents of the file
+	 * @param filename the name of the file being parsed
+	 * @param log      the logger to print any errors / warnings to
+	 * @param jobs     maximum number of threads to use (0 = one per CPU)
+	 * @return the list of parsed classes
+	 */
+	ast::program parse(unique_ptr<llvm::MemoryBuffer> input, const std::string& filename, logger& log, unsigned jobs = 1);
+
+	/**
+	 * Parses a list of files in parallel and merges them into one program
+	 *
+	 * Any errors / warnings are logged in the same order as if the files
+	 * were parsed one after another. The filename "-" reads from stdin
+	 * (and may only be given once).
+	 *
+	 * Regular files are memory mapped where possible. Other files (eg pipes)
+	 * are read into memory first. Binary AST files (see write_ast_file) are
+	 * loaded instead of being parsed.
+	 *
+	 * @param filenames list of files to parse
+	 * @param log       the logger to print any errors / warnings to
+	 * @param jobs      maximum number of threads to use (0 = one per CPU)
+	 * @return the list of parsed classes from all the files
+	 */
+	ast::program parse_files(const std::vector<std::string>& filenames, logger& log, unsigned jobs = 0);
+
 	/**
 	 * Prints a human readable representation of the AST to an output file
 	 *
@@ -42,6 +85,14 @@ namespace lcool
 	 * @param program program to dump
 	 */
 	void dump_ast(std::ostream& output, const ast::program& program);
+
+	/**
+	 * Prints a human readable representation of a flat AST to an output file
+	 *
+	 * @param output  file to print to
+	 * @param tree    flat tree to dump
+	 */
+	void dump_ast(std::ostream& output, const flat_ast::tree& tree);
 }
 
 #endif
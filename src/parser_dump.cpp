@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2014-2015 James Cowgill
+ * Copyright (C) 2016 James Cowgill
  *
  * LCool is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -14,107 +14,205 @@
  * You should have received a copy of the GNU General Public License
  * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
  */
-
 #include <iostream>
 
 #include "ast.hpp"
+#include "flat_ast.hpp"
 #include "parser.hpp"
 
 namespace ast = lcool::ast;
+namespace flat_ast = lcool::flat_ast;
+using flat_ast::node_kind;
 
 namespace
 {
-	// Dumps an AST (or parts of it)
-	class ast_dumper : public ast::expr_visitor
+	// Dumps a flat AST (or parts of it)
+	class ast_dumper
 	{
 	public:
-		ast_dumper(std::ostream& out, int indent = 0);
+		ast_dumper(std::ostream& out, const flat_ast::tree& tree, int indent = 0);
 
-		// Top-level dumpers
-		void dump(const ast::program&);
-		void dump(const ast::attribute&);
-		void dump(const ast::method&);
-		void dump(const ast::expr&);
+		// Dumps the whole tree
+		void dump();
 
-		// Expression dumpers
-		virtual void visit(const ast::assign&) override;
-		virtual void visit(const ast::dispatch&) override;
-		virtual void visit(const ast::conditional&) override;
-		virtual void visit(const ast::loop&) override;
-		virtual void visit(const ast::block&) override;
-		virtual void visit(const ast::let&) override;
-		virtual void visit(const ast::type_case&) override;
-		virtual void visit(const ast::new_object&) override;
-		virtual void visit(const ast::constant_bool&) override;
-		virtual void visit(const ast::constant_int&) override;
-		virtual void visit(const ast::constant_string&) override;
-		virtual void visit(const ast::identifier&) override;
-		virtual void visit(const ast::compute_unary&) override;
-		virtual void visit(const ast::compute_binary&) override;
+		// Dumps a single node and all its children
+		void dump(const flat_ast::node& n);
 
 	private:
+		// Declaration dumpers
+		void dump_class(const flat_ast::node& n);
+		void dump_attribute(const flat_ast::node& n);
+		void dump_method(const flat_ast::node& n);
+
+		// Expression dumpers
+		void dump_dispatch(const flat_ast::node& n);
+		void dump_let(const flat_ast::node& n);
+		void dump_type_case(const flat_ast::node& n);
+		void dump_string(const flat_ast::node& n);
+		void dump_unary(const flat_ast::node& n);
+		void dump_binary(const flat_ast::node& n);
+
 		// Prints the indent and returns the output stream
 		std::ostream& print_indent();
 
-		// Run dump on something while indenting it
-		template <typename T>
-		void dump_indented(const T& thing, int amount = 1)
+		// Run dump on a node while indenting it
+		void dump_indented(const flat_ast::node& n, int amount = 1)
 		{
 			indent_ += amount;
-			dump(thing);
+			dump(n);
 			indent_ -= amount;
 		}
 
-		// Current indent level and output stream
+		// Current indent level, output stream and tree being dumped
 		std::ostream& out_;
+		const flat_ast::tree& tree_;
 		int indent_;
 	};
 }
 
-ast_dumper::ast_dumper(std::ostream& out, int indent)
-	:out_(out), indent_(indent)
+ast_dumper::ast_dumper(std::ostream& out, const flat_ast::tree& tree, int indent)
+	:out_(out), tree_(tree), indent_(indent)
 {
 }
 
-void ast_dumper::dump(const ast::program& program)
+void ast_dumper::dump()
 {
-	for (const ast::cls& cls : program)
+	for (const flat_ast::node& cls : tree_.classes())
+		dump(cls);
+
+	out_ << std::flush;
+}
+
+void ast_dumper::dump(const flat_ast::node& n)
+{
+	auto child = flat_ast::children(n).begin();
+
+	switch (n.kind)
 	{
-		// Dump class
-		print_indent() << "class '" << cls.name << "' (" << cls.loc << ")\n";
-		if (cls.parent)
-			print_indent() << " inherits '" << *cls.parent << "'\n";
-
-		// Dump attributes
-		for (const ast::attribute& attribute : cls.attributes)
-			dump_indented(attribute);
-
-		// Dump methods
-		for (const ast::method& method : cls.methods)
-			dump_indented(method);
+	case node_kind::cls:
+		dump_class(n);
+		break;
+
+	case node_kind::attribute:
+		dump_attribute(n);
+		break;
+
+	case node_kind::method:
+		dump_method(n);
+		break;
+
+	case node_kind::param:
+		print_indent() << "'" << n.name << "' of type '" << n.type << "'\n";
+		break;
+
+	case node_kind::case_branch:
+		print_indent() << "branch '" << n.type << "' with name '" << n.name << "'\n";
+		dump_indented(*child);
+		break;
+
+	case node_kind::assign:
+		print_indent() << "assign to '" << n.name << "' (" << n.loc << ")\n";
+		dump_indented(*child);
+		break;
+
+	case node_kind::dispatch:
+		dump_dispatch(n);
+		break;
+
+	case node_kind::conditional:
+		print_indent() << "conditional (" << n.loc << ")\n";
+		print_indent() << " predicate\n";
+		dump_indented(*child++, 2);
+		print_indent() << " if true\n";
+		dump_indented(*child++, 2);
+		print_indent() << " if false\n";
+		dump_indented(*child, 2);
+		break;
+
+	case node_kind::loop:
+		print_indent() << "loop (" << n.loc << ")\n";
+		print_indent() << " predicate\n";
+		dump_indented(*child++, 2);
+		print_indent() << " body\n";
+		dump_indented(*child, 2);
+		break;
+
+	case node_kind::block:
+		print_indent() << "block (" << n.loc << ")\n";
+		for (const flat_ast::node& statement : flat_ast::children(n))
+			dump_indented(statement);
+		break;
+
+	case node_kind::let:
+		dump_let(n);
+		break;
+
+	case node_kind::type_case:
+		dump_type_case(n);
+		break;
+
+	case node_kind::new_object:
+		print_indent() << "new (" << n.loc << ")\n";
+		print_indent() << " type '" << n.type << "'\n";
+		break;
+
+	case node_kind::constant_bool:
+		print_indent() << "boolean " << (n.value ? "true" : "false") << " (" << n.loc << ")\n";
+		break;
+
+	case node_kind::constant_int:
+		print_indent() << "integer " << n.value << " (" << n.loc << ")\n";
+		break;
+
+	case node_kind::constant_string:
+		dump_string(n);
+		break;
+
+	case node_kind::identifier:
+		print_indent() << "identifier '" << n.name << "' (" << n.loc << ")\n";
+		break;
+
+	case node_kind::compute_unary:
+		dump_unary(n);
+		break;
+
+	case node_kind::compute_binary:
+		dump_binary(n);
+		break;
 	}
+}
 
-	out_ << std::flush;
+void ast_dumper::dump_class(const flat_ast::node& n)
+{
+	print_indent() << "class '" << n.name << "' (" << n.loc << ")\n";
+	if (!n.type.empty())
+		print_indent() << " inherits '" << n.type << "'\n";
+
+	// Attributes and methods
+	for (const flat_ast::node& feature : flat_ast::children(n))
+		dump_indented(feature);
 }
 
-void ast_dumper::dump(const ast::attribute& attribute)
+void ast_dumper::dump_attribute(const flat_ast::node& n)
 {
-	print_indent() << "attribute '" << attribute.name << "' (" << attribute.loc << ")\n";
-	print_indent() << " type '" << attribute.type << "'\n";
+	print_indent() << "attribute '" << n.name << "' (" << n.loc << ")\n";
+	print_indent() << " type '" << n.type << "'\n";
 
-	if (attribute.initial)
+	auto initial = flat_ast::children(n);
+	if (!initial.empty())
 	{
 		print_indent() << " initial =\n";
-		dump_indented(*attribute.initial, 2);
+		dump_indented(*initial.begin(), 2);
 	}
 }
 
-void ast_dumper::dump(const ast::method& method)
+void ast_dumper::dump_method(const flat_ast::node& n)
 {
-	print_indent() << "method '" << method.name << "' (" << method.loc << ")\n";
-	print_indent() << " returns '" << method.type << "'\n";
+	print_indent() << "method '" << n.name << "' (" << n.loc << ")\n";
+	print_indent() << " returns '" << n.type << "'\n";
 
-	if (method.params.empty())
+	auto child = flat_ast::children(n).begin();
+	if (child->kind != node_kind::param)
 	{
 		print_indent() << " no params\n";
 	}
@@ -122,44 +220,34 @@ void ast_dumper::dump(const ast::method& method)
 	{
 		print_indent() << " params\n";
 
-		for (const std::pair<std::string, std::string>& param : method.params)
-		{
-			print_indent() << "  '" << param.first << "' of type '" << param.second << "'\n";
-		}
+		for (; child->kind == node_kind::param; ++child)
+			dump_indented(*child, 2);
 	}
 
-	dump_indented(*method.body);
+	// The body is the last child
+	dump_indented(*child);
 }
 
-void ast_dumper::dump(const ast::expr& expr)
+void ast_dumper::dump_dispatch(const flat_ast::node& n)
 {
-	expr.accept(*this);
-}
+	print_indent() << "dispatch to method '" << n.name << "' (" << n.loc << ")\n";
 
-void ast_dumper::visit(const ast::assign& e)
-{
-	print_indent() << "assign to '" << e.id << "' (" << e.loc << ")\n";
-	dump_indented(*e.value);
-}
-
-void ast_dumper::visit(const ast::dispatch& e)
-{
-	print_indent() << "dispatch to method '" << e.method_name << "' (" << e.loc << ")\n";
-
-	if (e.object)
+	auto args = flat_ast::children(n);
+	auto child = args.begin();
+	if (n.op)
 	{
 		print_indent() << " on\n";
-		dump_indented(*e.object, 2);
+		dump_indented(*child++, 2);
 	}
 	else
 	{
 		print_indent() << " on self\n";
 	}
 
-	if (e.object_type)
-		print_indent() << " via type '" << *e.object_type << "'\n";
+	if (!n.type.empty())
+		print_indent() << " via type '" << n.type << "'\n";
 
-	if (e.arguments.empty())
+	if (child == args.end())
 	{
 		print_indent() << " no arguments\n";
 	}
@@ -167,87 +255,42 @@ void ast_dumper::visit(const ast::dispatch& e)
 	{
 		print_indent() << " arguments\n";
 
-		for (const lcool::unique_ptr<ast::expr>& arg : e.arguments)
-			dump_indented(*arg, 2);
+		for (; child != args.end(); ++child)
+			dump_indented(*child, 2);
 	}
 }
 
-void ast_dumper::visit(const ast::conditional& e)
+void ast_dumper::dump_let(const flat_ast::node& n)
 {
-	print_indent() << "conditional (" << e.loc << ")\n";
-	print_indent() << " predicate\n";
-	dump_indented(*e.predicate, 2);
-	print_indent() << " if true\n";
-	dump_indented(*e.if_true, 2);
-	print_indent() << " if false\n";
-	dump_indented(*e.if_false, 2);
-}
+	print_indent() << "let (" << n.loc << ")\n";
 
-void ast_dumper::visit(const ast::loop& e)
-{
-	print_indent() << "loop (" << e.loc << ")\n";
-	print_indent() << " predicate\n";
-	dump_indented(*e.predicate, 2);
-	print_indent() << " body\n";
-	dump_indented(*e.body, 2);
-}
-
-void ast_dumper::visit(const ast::block& e)
-{
-	print_indent() << "block (" << e.loc << ")\n";
-
-	for (const lcool::unique_ptr<ast::expr>& statement : e.statements)
-		dump_indented(*statement);
-}
-
-void ast_dumper::visit(const ast::let& e)
-{
-	print_indent() << "let (" << e.loc << ")\n";
-
-	for (const ast::attribute& var : e.vars)
-		dump_indented(var);
+	auto child = flat_ast::children(n).begin();
+	for (; child->kind == node_kind::attribute; ++child)
+		dump_indented(*child);
 
 	print_indent() << " body\n";
-	dump_indented(*e.body, 2);
+	dump_indented(*child, 2);
 }
 
-void ast_dumper::visit(const ast::type_case& e)
+void ast_dumper::dump_type_case(const flat_ast::node& n)
 {
-	print_indent() << "case (" << e.loc << ")\n";
+	print_indent() << "case (" << n.loc << ")\n";
 	print_indent() << " value\n";
-	dump_indented(*e.value, 2);
 
-	for (const ast::type_case_branch& branch : e.branches)
-	{
-		print_indent() << " branch '" << branch.type << "' with name '" << branch.id << "'\n";
-		dump_indented(*branch.body, 2);
-	}
-}
+	auto branches = flat_ast::children(n);
+	auto child = branches.begin();
+	dump_indented(*child++, 2);
 
-void ast_dumper::visit(const ast::new_object& e)
-{
-	print_indent() << "new (" << e.loc << ")\n";
-	print_indent() << " type '" << e.type << "'\n";
+	for (; child != branches.end(); ++child)
+		dump_indented(*child);
 }
 
-void ast_dumper::visit(const ast::constant_bool& e)
-{
-	const char * value_str = (e.value ? "true" : "false");
-
-	print_indent() << "boolean " << value_str << " (" << e.loc << ")\n";
-}
-
-void ast_dumper::visit(const ast::constant_int& e)
-{
-	print_indent() << "integer " << e.value << " (" << e.loc << ")\n";
-}
-
-void ast_dumper::visit(const ast::constant_string& e)
+void ast_dumper::dump_string(const flat_ast::node& n)
 {
 	print_indent() << "string \"";
 
 	// Escape characters which would have been escaped before
-	for (char c : e.value)
+	for (char c : tree_.string_value(n))
 	{
 		switch (c)
 		{
@@ -262,34 +305,29 @@ void ast_dumper::visit(const ast::constant_string& e)
 		}
 	}
 
-	out_ << "\" (" << e.loc << ")\n";
+	out_ << "\" (" << n.loc << ")\n";
 }
 
-void ast_dumper::visit(const ast::identifier& e)
-{
-	print_indent() << "identifier '" << e.id << "' (" << e.loc << ")\n";
-}
-
-void ast_dumper::visit(const ast::compute_unary& e)
+void ast_dumper::dump_unary(const flat_ast::node& n)
 {
 	const char * expr_type = "!BAD UNARY!";
 
-	switch (e.op)
+	switch (static_cast<ast::compute_unary_type>(n.op))
 	{
 	case ast::compute_unary_type::isvoid:      expr_type = "isvoid"; break;
 	case ast::compute_unary_type::negate:      expr_type = "negate"; break;
 	case ast::compute_unary_type::logical_not: expr_type = "logical not"; break;
 	}
 
-	print_indent() << expr_type << " (" << e.loc << ")\n";
-	dump_indented(*e.body);
+	print_indent() << expr_type << " (" << n.loc << ")\n";
+	dump_indented(*flat_ast::children(n).begin());
 }
 
-void ast_dumper::visit(const ast::compute_binary& e)
+void ast_dumper::dump_binary(const flat_ast::node& n)
 {
 	const char * expr_type = "!BAD BINARY!";
 
-	switch (e.op)
+	switch (static_cast<ast::compute_binary_type>(n.op))
 	{
 	case ast::compute_binary_type::add:              expr_type = "add"; break;
 	case ast::compute_binary_type::subtract:         expr_type = "subtract"; break;
@@ -300,9 +338,10 @@ void ast_dumper::visit(const ast::compute_binary& e)
 	case ast::compute_binary_type::equal:            expr_type = "equal"; break;
 	}
 
-	print_indent() << expr_type << " (" << e.loc << ")\n";
-	dump_indented(*e.left);
-	dump_indented(*e.right);
+	auto child = flat_ast::children(n).begin();
+	print_indent() << expr_type << " (" << n.loc << ")\n";
+	dump_indented(*child++);
+	dump_indented(*child);
 }
 
 // Prints the indent and returns cout
@@ -316,5 +355,10 @@ std::ostream& ast_dumper::print_indent()
 
 void lcool::dump_ast(std::ostream& output, const ast::program& program)
 {
-	ast_dumper(output).dump(program);
+	dump_ast(output, flat_ast::flatten(program));
+}
+
+void lcool::dump_ast(std::ostream& output, const flat_ast::tree& tree)
+{
+	ast_dumper(output, tree).dump();
 }
@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/format.hpp>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.hpp"
+
+// Protocol
+//  The client sends a 32-bit payload size along with its stdin, stdout and
+//  stderr (as SCM_RIGHTS ancillary data), followed by the payload. The
+//  payload is the client's working directory and then each argument, all
+//  nul terminated. When the request is finished, the server replies with
+//  the 32-bit exit status.
+
+namespace
+{
+	// Number of file descriptors passed with each request
+	const int passed_fds = 3;
+
+	// Fills in the address of a unix socket
+	bool make_address(const std::string& path, sockaddr_un& addr, lcool::logger& log)
+	{
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+
+		if (path.size() >= sizeof(addr.sun_path))
+		{
+			log.error(boost::format("socket path '%s' is too long") % path);
+			return false;
+		}
+
+		std::memcpy(addr.sun_path, path.c_str(), path.size());
+		return true;
+	}
+
+	// Logs an error with the message for the current errno
+	void log_errno(lcool::logger& log, const std::string& what)
+	{
+		log.error(boost::format("%s: %s") % what % std::strerror(errno));
+	}
+
+	// Writes an entire buffer to a socket
+	bool write_all(int fd, const void* data, size_t size)
+	{
+		auto ptr = static_cast<const char*>(data);
+		while (size > 0)
+		{
+			ssize_t written = send(fd, ptr, size, MSG_NOSIGNAL);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+
+			ptr += written;
+			size -= written;
+		}
+
+		return true;
+	}
+
+	// Reads an entire buffer from a socket (fails if the socket is closed)
+	bool read_all(int fd, void* data, size_t size)
+	{
+		auto ptr = static_cast<char*>(data);
+		while (size > 0)
+		{
+			ssize_t got = recv(fd, ptr, size, 0);
+			if (got < 0 && errno == EINTR)
+				continue;
+			if (got <= 0)
+				return false;
+
+			ptr += got;
+			size -= got;
+		}
+
+		return true;
+	}
+
+	// Sends the payload size and our standard streams
+	bool send_header(int fd, std::uint32_t size)
+	{
+		int fds[passed_fds] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+		char control[CMSG_SPACE(sizeof(fds))];
+		std::memset(control, 0, sizeof(control));
+
+		iovec iov = { &size, sizeof(size) };
+		msghdr msg = {};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+		std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+		return sendmsg(fd, &msg, MSG_NOSIGNAL) == sizeof(size);
+	}
+
+	// Receives the payload size and replaces our standard streams with the client's
+	bool receive_header(int fd, std::uint32_t& size)
+	{
+		int fds[passed_fds];
+		char control[CMSG_SPACE(sizeof(fds))];
+
+		iovec iov = { &size, sizeof(size) };
+		msghdr msg = {};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(size))
+			return false;
+
+		cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg == nullptr ||
+			cmsg->cmsg_level != SOL_SOCKET ||
+			cmsg->cmsg_type != SCM_RIGHTS ||
+			cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+		{
+			return false;
+		}
+
+		std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+		for (int i = 0; i < passed_fds; i++)
+		{
+			dup2(fds[i], i);
+			close(fds[i]);
+		}
+
+		return true;
+	}
+
+	// Handles a single request (in the child process)
+	int handle_request(int fd, lcool::logger& log, const lcool::server_handler& handler)
+	{
+		std::uint32_t size;
+		if (!receive_header(fd, size))
+			return 1;
+
+		std::vector<char> payload(size);
+		if (!read_all(fd, payload.data(), size))
+			return 1;
+
+		std::vector<std::string> strings;
+		for (auto it = payload.begin(); it != payload.end(); )
+		{
+			auto end = std::find(it, payload.end(), '\0');
+			strings.emplace_back(it, end);
+			it = (end == payload.end()) ? end : end + 1;
+		}
+
+		if (strings.empty())
+			return 1;
+
+		if (chdir(strings[0].c_str()) != 0)
+		{
+			log_errno(log, "error changing to directory '" + strings[0] + "'");
+			return 1;
+		}
+
+		std::int32_t status = handler(std::vector<std::string>(strings.begin() + 1, strings.end()));
+
+		// Make sure the client has seen all the output before it exits
+		std::cout.flush();
+		std::clog.flush();
+		std::fflush(nullptr);
+
+		write_all(fd, &status, sizeof(status));
+		return status;
+	}
+
+	// Returns true if a server is listening at the given address
+	bool server_running(const sockaddr_un& addr)
+	{
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+			return false;
+
+		bool result = (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+		close(fd);
+		return result;
+	}
+}
+
+int lcool::run_server(const std::string& path, lcool::logger& log, const lcool::server_handler& handler)
+{
+	sockaddr_un addr;
+	if (!make_address(path, addr, log))
+		return 1;
+
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+	{
+		log_errno(log, "error creating socket");
+		return 1;
+	}
+
+	fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+
+	auto do_bind = [&]()
+	{
+		return bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+	};
+
+	bool bound = do_bind();
+	if (!bound && errno == EADDRINUSE)
+	{
+		if (server_running(addr))
+		{
+			log.error(boost::format("a server is already listening on '%s'") % path);
+			close(listen_fd);
+			return 1;
+		}
+
+		// Replace the stale socket left behind by a dead server
+		unlink(path.c_str());
+		bound = do_bind();
+	}
+
+	if (!bound)
+	{
+		log_errno(log, "error binding to '" + path + "'");
+		close(listen_fd);
+		return 1;
+	}
+
+	if (listen(listen_fd, SOMAXCONN) != 0)
+	{
+		log_errno(log, "error listening on '" + path + "'");
+		close(listen_fd);
+		return 1;
+	}
+
+	// Finished children are reaped automatically
+	std::signal(SIGCHLD, SIG_IGN);
+
+	for (;;)
+	{
+		int fd = accept(listen_fd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			log_errno(log, "error accepting connection");
+			close(listen_fd);
+			return 1;
+		}
+
+		// Don't let programs started by the handler (eg the linker) inherit the socket
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			close(listen_fd);
+			std::signal(SIGCHLD, SIG_DFL);
+			std::_Exit(handle_request(fd, log, handler));
+		}
+		else if (pid < 0)
+		{
+			log_errno(log, "error creating request process");
+		}
+
+		close(fd);
+	}
+}
+
+int lcool::run_client(const std::string& path, const std::vector<std::string>& args, lcool::logger& log)
+{
+	sockaddr_un addr;
+	if (!make_address(path, addr, log))
+		return 1;
+
+	llvm::SmallString<128> cwd;
+	if (auto error = llvm::sys::fs::current_path(cwd))
+	{
+		log.error("error getting current directory: " + error.message());
+		return 1;
+	}
+
+	std::string payload(cwd.str());
+	payload.push_back('\0');
+	for (const std::string& arg : args)
+	{
+		payload += arg;
+		payload.push_back('\0');
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		log_errno(log, "error creating socket");
+		return 1;
+	}
+
+	if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		log_errno(log, "error connecting to '" + path + "'");
+		close(fd);
+		return 1;
+	}
+
+	std::int32_t status;
+	if (!send_header(fd, payload.size()) ||
+		!write_all(fd, payload.data(), payload.size()) ||
+		!read_all(fd, &status, sizeof(status)))
+	{
+		// The server closes the connection without a status if the
+		//  request crashes
+		log.error("compile server did not complete the request");
+		close(fd);
+		return 1;
+	}
+
+	close(fd);
+	return status;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_SERVER_HPP
+#define LCOOL_SERVER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace lcool
+{
+	/**
+	 * Function called by the server to handle a request
+	 *
+	 * It is given the client's command line arguments and returns the exit
+	 * status to send back to the client.
+	 */
+	typedef std::function<int (const std::vector<std::string>&)> server_handler;
+
+	/**
+	 * Runs a compile server listening on a unix socket
+	 *
+	 * Each request is handled in a new process forked from the server, so
+	 * any state set up before calling this (eg the loaded runtime) is
+	 * already available to the handler and is never modified by it. In the
+	 * child process, the standard streams and working directory are the
+	 * client's ones.
+	 *
+	 * This function only returns if the server fails.
+	 *
+	 * @param path    path of the socket to listen on
+	 * @param log     logger to log any errors to
+	 * @param handler function called (in a child process) for each request
+	 * @return the exit status of the server
+	 */
+	int run_server(const std::string& path, logger& log, const server_handler& handler);
+
+	/**
+	 * Forwards a compile request to a server started with run_server
+	 *
+	 * @param path path of the server's socket
+	 * @param args command line arguments to send
+	 * @param log  logger to log any errors to
+	 * @return the exit status returned by the server
+	 */
+	int run_client(const std::string& path, const std::vector<std::string>& args, logger& log);
+}
+
+#endif
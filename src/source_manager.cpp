@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "source_manager.hpp"
+
+lcool::source_manager& lcool::source_manager::instance()
+{
+	static source_manager manager;
+	return manager;
+}
+
+lcool::location lcool::source_manager::add_file(std::string filename, unique_ptr<llvm::MemoryBuffer> contents)
+{
+	// The end of the file needs a location too (for EOF errors)
+	std::uint64_t size = contents->getBufferSize() + std::uint64_t(1);
+	if (size > std::numeric_limits<std::uint32_t>::max())
+		return location();
+
+	auto new_file = make_unique<file>();
+	new_file->filename = std::move(filename);
+	new_file->contents = std::move(contents);
+	new_file->read_failed = false;
+	new_file->size = size;
+	new_file->hash_found = false;
+	new_file->lines_found = false;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	return insert_locked(std::move(new_file));
+}
+
+lcool::location lcool::source_manager::add_lazy_file(std::string filename, std::uint32_t size, std::uint64_t hash)
+{
+	if (size == std::numeric_limits<std::uint32_t>::max())
+		return location();
+
+	auto new_file = make_unique<file>();
+	new_file->filename = std::move(filename);
+	new_file->read_failed = false;
+	new_file->size = size + 1;
+	new_file->hash_found = true;
+	new_file->hash = hash;
+	new_file->lines_found = false;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	return insert_locked(std::move(new_file));
+}
+
+std::uint64_t lcool::source_manager::hash(llvm::StringRef contents)
+{
+	// 64-bit FNV-1a
+	std::uint64_t result = 0xcbf29ce484222325;
+	for (char c : contents)
+	{
+		result ^= static_cast<unsigned char>(c);
+		result *= 0x100000001b3;
+	}
+
+	return result;
+}
+
+lcool::location lcool::source_manager::insert_locked(unique_ptr<file> new_file)
+{
+	if (new_file->size > std::numeric_limits<std::uint32_t>::max() - _next_start)
+		return location();
+
+	new_file->start = _next_start;
+	_next_start += new_file->size;
+	_files.push_back(std::move(new_file));
+	return location(_files.back()->start);
+}
+
+lcool::source_position lcool::source_manager::decode(location loc)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	file* found = find_locked(loc);
+	if (!found)
+		return source_position { nullptr, 0, 0 };
+
+	file& f = *found;
+	std::uint32_t offset = loc.offset() - f.start;
+
+	if (!read_locked(f))
+		return source_position { &f.filename, 0, 0 };
+
+	if (!f.lines_found)
+	{
+		// Treat LF, CR and CRLF as new lines (the same as the lexer)
+		llvm::StringRef data = f.contents->getBuffer();
+		for (std::uint32_t i = 0; i < data.size(); i++)
+		{
+			if (data[i] == '\n' || (data[i] == '\r' && (i + 1 == data.size() || data[i + 1] != '\n')))
+				f.line_starts.push_back(i + 1);
+		}
+
+		f.lines_found = true;
+	}
+
+	// The number of line starts before (or at) the offset gives the line
+	auto line_iter = std::upper_bound(f.line_starts.begin(), f.line_starts.end(), offset);
+	std::uint32_t line_start = (line_iter == f.line_starts.begin()) ? 0 : *(line_iter - 1);
+	std::uint32_t line = static_cast<std::uint32_t>(line_iter - f.line_starts.begin()) + 1;
+
+	return source_position { &f.filename, line, offset - line_start + 1 };
+}
+
+lcool::source_range lcool::source_manager::find_file(location loc)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	file* f = find_locked(loc);
+	if (!f)
+		return source_range { nullptr, location(), 0, 0 };
+
+	if (!f->hash_found)
+	{
+		f->hash = hash(f->contents->getBuffer());
+		f->hash_found = true;
+	}
+
+	return source_range { &f->filename, location(f->start), f->size, f->hash };
+}
+
+lcool::source_manager::file* lcool::source_manager::find_locked(location loc)
+{
+	// Find the last file starting before the location
+	auto iter = std::upper_bound(_files.begin(), _files.end(), loc.offset(),
+		[](std::uint32_t offset, const unique_ptr<file>& f)
+		{
+			return offset < f->start;
+		});
+
+	if (!loc.valid() || iter == _files.begin())
+		return nullptr;
+
+	return (iter - 1)->get();
+}
+
+bool lcool::source_manager::read_locked(file& f)
+{
+	if (f.contents || f.read_failed)
+		return !f.read_failed;
+
+	auto buffer = llvm::MemoryBuffer::getFile(f.filename, -1, false);
+	if (!buffer || (*buffer)->getBufferSize() + 1 != f.size || hash((*buffer)->getBuffer()) != f.hash)
+	{
+		f.read_failed = true;
+		return false;
+	}
+
+	f.contents = std::move(*buffer);
+	return true;
+}
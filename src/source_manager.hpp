@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_SOURCE_MANAGER_HPP
+#define LCOOL_SOURCE_MANAGER_HPP
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+#include "smart_ptr.hpp"
+
+namespace lcool
+{
+	/** A location decoded into its filename, line and column */
+	struct source_position
+	{
+		/** Filename of the position (NULL if the location was invalid) */
+		const std::string* filename;
+
+		/**
+		 * Line of the position (first line is 1)
+		 *
+		 * This is 0 if the file could not be read (see source_manager::add_lazy_file).
+		 */
+		std::uint32_t line;
+
+		/** Column of the position (first column is 1) */
+		std::uint32_t column;
+	};
+
+	/** The range of locations which belong to a single file */
+	struct source_range
+	{
+		/** Filename of the file (NULL if the location was invalid) */
+		const std::string* filename;
+
+		/** Location of the first character of the file */
+		location start;
+
+		/** Number of locations in the file (including one for the end of the file) */
+		std::uint32_t size;
+
+		/** Hash of the file's contents (see source_manager::hash) */
+		std::uint64_t hash;
+	};
+
+	/**
+	 * Owns the contents of every source file and maps locations back to them
+	 *
+	 * Each file is given a range of offsets within a 32-bit space so that a
+	 * location only needs to store a single offset. Line and column numbers
+	 * are only worked out when a location is decoded (normally when a
+	 * diagnostic is printed). All methods are thread safe.
+	 */
+	class source_manager
+	{
+	public:
+		/** Returns the global source manager */
+		static source_manager& instance();
+
+		source_manager(const source_manager&) = delete;
+		source_manager& operator=(const source_manager&) = delete;
+
+		/**
+		 * Adds a file to the source manager
+		 *
+		 * The contents are kept until the program exits so that locations can
+		 * always be decoded.
+		 *
+		 * @param filename the name of the file
+		 * @param contents the file's contents
+		 * @return the location of the start of the file, or an invalid
+		 *         location if there is no room left for the file
+		 */
+		location add_file(std::string filename, unique_ptr<llvm::MemoryBuffer> contents);
+
+		/**
+		 * Adds a file which is only read when a location in it is decoded
+		 *
+		 * This is used for the source files of AST files, which are usually
+		 * never read. When the file is read, it is checked against the given
+		 * size and hash. If it is missing or has changed, locations in it are
+		 * decoded without a line or column.
+		 *
+		 * @param filename the name of the file
+		 * @param size     the size of the file in bytes
+		 * @param hash     the hash of the file's contents
+		 * @return the location of the start of the file, or an invalid
+		 *         location if there is no room left for the file
+		 */
+		location add_lazy_file(std::string filename, std::uint32_t size, std::uint64_t hash);
+
+		/** Returns the hash used to detect changes to the contents of a file */
+		static std::uint64_t hash(llvm::StringRef contents);
+
+		/** Decodes a location into its filename, line and column */
+		source_position decode(location loc);
+
+		/** Returns the range of locations of the file containing a location */
+		source_range find_file(location loc);
+
+	private:
+		source_manager() = default;
+
+		struct file
+		{
+			std::string filename;
+
+			// Contents of the file (NULL until a lazy file is read, or if it
+			//  could not be read)
+			unique_ptr<llvm::MemoryBuffer> contents;
+			bool read_failed;
+
+			// Offset of the first character of the file and its number of locations
+			std::uint32_t start;
+			std::uint32_t size;
+
+			// Hash of the contents (calculated when first needed for normal files)
+			bool hash_found;
+			std::uint64_t hash;
+
+			// Offsets (within the file) of the start of each line after the
+			//  first (calculated the first time the file is decoded)
+			bool lines_found;
+			std::vector<std::uint32_t> line_starts;
+		};
+
+		// Adds a file and gives it the next range of locations
+		//  The mutex must be held by the caller.
+		location insert_locked(unique_ptr<file> new_file);
+
+		// Finds the file containing a location (NULL if there isn't one)
+		//  The mutex must be held by the caller.
+		file* find_locked(location loc);
+
+		// Reads a lazy file if it has not been read yet (returns false if it
+		//  cannot be read). The mutex must be held by the caller.
+		bool read_locked(file& f);
+
+		std::mutex _mutex;
+
+		// Files ordered by start offset
+		std::vector<unique_ptr<file>> _files;
+
+		// Offset given to the next file (0 is always an invalid location)
+		std::uint32_t _next_start = 1;
+	};
+}
+
+#endif
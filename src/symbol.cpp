@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/ADT/DenseMap.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+
+#include "symbol.hpp"
+
+namespace lcool
+{
+	// The global table containing every interned string
+	class symbol_table
+	{
+	public:
+		symbol_table()
+		{
+			_index.insert(std::make_pair(llvm::StringRef(), &symbol::_empty));
+		}
+
+		const symbol::data* intern(llvm::StringRef str)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			auto iter = _index.find(str);
+			if (iter != _index.end())
+				return iter->second;
+
+			// The deque never moves its elements, so the key (which points
+			//  into the new element) stays valid
+			std::string text = str.str();
+			std::size_t hash = std::hash<std::string>()(text);
+			_symbols.push_back(symbol::data { std::move(text), hash, static_cast<std::uint32_t>(_symbols.size() + 1) });
+			const symbol::data* result = &_symbols.back();
+			_index.insert(std::make_pair(llvm::StringRef(result->text), result));
+			return result;
+		}
+
+		std::size_t count()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _symbols.size() + 1;
+		}
+
+		static symbol_table& instance()
+		{
+			static symbol_table table;
+			return table;
+		}
+
+	private:
+		std::mutex _mutex;
+		std::deque<symbol::data> _symbols;
+		llvm::DenseMap<llvm::StringRef, const symbol::data*> _index;
+	};
+}
+
+const lcool::symbol::data lcool::symbol::_empty { std::string(), std::hash<std::string>()(std::string()), 0 };
+
+lcool::symbol::symbol(llvm::StringRef str)
+	: _data(symbol_table::instance().intern(str))
+{
+}
+
+std::size_t lcool::symbol::count()
+{
+	return symbol_table::instance().count();
+}
+
+std::ostream& lcool::operator<<(std::ostream& stream, const symbol& sym)
+{
+	return stream << sym.str();
+}
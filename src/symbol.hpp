@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_SYMBOL_HPP
+#define LCOOL_SYMBOL_HPP
+
+#include <llvm/ADT/StringRef.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+namespace lcool
+{
+	/**
+	 * An interned string used for identifiers and type names
+	 *
+	 * Every distinct string is stored exactly once in a global (thread safe)
+	 * table, so symbols can be copied, compared and hashed without looking
+	 * at the string itself. Symbols are never freed.
+	 */
+	class symbol
+	{
+	public:
+		/** Creates the empty symbol */
+		symbol()
+			: _data(&_empty)
+		{
+		}
+
+		/** Interns a string (looking it up in the global symbol table) */
+		explicit symbol(llvm::StringRef str);
+
+		/** Returns the text of this symbol */
+		const std::string& str() const
+		{
+			return _data->text;
+		}
+
+		/**
+		 * Returns the unique id of this symbol
+		 *
+		 * Ids are allocated in the order symbols are first interned. The empty
+		 * symbol always has id 0.
+		 */
+		std::uint32_t id() const
+		{
+			return _data->id;
+		}
+
+		/**
+		 * Returns the hash of this symbol
+		 *
+		 * This is the hash of the string (calculated once when it is interned)
+		 * so containers of symbols iterate in the same order regardless of the
+		 * order symbols were created in.
+		 */
+		std::size_t hash() const
+		{
+			return _data->hash;
+		}
+
+		/** Returns true if this is the empty symbol */
+		bool empty() const
+		{
+			return _data == &_empty;
+		}
+
+		bool operator==(const symbol& other) const
+		{
+			return _data == other._data;
+		}
+
+		bool operator!=(const symbol& other) const
+		{
+			return _data != other._data;
+		}
+
+		/** Returns the number of symbols which have been interned */
+		static std::size_t count();
+
+	private:
+		struct data
+		{
+			std::string text;
+			std::size_t hash;
+			std::uint32_t id;
+		};
+
+		static const data _empty;
+		const data* _data;
+
+		friend class symbol_table;
+	};
+
+	/** Writes the text of a symbol to a stream */
+	std::ostream& operator<<(std::ostream& stream, const symbol& sym);
+}
+
+namespace std
+{
+	template <>
+	struct hash<lcool::symbol>
+	{
+		std::size_t operator()(const lcool::symbol& sym) const
+		{
+			return sym.hash();
+		}
+	};
+}
+
+#endif
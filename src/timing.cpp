@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <ostream>
+
+#include "timing.hpp"
+
+namespace
+{
+	// The profiler which time_scopes are recorded in
+	lcool::time_profiler* current_profiler = nullptr;
+
+	// Converts a duration into (fractional) seconds / microseconds
+	double seconds(lcool::time_profiler::clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+
+	long long microseconds(lcool::time_profiler::clock::duration duration)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+	}
+
+	// Writes a string as a JSON string literal
+	void write_json_string(std::ostream& stream, const std::string& str)
+	{
+		stream << '"';
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\')
+				stream << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20)
+				stream << boost::format("\\u%04x") % static_cast<unsigned>(c);
+			else
+				stream << c;
+		}
+		stream << '"';
+	}
+}
+
+lcool::time_profiler::time_profiler()
+	: _start(clock::now())
+{
+	assert(current_profiler == nullptr);
+	current_profiler = this;
+}
+
+lcool::time_profiler::~time_profiler()
+{
+	current_profiler = nullptr;
+}
+
+lcool::time_profiler* lcool::time_profiler::current()
+{
+	return current_profiler;
+}
+
+void lcool::time_profiler::add_event(
+	const char* name,
+	std::string detail,
+	clock::time_point start,
+	clock::time_point end)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Threads are numbered in the order they are first seen
+	auto id = std::this_thread::get_id();
+	unsigned thread = std::find(_threads.begin(), _threads.end(), id) - _threads.begin();
+	if (thread == _threads.size())
+		_threads.push_back(id);
+
+	_events.push_back(event { name, std::move(detail), start, end - start, thread });
+}
+
+void lcool::time_profiler::write_report(std::ostream& stream) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Sum events with the same name (in all threads)
+	struct phase
+	{
+		clock::duration total;
+		unsigned count;
+	};
+
+	std::map<std::string, phase> phases;
+	for (const event& e : _events)
+	{
+		phase& p = phases[e.name];
+		p.total += e.duration;
+		p.count++;
+	}
+
+	std::vector<std::pair<std::string, phase>> sorted(phases.begin(), phases.end());
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, phase>& a, const std::pair<std::string, phase>& b)
+	{
+		return a.second.total > b.second.total;
+	});
+
+	stream << "===------------------------------------------------------------===" << std::endl;
+	stream << "                     Compile time report" << std::endl;
+	stream << "===------------------------------------------------------------===" << std::endl;
+	stream << boost::format("  Total time: %.4f seconds") % seconds(clock::now() - _start) << std::endl;
+	stream << std::endl;
+	stream << "   Time (s)    Count  Phase" << std::endl;
+
+	for (auto& p : sorted)
+		stream << boost::format("  %9.4f  %7u  %s") % seconds(p.second.total) % p.second.count % p.first << std::endl;
+}
+
+void lcool::time_profiler::write_trace(std::ostream& stream) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	stream << "{\"traceEvents\":[";
+
+	bool first = true;
+	for (const event& e : _events)
+	{
+		if (!first)
+			stream << ',';
+		first = false;
+
+		stream << "\n{\"name\":";
+		write_json_string(stream, e.name);
+		stream << ",\"cat\":\"lcool\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread;
+		stream << ",\"ts\":" << microseconds(e.start - _start);
+		stream << ",\"dur\":" << microseconds(e.duration);
+
+		if (!e.detail.empty())
+		{
+			stream << ",\"args\":{\"detail\":";
+			write_json_string(stream, e.detail);
+			stream << '}';
+		}
+
+		stream << '}';
+	}
+
+	stream << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+lcool::time_scope::time_scope(const char* name, const std::string& detail)
+	: _profiler(time_profiler::current()), _name(name)
+{
+	if (_profiler != nullptr)
+	{
+		_detail = detail;
+		_start = time_profiler::clock::now();
+	}
+}
+
+lcool::time_scope::~time_scope()
+{
+	if (_profiler != nullptr)
+		_profiler->add_event(_name, std::move(_detail), _start, time_profiler::clock::now());
+}
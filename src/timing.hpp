@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LCOOL_TIMING_HPP
+#define LCOOL_TIMING_HPP
+
+#include <chrono>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lcool
+{
+	/**
+	 * Records the time taken by each phase of the compiler
+	 *
+	 * While a profiler exists, every time_scope (in any thread) is recorded
+	 * into it. Only one profiler may exist at a time.
+	 */
+	class time_profiler
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		/** Creates a profiler and makes it the current one */
+		time_profiler();
+		~time_profiler();
+
+		time_profiler(const time_profiler&) = delete;
+		time_profiler& operator=(const time_profiler&) = delete;
+
+		/** Returns the current profiler or nullptr if profiling is disabled */
+		static time_profiler* current();
+
+		/**
+		 * Records a finished event (normally done by time_scope)
+		 *
+		 * @param name   name of the phase (must have static storage)
+		 * @param detail extra information about the event (eg a filename)
+		 * @param start  start time of the event
+		 * @param end    end time of the event
+		 */
+		void add_event(const char* name, std::string detail, clock::time_point start, clock::time_point end);
+
+		/** Prints the total time spent in each phase */
+		void write_report(std::ostream& stream) const;
+
+		/** Writes every event in the Chrome trace event (JSON) format */
+		void write_trace(std::ostream& stream) const;
+
+	private:
+		struct event
+		{
+			const char* name;
+			std::string detail;
+			clock::time_point start;
+			clock::duration duration;
+			unsigned thread;
+		};
+
+		clock::time_point _start;
+
+		mutable std::mutex _mutex;
+		std::vector<event> _events;
+		std::vector<std::thread::id> _threads;
+	};
+
+	/** Records the time taken by the enclosing scope if profiling is enabled */
+	class time_scope
+	{
+	public:
+		/**
+		 * Starts timing
+		 *
+		 * @param name   name of the phase (must have static storage)
+		 * @param detail extra information about the event (eg a filename)
+		 */
+		explicit time_scope(const char* name, const std::string& detail = std::string());
+		~time_scope();
+
+		time_scope(const time_scope&) = delete;
+		time_scope& operator=(const time_scope&) = delete;
+
+	private:
+		time_profiler* _profiler;
+		const char* _name;
+		std::string _detail;
+		time_profiler::clock::time_point _start;
+	};
+}
+
+#endif
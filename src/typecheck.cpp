@@ -0,0 +1,724 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "timing.hpp"
+#include "typecheck.hpp"
+
+using namespace lcool;
+
+namespace
+{
+// Names the type checker treats specially
+const symbol self_symbol("self");
+const symbol int_symbol("Int");
+const symbol bool_symbol("Bool");
+const symbol string_symbol("String");
+const symbol object_symbol("Object");
+const symbol main_class_symbol("Main");
+const symbol main_method_symbol("main");
+
+// A variable in scope
+struct local_var
+{
+	symbol name;
+	cool_class* type;
+	unsigned index;
+};
+
+// Class which type checks each type of expression
+class expr_checker : public ast::expr_visitor
+{
+private:
+	logger& _log;
+
+	// What are we checking?
+	cool_program& _program;
+	cool_class* _declaring_cls;
+	arena& _nodes;
+
+	// Caches for common classes
+	cool_class* _builtin_int;
+	cool_class* _builtin_bool;
+	cool_class* _builtin_string;
+	cool_class* _builtin_object;
+
+	// Holds the result of the most recent "visit" call
+	typed::expr* _result = nullptr;
+
+	// Variables in scope (innermost last)
+	std::vector<local_var> _locals;
+
+	// Index of the next local variable
+	unsigned _next_local = 0;
+
+	// Creates a new typed expression
+	template <typename T>
+	T* create(cool_class* type)
+	{
+		T* result = _nodes.create<T>();
+		result->type = type;
+		return result;
+	}
+
+	// Creates a list of typed expressions in the arena
+	template <typename T>
+	typed::node_list<T> make_list(const std::vector<T>& items)
+	{
+		return typed::node_list<T>(_nodes, items);
+	}
+
+	// Fake values used after an error has been reported
+	typed::expr* zero()
+	{
+		return create<typed::constant_int>(_builtin_int);
+	}
+
+	typed::expr* null_object()
+	{
+		return create<typed::new_object>(_builtin_object);
+	}
+
+	// Checks that a value of one type can be converted to another
+	bool check_conversion(const location& loc, cool_class* from, cool_class* to)
+	{
+		if (from->is_subclass_of(to))
+			return true;
+
+		_log.error(loc, boost::format("invalid conversion from '%s' to '%s'") %
+			from->name() % to->name());
+		return false;
+	}
+
+	// Looks up a variable in scope or returns NULL if it doesn't exist
+	const local_var* find_local(symbol name) const
+	{
+		for (auto it = _locals.rbegin(); it != _locals.rend(); it++)
+		{
+			if (it->name == name)
+				return &*it;
+		}
+
+		return nullptr;
+	}
+
+	// Resolves a variable name
+	//  Returns false (without logging an error) if it doesn't exist
+	bool resolve_variable(symbol name, typed::variable& var, cool_class*& type)
+	{
+		auto local = find_local(name);
+		if (local != nullptr)
+		{
+			var.local = local->index;
+			type = local->type;
+			return true;
+		}
+
+		auto attr = _declaring_cls->lookup_attribute(name);
+		if (attr != nullptr)
+		{
+			var.attribute = attr;
+			type = attr->type;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Declares a new variable (which must be popped with pop_new_variable)
+	//  Returns false if the variable is illegal
+	bool push_new_variable(const location& loc, symbol name, cool_class* type, unsigned& index)
+	{
+		// Check for "self" name
+		if (name == self_symbol)
+		{
+			_log.error(loc, "illegal variable name 'self'");
+			return false;
+		}
+
+		index = _next_local++;
+		_locals.push_back({ name, type, index });
+		return true;
+	}
+
+	// Pops the most recent variables created by push_new_variable
+	void pop_new_variables(unsigned n = 1)
+	{
+		assert(n <= _locals.size());
+		_locals.resize(_locals.size() - n);
+	}
+
+public:
+	expr_checker(cool_program& program, cool_class* cls, arena& nodes, logger& log)
+		: _log(log),
+		  _program(program),
+		  _declaring_cls(cls),
+		  _nodes(nodes)
+	{
+		// Cache common cool types
+		_builtin_int = program.lookup_class(int_symbol);
+		_builtin_bool = program.lookup_class(bool_symbol);
+		_builtin_string = program.lookup_class(string_symbol);
+		_builtin_object = program.lookup_class(object_symbol);
+
+		// Self is always the first local
+		add_argument(self_symbol, cls);
+	}
+
+	expr_checker(const expr_checker&) = delete;
+	expr_checker& operator=(const expr_checker&) = delete;
+
+	// Adds an argument to the list of local variables
+	//  The argument is given the next local index even if another argument
+	//  with that name exists (in which case the name refers to the first one)
+	void add_argument(symbol name, cool_class* type)
+	{
+		unsigned index = _next_local++;
+		if (find_local(name) == nullptr)
+			_locals.push_back({ name, type, index });
+	}
+
+	// Type checks the given expression and returns its typed expression
+	//  If there are any errors, they are reported and a typed expression is
+	//  still returned (but it can only be used to check for more errors).
+	typed::expr* check(const ast::expr& expr)
+	{
+		expr.accept(*this);
+		return _result;
+	}
+
+	// Returns an expression which reads self
+	typed::expr* self()
+	{
+		auto result = create<typed::identifier>(_declaring_cls);
+		result->var.local = 0;
+		return result;
+	}
+
+	void visit(const ast::assign& expr) override
+	{
+		auto result = create<typed::assign>(nullptr);
+		result->value = check(*expr.value);
+		result->type = result->value->type;
+		_result = result;
+
+		if (expr.id == self_symbol)
+		{
+			_log.error(expr.loc, "cannot assign to self");
+			return;
+		}
+
+		cool_class* var_type;
+		if (resolve_variable(expr.id, result->target, var_type))
+			check_conversion(expr.loc, result->value->type, var_type);
+		else
+			_log.error(expr.loc, "variable not defined '" + expr.id.str() + "'");
+	}
+
+	void visit(const ast::dispatch& expr) override
+	{
+		auto result = create<typed::dispatch>(nullptr);
+		std::vector<typed::expr*> args;
+
+		// Check all expressions which are part of the dispatch
+		if (expr.object)
+			result->object = check(*expr.object);
+		else
+			result->object = self();
+
+		for (auto& arg_ptr : expr.arguments)
+			args.push_back(check(*arg_ptr));
+
+		// Get class to dispatch against
+		cool_class* object_cls = result->object->type;
+		cool_class* cls = object_cls;
+		if (!expr.object_type.empty())
+		{
+			result->static_call = true;
+			cls = _program.lookup_class(expr.object_type);
+			if (cls == nullptr)
+			{
+				_log.error(expr.loc, "class not defined '" + expr.object_type.str() + "'");
+				_result = zero();
+				return;
+			}
+
+			if (!object_cls->is_subclass_of(cls))
+			{
+				_log.error(expr.loc, "'" + object_cls->name().str() + "' to the left of the dispatch is not a subclass of '@" + cls->name().str() + "'");
+				_result = zero();
+				return;
+			}
+		}
+
+		// Find method
+		cool_method* to_call = cls->lookup_method(expr.method_name, true);
+		if (to_call == nullptr)
+		{
+			_log.error(expr.loc, "method '" + expr.method_name.str() + "' not defined for class '" + cls->name().str() + "'");
+			_result = zero();
+			return;
+		}
+
+		// Check number of args
+		std::vector<cool_class*>& parameter_types = to_call->slot()->parameter_types;
+		if (args.size() != parameter_types.size())
+		{
+			_log.error(expr.loc, boost::format("wrong number of arguments for method '%s.%s' (expected %u, got %u)") %
+				cls->name() % to_call->slot()->name % parameter_types.size() % args.size());
+			_result = zero();
+			return;
+		}
+
+		// Check all the objects can be converted to the right types
+		if (!object_cls->is_subclass_of(to_call->slot()->declaring_class))
+		{
+			_log.error(expr.loc, boost::format("invalid conversion from '%s' to '%s'") %
+				object_cls->name() % cls->name());
+		}
+
+		for (size_t i = 0; i < args.size(); i++)
+			check_conversion(expr.loc, args[i]->type, parameter_types[i]);
+
+		result->method = to_call;
+		result->arguments = make_list(args);
+		result->type = to_call->slot()->return_type;
+		_result = result;
+	}
+
+	void visit(const ast::conditional& expr) override
+	{
+		auto result = create<typed::conditional>(nullptr);
+
+		result->predicate = check(*expr.predicate);
+		if (result->predicate->type != _builtin_bool)
+			_log.error(expr.loc, "conditional predicate must be a Bool");
+
+		// The result has the type common to both sides
+		result->if_true = check(*expr.if_true);
+		result->if_false = check(*expr.if_false);
+		result->type = cool_class::common_ancestor(result->if_true->type, result->if_false->type);
+		_result = result;
+	}
+
+	void visit(const ast::loop& expr) override
+	{
+		auto result = create<typed::loop>(_builtin_object);
+
+		result->predicate = check(*expr.predicate);
+		if (result->predicate->type != _builtin_bool)
+			_log.error(expr.loc, "loop predicate must be a Bool");
+
+		result->body = check(*expr.body);
+		_result = result;
+	}
+
+	void visit(const ast::block& expr) override
+	{
+		// The result is the value of the last statement
+		assert(!expr.statements.empty());
+		std::vector<typed::expr*> statements;
+		for (auto& expr_ptr : expr.statements)
+			statements.push_back(check(*expr_ptr));
+
+		auto result = create<typed::block>(statements.back()->type);
+		result->statements = make_list(statements);
+		_result = result;
+	}
+
+	void visit(const ast::let& expr) override
+	{
+		auto result = create<typed::let>(nullptr);
+		std::vector<typed::let_var> vars;
+		unsigned pushed = 0;
+
+		for (const ast::attribute& var : expr.vars)
+		{
+			typed::let_var typed_var;
+			typed_var.name = var.name;
+
+			// Check initializer (if there is one)
+			if (var.initial)
+				typed_var.initial = check(*var.initial);
+
+			// Lookup class
+			typed_var.type = _program.lookup_class(var.type);
+			if (typed_var.type == nullptr)
+			{
+				_log.error(var.loc, "class not defined '" + var.type.str() + "'");
+				continue;
+			}
+
+			if (var.initial)
+				check_conversion(expr.loc, typed_var.initial->type, typed_var.type);
+
+			// Bring the new variable into scope
+			if (push_new_variable(var.loc, var.name, typed_var.type, typed_var.local))
+			{
+				vars.push_back(typed_var);
+				pushed++;
+			}
+		}
+
+		// Check body
+		result->body = check(*expr.body);
+		result->vars = make_list(vars);
+		result->type = result->body->type;
+		_result = result;
+
+		// Pop variables gone out of scope
+		pop_new_variables(pushed);
+	}
+
+	void visit(const ast::type_case& expr) override
+	{
+		auto result = create<typed::type_case>(nullptr);
+		result->value = check(*expr.value);
+		cool_class* value_cls = result->value->type;
+
+		// Resolve class names of all case branches
+		std::unordered_map<cool_class*, size_t> cls_map;
+		std::vector<std::pair<cool_class*, const ast::type_case_branch*>> sorted_branches;
+
+		for (auto& branch : expr.branches)
+		{
+			auto cls = _program.lookup_class(branch.type);
+			if (cls == nullptr)
+				_log.error(expr.loc, "class not defined '" + branch.type.str() + "'");
+			else if(!cls_map.insert({cls, sorted_branches.size()}).second)
+				_log.error(expr.loc, "class occurs twice in case expression '" + branch.type.str() + "'");
+			else
+				sorted_branches.emplace_back(cls, &branch);
+		}
+
+		// Bail out if there are no branches
+		if (sorted_branches.empty())
+		{
+			if (expr.branches.empty())
+				_log.error(expr.loc, "case expression with no branches");
+
+			_result = null_object();
+			return;
+		}
+
+		// Sort case branches so parent classes are below child classes
+		std::sort(sorted_branches.begin(), sorted_branches.end(),
+			[&cls_map](
+				const std::pair<cool_class*, const ast::type_case_branch*>& a,
+				const std::pair<cool_class*, const ast::type_case_branch*>& b) -> bool
+			{
+				// Handle equal classes
+				if (a.first == b.first)
+					return false;
+
+				// More derived classes come first
+				if (a.first->is_subclass_of(b.first))
+					return true;
+				else if (b.first->is_subclass_of(a.first))
+					return false;
+
+				// Incomparable classes are ordered by index in the class map
+				return cls_map.at(a.first) < cls_map.at(b.first);
+			});
+
+		std::vector<typed::type_case_branch> branches;
+		for (auto& branch_pair : sorted_branches)
+		{
+			typed::type_case_branch branch;
+			branch.name = branch_pair.second->id;
+			branch.type = branch_pair.first;
+
+			// Check if this test is always true or false
+			if (value_cls->is_subclass_of(branch.type))
+			{
+				branch.test = typed::case_test::always;
+			}
+			else if (!branch.type->is_subclass_of(value_cls))
+			{
+				_log.warning(expr.loc, "unreachable case branch for type '" + branch.type->name().str() + "'");
+				branch.test = typed::case_test::never;
+			}
+
+			// Check the body with the new variable in scope
+			bool pushed = push_new_variable(expr.loc, branch.name, branch.type, branch.local);
+			branch.body = check(*branch_pair.second->body);
+			if (pushed)
+				pop_new_variables();
+
+			// The result has the type common to all the branches
+			if (result->type == nullptr)
+				result->type = branch.body->type;
+			else
+				result->type = cool_class::common_ancestor(result->type, branch.body->type);
+
+			branches.push_back(branch);
+		}
+
+		result->branches = make_list(branches);
+		_result = result;
+	}
+
+	void visit(const ast::new_object& expr) override
+	{
+		// Lookup class of the new object
+		cool_class* cls = _program.lookup_class(expr.type);
+		if (cls == nullptr)
+		{
+			_log.error(expr.loc, "class not defined '" + expr.type.str() + "'");
+			_result = null_object();
+		}
+		else
+		{
+			_result = create<typed::new_object>(cls);
+		}
+	}
+
+	void visit(const ast::constant_bool& expr) override
+	{
+		auto result = create<typed::constant_bool>(_builtin_bool);
+		result->value = expr.value;
+		_result = result;
+	}
+
+	void visit(const ast::constant_int& expr) override
+	{
+		auto result = create<typed::constant_int>(_builtin_int);
+		result->value = expr.value;
+		_result = result;
+	}
+
+	void visit(const ast::constant_string& expr) override
+	{
+		auto result = create<typed::constant_string>(_builtin_string);
+		result->value = expr.value;
+		_result = result;
+	}
+
+	void visit(const ast::identifier& expr) override
+	{
+		auto result = create<typed::identifier>(nullptr);
+		if (resolve_variable(expr.id, result->var, result->type))
+		{
+			_result = result;
+		}
+		else
+		{
+			// Identifier not found!
+			_log.error(expr.loc, "variable not defined '" + expr.id.str() + "'");
+			_result = zero();
+		}
+	}
+
+	void visit(const ast::compute_unary& expr) override
+	{
+		auto result = create<typed::compute_unary>(nullptr);
+		result->op = expr.op;
+		result->body = check(*expr.body);
+		_result = result;
+
+		switch (expr.op)
+		{
+			case ast::compute_unary_type::isvoid:
+				// Ints and Bools are not pointers so can never be void
+				if (!result->body->type->llvm_type()->isPointerTy())
+					_log.warning(expr.loc, "isvoid on Int or Bool is always false");
+
+				result->type = _builtin_bool;
+				break;
+
+			case ast::compute_unary_type::negate:
+				// Integer negation
+				if (result->body->type != _builtin_int)
+					_log.error(expr.loc, "input to ~ operator must be an Int");
+
+				result->type = _builtin_int;
+				break;
+
+			case ast::compute_unary_type::logical_not:
+				// Boolean complement
+				if (result->body->type != _builtin_bool)
+					_log.error(expr.loc, "input to 'not' operator must be a Bool");
+
+				result->type = _builtin_bool;
+				break;
+
+			default:
+				assert(0);
+		}
+	}
+
+	void visit(const ast::compute_binary& expr) override
+	{
+		auto result = create<typed::compute_binary>(nullptr);
+		result->op = expr.op;
+		result->left = check(*expr.left);
+		result->right = check(*expr.right);
+		_result = result;
+
+		cool_class* left = result->left->type;
+		cool_class* right = result->right->type;
+
+		if (expr.op == ast::compute_binary_type::equal)
+		{
+			// Equality is special as it accepts many different types
+			result->type = _builtin_bool;
+
+			if ((left == _builtin_bool) != (right == _builtin_bool)
+				|| (left == _builtin_int) != (right == _builtin_int)
+				|| (left == _builtin_string) != (right == _builtin_string))
+			{
+				_log.error(expr.loc, "basic types can only be compared with themselves");
+			}
+			else if (left != _builtin_string && !left->is_subclass_of(right) && !right->is_subclass_of(left))
+			{
+				// If neither type is a subclass of the other, they can never be equal
+				_log.warning(expr.loc, "result of comparison is always false");
+			}
+		}
+		else if (expr.op == ast::compute_binary_type::add ||
+				expr.op == ast::compute_binary_type::subtract ||
+				expr.op == ast::compute_binary_type::multiply ||
+				expr.op == ast::compute_binary_type::divide)
+		{
+			// Arithmetic expression - only accepts ints, result is always int
+			result->type = _builtin_int;
+			if (left != _builtin_int || right != _builtin_int)
+				_log.error(expr.loc, "both inputs to an arithmetic expression must be Ints");
+		}
+		else
+		{
+			// Comparison expression - only accepts ints, result is always bool
+			result->type = _builtin_bool;
+			if (left != _builtin_int || right != _builtin_int)
+				_log.error(expr.loc, "both inputs to a comparison expression must be Ints");
+		}
+	}
+};
+
+// Type checks the attribute initializers of a class (run by its constructor)
+void check_initializers(const ast::cls& input, cool_program& program, typed::cls& output, arena& nodes, logger& log)
+{
+	expr_checker checker(program, output.cls, nodes, log);
+
+	for (auto& ast_attr : input.attributes)
+	{
+		if (ast_attr.initial)
+		{
+			typed::attribute_init init;
+			init.attribute = output.cls->lookup_attribute(ast_attr.name);
+			init.initial = checker.check(*ast_attr.initial);
+			if (!init.initial->type->is_subclass_of(init.attribute->type))
+			{
+				log.error(ast_attr.loc, boost::format("invalid conversion from '%s' to '%s'") %
+					init.initial->type->name() % init.attribute->type->name());
+			}
+
+			output.initializers.push_back(init);
+		}
+	}
+}
+
+// Type checks a method
+typed::method check_method(const ast::method& input, cool_program& program, cool_class* cls, arena& nodes, logger& log)
+{
+	typed::method result;
+
+	// Lookup method
+	result.method = cls->lookup_method(input.name);
+	assert(result.method != nullptr);
+
+	// Add all arguments
+	expr_checker checker(program, cls, nodes, log);
+	for (unsigned i = 0; i < input.params.size(); i++)
+		checker.add_argument(input.params[i].first, result.method->slot()->parameter_types[i]);
+
+	// Check the body can be converted to the return type
+	result.body = checker.check(*input.body);
+	cool_class* return_type = result.method->slot()->return_type;
+	if (!result.body->type->is_subclass_of(return_type))
+	{
+		log.error(input.loc, boost::format("returning: invalid conversion from '%s' to '%s'") %
+			result.body->type->name() % return_type->name());
+	}
+
+	return result;
+}
+
+// Finds the method called by the program's entry point
+void check_main(cool_program& program, typed::program& result, logger& log)
+{
+	cool_class* main_cls = program.lookup_class(main_class_symbol);
+	if (main_cls == nullptr)
+	{
+		log.error("'Main' class not defined");
+		return;
+	}
+
+	cool_method* main_method = main_cls->lookup_method(main_method_symbol, true);
+	if (main_method == nullptr)
+	{
+		log.error("method 'Main.main' not defined");
+		return;
+	}
+
+	if (!main_method->slot()->parameter_types.empty())
+	{
+		log.error("method 'Main.main' must have no parameters");
+		return;
+	}
+
+	// We can handle this case fine, so it's just a warning
+	if (main_method->declaring_class() != main_cls)
+		log.warning("method 'Main.main' not declared in 'Main' class");
+
+	result.main_class = main_cls;
+	result.main_method = main_method;
+}
+
+}
+
+typed::program lcool::typecheck(const ast::program& input, cool_program& output, logger& log)
+{
+	typed::program result;
+	for (auto& cls : input)
+		typecheck(cls, output, result, log);
+
+	check_main(output, result, log);
+	return result;
+}
+
+void lcool::typecheck(const ast::cls& input, cool_program& output, typed::program& result, logger& log)
+{
+	time_scope timer("typecheck class", input.name.str());
+
+	typed::cls typed_cls;
+	typed_cls.cls = output.lookup_class(input.name);
+	assert(typed_cls.cls != nullptr);
+
+	check_initializers(input, output, typed_cls, result.nodes(), log);
+
+	for (auto& method : input.methods)
+		typed_cls.methods.push_back(check_method(method, output, typed_cls.cls, result.nodes(), log));
+
+	result.push_back(std::move(typed_cls));
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LCOOL_TYPECHECK_HPP
+#define LCOOL_TYPECHECK_HPP
+
+#include "ast.hpp"
+#include "cool_program.hpp"
+#include "logger.hpp"
+#include "typed_ast.hpp"
+
+namespace lcool
+{
+	/**
+	 * Type checks all the classes in an AST and produces a typed AST
+	 *
+	 * The classes must have been layed out in the output program first (see
+	 * layout). Every class, method, attribute and variable used by the
+	 * program is resolved once here, along with the Main.main method called
+	 * by the program's entry point.
+	 *
+	 * If this function fails (see log.has_errors), the typed AST must not be
+	 * passed to the code generator.
+	 *
+	 * @param input  AST to type check
+	 * @param output laid out program to resolve names against
+	 * @param log    logger to log any errors and warnings to
+	 * @return the typed AST
+	 */
+	typed::program typecheck(const ast::program& input, cool_program& output, logger& log);
+
+	/**
+	 * Type checks a single class and appends it to a typed AST
+	 *
+	 * This does not fill in the program's main method.
+	 *
+	 * @param input  AST of the class to type check
+	 * @param output laid out program to resolve names against
+	 * @param result typed AST to append the class to
+	 * @param log    logger to log any errors and warnings to
+	 */
+	void typecheck(const ast::cls& input, cool_program& output, typed::program& result, logger& log);
+}
+
+#endif
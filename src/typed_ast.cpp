@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "typed_ast.hpp"
+
+namespace typed = lcool::typed;
+
+void typed::assign         ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::dispatch       ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::conditional    ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::loop           ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::block          ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::let            ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::type_case      ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::new_object     ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::constant_bool  ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::constant_int   ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::constant_string::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::identifier     ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::compute_unary  ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
+void typed::compute_binary ::accept(typed::expr_visitor& visitor) const { visitor.visit(*this); }
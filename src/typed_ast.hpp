@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2016 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef LCOOL_TYPED_AST_HPP
+#define LCOOL_TYPED_AST_HPP
+
+#include <llvm/ADT/StringRef.h>
+#include <cstdint>
+#include <vector>
+
+#include "arena.hpp"
+#include "ast.hpp"
+#include "cool_program.hpp"
+#include "smart_ptr.hpp"
+#include "symbol.hpp"
+
+namespace lcool { namespace typed
+{
+	/*
+	 * The typed AST is produced from the AST by the type checker (see
+	 * typecheck.hpp). Every class, method, attribute and variable has already
+	 * been resolved against a cool_program, so the code generator can lower
+	 * it without doing any lookups or reporting any errors.
+	 *
+	 * Typed ASTs are only lowered if the type checker did not report any
+	 * errors. After an error, some of the resolved pointers may be NULL.
+	 */
+
+	using ast::node_list;
+
+	class expr_visitor;
+
+	/**
+	 * Base class for typed expressions
+	 *
+	 * Like AST expressions, typed expressions are allocated in the arena owned
+	 * by their program.
+	 */
+	class expr
+	{
+	public:
+		/**
+		 * Calls the relevant function of visitor depending on the type of this expression
+		 * @param visitor class containing methods to call
+		 */
+		virtual void accept(expr_visitor& visitor) const = 0;
+
+		/** The static type of this expression */
+		cool_class* type = nullptr;
+
+	protected:
+		~expr() = default;
+	};
+
+	/** A variable which can be read or assigned to */
+	struct variable
+	{
+		/** The attribute of self this variable refers to (or NULL for local variables) */
+		cool_attribute* attribute = nullptr;
+
+		/** Index of the local variable this refers to (self is always 0) */
+		unsigned local = 0;
+	};
+
+	/** Expression assigning a value to a variable */
+	class assign : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Variable to assign to */
+		variable target;
+
+		/** Value to assign (the type of this expression is the value's type) */
+		expr* value = nullptr;
+	};
+
+	/** Method dispatch / call expression */
+	class dispatch : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Method to call (the override visible in the static type of object) */
+		cool_method* method = nullptr;
+
+		/** Object to call method on (an identifier referencing self if none was given) */
+		expr* object = nullptr;
+
+		/** True if the method must be called statically */
+		bool static_call = false;
+
+		/** List of arguments */
+		node_list<expr*> arguments;
+	};
+
+	/** Condition expression (if statement) */
+	class conditional : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Predicate to test on (always a Bool) */
+		expr* predicate = nullptr;
+
+		/** Value to return if predicate is true */
+		expr* if_true = nullptr;
+
+		/** Value to return if predicate is false */
+		expr* if_false = nullptr;
+	};
+
+	/** While loop (always a void Object) */
+	class loop : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Predicate to test on (always a Bool) */
+		expr* predicate = nullptr;
+
+		/** Body of the loop */
+		expr* body = nullptr;
+	};
+
+	/** Statement block */
+	class block : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** List of statements, last statement is the value of the block */
+		node_list<expr*> statements;
+	};
+
+	/** A local variable declared by a let expression */
+	struct let_var
+	{
+		/** Name of the variable */
+		symbol name;
+
+		/** Type of the variable */
+		cool_class* type = nullptr;
+
+		/** Index of the local variable */
+		unsigned local = 0;
+
+		/** Optional initial value (otherwise the type's default value is used) */
+		expr* initial = nullptr;
+	};
+
+	/** Let expression (declares local variables + scope) */
+	class let : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** List of variables to declare */
+		node_list<let_var> vars;
+
+		/** Let expression body */
+		expr* body = nullptr;
+	};
+
+	/** How the type of a case branch is tested */
+	enum class case_test : std::uint8_t
+	{
+		always,         /**< The value is always an instance of the branch type */
+		never,          /**< The branch is unreachable */
+		instance_of,    /**< The type must be tested at runtime */
+	};
+
+	/** An individual branch of a type case expression */
+	struct type_case_branch
+	{
+		/** Name of the variable to introduce with the more specific type */
+		symbol name;
+
+		/** Type to test for */
+		cool_class* type = nullptr;
+
+		/** Index of the local variable */
+		unsigned local = 0;
+
+		/** How the branch's type is tested */
+		case_test test = case_test::instance_of;
+
+		/** Body of the branch */
+		expr* body = nullptr;
+	};
+
+	/** Type case expression */
+	class type_case : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Value to test type of */
+		expr* value = nullptr;
+
+		/** List of case branches (ordered so subclasses are tested before their parents) */
+		node_list<type_case_branch> branches;
+	};
+
+	/** Creates a new object of this expression's type */
+	class new_object : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+	};
+
+	/** Constant boolean */
+	class constant_bool : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Value of the constant */
+		bool value = false;
+	};
+
+	/** Constant integer */
+	class constant_int : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Value of the constant */
+		std::int32_t value = 0;
+	};
+
+	/** Constant string */
+	class constant_string : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Value of the constant (stored in the AST's arena) */
+		llvm::StringRef value;
+	};
+
+	/** Reads a variable */
+	class identifier : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Variable to read */
+		variable var;
+	};
+
+	/** Computes some unary operation */
+	class compute_unary : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Type of expression */
+		ast::compute_unary_type op;
+
+		/** Sub expression */
+		expr* body = nullptr;
+	};
+
+	/** Computes some binary operation */
+	class compute_binary : public expr
+	{
+	public:
+		virtual void accept(expr_visitor& visitor) const override;
+
+		/** Type of expression */
+		ast::compute_binary_type op;
+
+		/** Left sub expression */
+		expr* left = nullptr;
+
+		/** Right sub expression */
+		expr* right = nullptr;
+	};
+
+	/** Visitor class used to traverse typed expression trees */
+	class expr_visitor
+	{
+	public:
+		virtual ~expr_visitor() { }
+
+		virtual void visit(const assign&) = 0;
+		virtual void visit(const dispatch&) = 0;
+		virtual void visit(const conditional&) = 0;
+		virtual void visit(const loop&) = 0;
+		virtual void visit(const block&) = 0;
+		virtual void visit(const let&) = 0;
+		virtual void visit(const type_case&) = 0;
+		virtual void visit(const new_object&) = 0;
+		virtual void visit(const constant_bool&) = 0;
+		virtual void visit(const constant_int&) = 0;
+		virtual void visit(const constant_string&) = 0;
+		virtual void visit(const identifier&) = 0;
+		virtual void visit(const compute_unary&) = 0;
+		virtual void visit(const compute_binary&) = 0;
+	};
+
+	/** An attribute initializer (run by the class's constructor) */
+	struct attribute_init
+	{
+		/** Attribute to initialize */
+		cool_attribute* attribute = nullptr;
+
+		/** Initial value */
+		expr* initial = nullptr;
+	};
+
+	/** A typed method */
+	struct method
+	{
+		/** The method being defined (parameter i is stored in local i + 1) */
+		cool_method* method = nullptr;
+
+		/** Method body */
+		expr* body = nullptr;
+	};
+
+	/** A typed class */
+	struct cls
+	{
+		/** The class being defined */
+		cool_class* cls = nullptr;
+
+		/** Initializers of the attributes which have one (in declaration order) */
+		std::vector<attribute_init> initializers;
+
+		/** Method definitions */
+		std::vector<method> methods;
+	};
+
+	/**
+	 * Collection of typed classes which make up a program
+	 *
+	 * The program owns the arena containing all of its expressions. The
+	 * classes and methods it points to are owned by a cool_program.
+	 */
+	class program
+	{
+	public:
+		typedef std::vector<cls>::const_iterator const_iterator;
+
+		program()
+			: _nodes(lcool::make_unique<arena>())
+		{
+		}
+
+		program(program&&)            = default;
+		program& operator=(program&&) = default;
+
+		const_iterator begin() const  { return _classes.begin(); }
+		const_iterator end() const    { return _classes.end(); }
+		std::size_t size() const      { return _classes.size(); }
+
+		const cls& operator[](std::size_t i) const { return _classes[i]; }
+
+		/** Adds a class to the end of the program */
+		void push_back(cls&& new_cls)
+		{
+			_classes.push_back(std::move(new_cls));
+		}
+
+		/** Returns the arena expressions in this program are allocated in */
+		arena& nodes()
+		{
+			return *_nodes;
+		}
+
+		/** The class created by the program's entry point */
+		cool_class* main_class = nullptr;
+
+		/** The method called on main_class by the program's entry point */
+		cool_method* main_method = nullptr;
+
+	private:
+		unique_ptr<arena> _nodes;
+		std::vector<cls> _classes;
+	};
+}}
+
+#endif
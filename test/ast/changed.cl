@@ -0,0 +1,29 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+-- An AST file whose source has changed (but still has the same size) gives
+--  diagnostics with only the name of the source file
+
+class Main inherits IO
+{
+	value : Int <- "a string";
+
+	main() : Object
+	{
+		out_string(value)
+	};
+};
@@ -0,0 +1,539 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+-- Deeply nested lets (with conditionals inside them)
+
+class Main
+{
+	main() : Object
+	{
+		let x : Int <- 0 in if x = 0 then x else
+		let x : Int <- 1 in if x = 0 then x else
+		let x : Int <- 2 in if x = 0 then x else
+		let x : Int <- 3 in if x = 0 then x else
+		let x : Int <- 4 in if x = 0 then x else
+		let x : Int <- 5 in if x = 0 then x else
+		let x : Int <- 6 in if x = 0 then x else
+		let x : Int <- 7 in if x = 0 then x else
+		let x : Int <- 8 in if x = 0 then x else
+		let x : Int <- 9 in if x = 0 then x else
+		let x : Int <- 10 in if x = 0 then x else
+		let x : Int <- 11 in if x = 0 then x else
+		let x : Int <- 12 in if x = 0 then x else
+		let x : Int <- 13 in if x = 0 then x else
+		let x : Int <- 14 in if x = 0 then x else
+		let x : Int <- 15 in if x = 0 then x else
+		let x : Int <- 16 in if x = 0 then x else
+		let x : Int <- 17 in if x = 0 then x else
+		let x : Int <- 18 in if x = 0 then x else
+		let x : Int <- 19 in if x = 0 then x else
+		let x : Int <- 20 in if x = 0 then x else
+		let x : Int <- 21 in if x = 0 then x else
+		let x : Int <- 22 in if x = 0 then x else
+		let x : Int <- 23 in if x = 0 then x else
+		let x : Int <- 24 in if x = 0 then x else
+		let x : Int <- 25 in if x = 0 then x else
+		let x : Int <- 26 in if x = 0 then x else
+		let x : Int <- 27 in if x = 0 then x else
+		let x : Int <- 28 in if x = 0 then x else
+		let x : Int <- 29 in if x = 0 then x else
+		let x : Int <- 30 in if x = 0 then x else
+		let x : Int <- 31 in if x = 0 then x else
+		let x : Int <- 32 in if x = 0 then x else
+		let x : Int <- 33 in if x = 0 then x else
+		let x : Int <- 34 in if x = 0 then x else
+		let x : Int <- 35 in if x = 0 then x else
+		let x : Int <- 36 in if x = 0 then x else
+		let x : Int <- 37 in if x = 0 then x else
+		let x : Int <- 38 in if x = 0 then x else
+		let x : Int <- 39 in if x = 0 then x else
+		let x : Int <- 40 in if x = 0 then x else
+		let x : Int <- 41 in if x = 0 then x else
+		let x : Int <- 42 in if x = 0 then x else
+		let x : Int <- 43 in if x = 0 then x else
+		let x : Int <- 44 in if x = 0 then x else
+		let x : Int <- 45 in if x = 0 then x else
+		let x : Int <- 46 in if x = 0 then x else
+		let x : Int <- 47 in if x = 0 then x else
+		let x : Int <- 48 in if x = 0 then x else
+		let x : Int <- 49 in if x = 0 then x else
+		let x : Int <- 50 in if x = 0 then x else
+		let x : Int <- 51 in if x = 0 then x else
+		let x : Int <- 52 in if x = 0 then x else
+		let x : Int <- 53 in if x = 0 then x else
+		let x : Int <- 54 in if x = 0 then x else
+		let x : Int <- 55 in if x = 0 then x else
+		let x : Int <- 56 in if x = 0 then x else
+		let x : Int <- 57 in if x = 0 then x else
+		let x : Int <- 58 in if x = 0 then x else
+		let x : Int <- 59 in if x = 0 then x else
+		let x : Int <- 60 in if x = 0 then x else
+		let x : Int <- 61 in if x = 0 then x else
+		let x : Int <- 62 in if x = 0 then x else
+		let x : Int <- 63 in if x = 0 then x else
+		let x : Int <- 64 in if x = 0 then x else
+		let x : Int <- 65 in if x = 0 then x else
+		let x : Int <- 66 in if x = 0 then x else
+		let x : Int <- 67 in if x = 0 then x else
+		let x : Int <- 68 in if x = 0 then x else
+		let x : Int <- 69 in if x = 0 then x else
+		let x : Int <- 70 in if x = 0 then x else
+		let x : Int <- 71 in if x = 0 then x else
+		let x : Int <- 72 in if x = 0 then x else
+		let x : Int <- 73 in if x = 0 then x else
+		let x : Int <- 74 in if x = 0 then x else
+		let x : Int <- 75 in if x = 0 then x else
+		let x : Int <- 76 in if x = 0 then x else
+		let x : Int <- 77 in if x = 0 then x else
+		let x : Int <- 78 in if x = 0 then x else
+		let x : Int <- 79 in if x = 0 then x else
+		let x : Int <- 80 in if x = 0 then x else
+		let x : Int <- 81 in if x = 0 then x else
+		let x : Int <- 82 in if x = 0 then x else
+		let x : Int <- 83 in if x = 0 then x else
+		let x : Int <- 84 in if x = 0 then x else
+		let x : Int <- 85 in if x = 0 then x else
+		let x : Int <- 86 in if x = 0 then x else
+		let x : Int <- 87 in if x = 0 then x else
+		let x : Int <- 88 in if x = 0 then x else
+		let x : Int <- 89 in if x = 0 then x else
+		let x : Int <- 90 in if x = 0 then x else
+		let x : Int <- 91 in if x = 0 then x else
+		let x : Int <- 92 in if x = 0 then x else
+		let x : Int <- 93 in if x = 0 then x else
+		let x : Int <- 94 in if x = 0 then x else
+		let x : Int <- 95 in if x = 0 then x else
+		let x : Int <- 96 in if x = 0 then x else
+		let x : Int <- 97 in if x = 0 then x else
+		let x : Int <- 98 in if x = 0 then x else
+		let x : Int <- 99 in if x = 0 then x else
+		let x : Int <- 100 in if x = 0 then x else
+		let x : Int <- 101 in if x = 0 then x else
+		let x : Int <- 102 in if x = 0 then x else
+		let x : Int <- 103 in if x = 0 then x else
+		let x : Int <- 104 in if x = 0 then x else
+		let x : Int <- 105 in if x = 0 then x else
+		let x : Int <- 106 in if x = 0 then x else
+		let x : Int <- 107 in if x = 0 then x else
+		let x : Int <- 108 in if x = 0 then x else
+		let x : Int <- 109 in if x = 0 then x else
+		let x : Int <- 110 in if x = 0 then x else
+		let x : Int <- 111 in if x = 0 then x else
+		let x : Int <- 112 in if x = 0 then x else
+		let x : Int <- 113 in if x = 0 then x else
+		let x : Int <- 114 in if x = 0 then x else
+		let x : Int <- 115 in if x = 0 then x else
+		let x : Int <- 116 in if x = 0 then x else
+		let x : Int <- 117 in if x = 0 then x else
+		let x : Int <- 118 in if x = 0 then x else
+		let x : Int <- 119 in if x = 0 then x else
+		let x : Int <- 120 in if x = 0 then x else
+		let x : Int <- 121 in if x = 0 then x else
+		let x : Int <- 122 in if x = 0 then x else
+		let x : Int <- 123 in if x = 0 then x else
+		let x : Int <- 124 in if x = 0 then x else
+		let x : Int <- 125 in if x = 0 then x else
+		let x : Int <- 126 in if x = 0 then x else
+		let x : Int <- 127 in if x = 0 then x else
+		let x : Int <- 128 in if x = 0 then x else
+		let x : Int <- 129 in if x = 0 then x else
+		let x : Int <- 130 in if x = 0 then x else
+		let x : Int <- 131 in if x = 0 then x else
+		let x : Int <- 132 in if x = 0 then x else
+		let x : Int <- 133 in if x = 0 then x else
+		let x : Int <- 134 in if x = 0 then x else
+		let x : Int <- 135 in if x = 0 then x else
+		let x : Int <- 136 in if x = 0 then x else
+		let x : Int <- 137 in if x = 0 then x else
+		let x : Int <- 138 in if x = 0 then x else
+		let x : Int <- 139 in if x = 0 then x else
+		let x : Int <- 140 in if x = 0 then x else
+		let x : Int <- 141 in if x = 0 then x else
+		let x : Int <- 142 in if x = 0 then x else
+		let x : Int <- 143 in if x = 0 then x else
+		let x : Int <- 144 in if x = 0 then x else
+		let x : Int <- 145 in if x = 0 then x else
+		let x : Int <- 146 in if x = 0 then x else
+		let x : Int <- 147 in if x = 0 then x else
+		let x : Int <- 148 in if x = 0 then x else
+		let x : Int <- 149 in if x = 0 then x else
+		let x : Int <- 150 in if x = 0 then x else
+		let x : Int <- 151 in if x = 0 then x else
+		let x : Int <- 152 in if x = 0 then x else
+		let x : Int <- 153 in if x = 0 then x else
+		let x : Int <- 154 in if x = 0 then x else
+		let x : Int <- 155 in if x = 0 then x else
+		let x : Int <- 156 in if x = 0 then x else
+		let x : Int <- 157 in if x = 0 then x else
+		let x : Int <- 158 in if x = 0 then x else
+		let x : Int <- 159 in if x = 0 then x else
+		let x : Int <- 160 in if x = 0 then x else
+		let x : Int <- 161 in if x = 0 then x else
+		let x : Int <- 162 in if x = 0 then x else
+		let x : Int <- 163 in if x = 0 then x else
+		let x : Int <- 164 in if x = 0 then x else
+		let x : Int <- 165 in if x = 0 then x else
+		let x : Int <- 166 in if x = 0 then x else
+		let x : Int <- 167 in if x = 0 then x else
+		let x : Int <- 168 in if x = 0 then x else
+		let x : Int <- 169 in if x = 0 then x else
+		let x : Int <- 170 in if x = 0 then x else
+		let x : Int <- 171 in if x = 0 then x else
+		let x : Int <- 172 in if x = 0 then x else
+		let x : Int <- 173 in if x = 0 then x else
+		let x : Int <- 174 in if x = 0 then x else
+		let x : Int <- 175 in if x = 0 then x else
+		let x : Int <- 176 in if x = 0 then x else
+		let x : Int <- 177 in if x = 0 then x else
+		let x : Int <- 178 in if x = 0 then x else
+		let x : Int <- 179 in if x = 0 then x else
+		let x : Int <- 180 in if x = 0 then x else
+		let x : Int <- 181 in if x = 0 then x else
+		let x : Int <- 182 in if x = 0 then x else
+		let x : Int <- 183 in if x = 0 then x else
+		let x : Int <- 184 in if x = 0 then x else
+		let x : Int <- 185 in if x = 0 then x else
+		let x : Int <- 186 in if x = 0 then x else
+		let x : Int <- 187 in if x = 0 then x else
+		let x : Int <- 188 in if x = 0 then x else
+		let x : Int <- 189 in if x = 0 then x else
+		let x : Int <- 190 in if x = 0 then x else
+		let x : Int <- 191 in if x = 0 then x else
+		let x : Int <- 192 in if x = 0 then x else
+		let x : Int <- 193 in if x = 0 then x else
+		let x : Int <- 194 in if x = 0 then x else
+		let x : Int <- 195 in if x = 0 then x else
+		let x : Int <- 196 in if x = 0 then x else
+		let x : Int <- 197 in if x = 0 then x else
+		let x : Int <- 198 in if x = 0 then x else
+		let x : Int <- 199 in if x = 0 then x else
+		let x : Int <- 200 in if x = 0 then x else
+		let x : Int <- 201 in if x = 0 then x else
+		let x : Int <- 202 in if x = 0 then x else
+		let x : Int <- 203 in if x = 0 then x else
+		let x : Int <- 204 in if x = 0 then x else
+		let x : Int <- 205 in if x = 0 then x else
+		let x : Int <- 206 in if x = 0 then x else
+		let x : Int <- 207 in if x = 0 then x else
+		let x : Int <- 208 in if x = 0 then x else
+		let x : Int <- 209 in if x = 0 then x else
+		let x : Int <- 210 in if x = 0 then x else
+		let x : Int <- 211 in if x = 0 then x else
+		let x : Int <- 212 in if x = 0 then x else
+		let x : Int <- 213 in if x = 0 then x else
+		let x : Int <- 214 in if x = 0 then x else
+		let x : Int <- 215 in if x = 0 then x else
+		let x : Int <- 216 in if x = 0 then x else
+		let x : Int <- 217 in if x = 0 then x else
+		let x : Int <- 218 in if x = 0 then x else
+		let x : Int <- 219 in if x = 0 then x else
+		let x : Int <- 220 in if x = 0 then x else
+		let x : Int <- 221 in if x = 0 then x else
+		let x : Int <- 222 in if x = 0 then x else
+		let x : Int <- 223 in if x = 0 then x else
+		let x : Int <- 224 in if x = 0 then x else
+		let x : Int <- 225 in if x = 0 then x else
+		let x : Int <- 226 in if x = 0 then x else
+		let x : Int <- 227 in if x = 0 then x else
+		let x : Int <- 228 in if x = 0 then x else
+		let x : Int <- 229 in if x = 0 then x else
+		let x : Int <- 230 in if x = 0 then x else
+		let x : Int <- 231 in if x = 0 then x else
+		let x : Int <- 232 in if x = 0 then x else
+		let x : Int <- 233 in if x = 0 then x else
+		let x : Int <- 234 in if x = 0 then x else
+		let x : Int <- 235 in if x = 0 then x else
+		let x : Int <- 236 in if x = 0 then x else
+		let x : Int <- 237 in if x = 0 then x else
+		let x : Int <- 238 in if x = 0 then x else
+		let x : Int <- 239 in if x = 0 then x else
+		let x : Int <- 240 in if x = 0 then x else
+		let x : Int <- 241 in if x = 0 then x else
+		let x : Int <- 242 in if x = 0 then x else
+		let x : Int <- 243 in if x = 0 then x else
+		let x : Int <- 244 in if x = 0 then x else
+		let x : Int <- 245 in if x = 0 then x else
+		let x : Int <- 246 in if x = 0 then x else
+		let x : Int <- 247 in if x = 0 then x else
+		let x : Int <- 248 in if x = 0 then x else
+		let x : Int <- 249 in if x = 0 then x else
+		let x : Int <- 250 in if x = 0 then x else
+		let x : Int <- 251 in if x = 0 then x else
+		let x : Int <- 252 in if x = 0 then x else
+		let x : Int <- 253 in if x = 0 then x else
+		let x : Int <- 254 in if x = 0 then x else
+		let x : Int <- 255 in if x = 0 then x else
+		let x : Int <- 256 in if x = 0 then x else
+		let x : Int <- 257 in if x = 0 then x else
+		let x : Int <- 258 in if x = 0 then x else
+		let x : Int <- 259 in if x = 0 then x else
+		let x : Int <- 260 in if x = 0 then x else
+		let x : Int <- 261 in if x = 0 then x else
+		let x : Int <- 262 in if x = 0 then x else
+		let x : Int <- 263 in if x = 0 then x else
+		let x : Int <- 264 in if x = 0 then x else
+		let x : Int <- 265 in if x = 0 then x else
+		let x : Int <- 266 in if x = 0 then x else
+		let x : Int <- 267 in if x = 0 then x else
+		let x : Int <- 268 in if x = 0 then x else
+		let x : Int <- 269 in if x = 0 then x else
+		let x : Int <- 270 in if x = 0 then x else
+		let x : Int <- 271 in if x = 0 then x else
+		let x : Int <- 272 in if x = 0 then x else
+		let x : Int <- 273 in if x = 0 then x else
+		let x : Int <- 274 in if x = 0 then x else
+		let x : Int <- 275 in if x = 0 then x else
+		let x : Int <- 276 in if x = 0 then x else
+		let x : Int <- 277 in if x = 0 then x else
+		let x : Int <- 278 in if x = 0 then x else
+		let x : Int <- 279 in if x = 0 then x else
+		let x : Int <- 280 in if x = 0 then x else
+		let x : Int <- 281 in if x = 0 then x else
+		let x : Int <- 282 in if x = 0 then x else
+		let x : Int <- 283 in if x = 0 then x else
+		let x : Int <- 284 in if x = 0 then x else
+		let x : Int <- 285 in if x = 0 then x else
+		let x : Int <- 286 in if x = 0 then x else
+		let x : Int <- 287 in if x = 0 then x else
+		let x : Int <- 288 in if x = 0 then x else
+		let x : Int <- 289 in if x = 0 then x else
+		let x : Int <- 290 in if x = 0 then x else
+		let x : Int <- 291 in if x = 0 then x else
+		let x : Int <- 292 in if x = 0 then x else
+		let x : Int <- 293 in if x = 0 then x else
+		let x : Int <- 294 in if x = 0 then x else
+		let x : Int <- 295 in if x = 0 then x else
+		let x : Int <- 296 in if x = 0 then x else
+		let x : Int <- 297 in if x = 0 then x else
+		let x : Int <- 298 in if x = 0 then x else
+		let x : Int <- 299 in if x = 0 then x else
+		let x : Int <- 300 in if x = 0 then x else
+		let x : Int <- 301 in if x = 0 then x else
+		let x : Int <- 302 in if x = 0 then x else
+		let x : Int <- 303 in if x = 0 then x else
+		let x : Int <- 304 in if x = 0 then x else
+		let x : Int <- 305 in if x = 0 then x else
+		let x : Int <- 306 in if x = 0 then x else
+		let x : Int <- 307 in if x = 0 then x else
+		let x : Int <- 308 in if x = 0 then x else
+		let x : Int <- 309 in if x = 0 then x else
+		let x : Int <- 310 in if x = 0 then x else
+		let x : Int <- 311 in if x = 0 then x else
+		let x : Int <- 312 in if x = 0 then x else
+		let x : Int <- 313 in if x = 0 then x else
+		let x : Int <- 314 in if x = 0 then x else
+		let x : Int <- 315 in if x = 0 then x else
+		let x : Int <- 316 in if x = 0 then x else
+		let x : Int <- 317 in if x = 0 then x else
+		let x : Int <- 318 in if x = 0 then x else
+		let x : Int <- 319 in if x = 0 then x else
+		let x : Int <- 320 in if x = 0 then x else
+		let x : Int <- 321 in if x = 0 then x else
+		let x : Int <- 322 in if x = 0 then x else
+		let x : Int <- 323 in if x = 0 then x else
+		let x : Int <- 324 in if x = 0 then x else
+		let x : Int <- 325 in if x = 0 then x else
+		let x : Int <- 326 in if x = 0 then x else
+		let x : Int <- 327 in if x = 0 then x else
+		let x : Int <- 328 in if x = 0 then x else
+		let x : Int <- 329 in if x = 0 then x else
+		let x : Int <- 330 in if x = 0 then x else
+		let x : Int <- 331 in if x = 0 then x else
+		let x : Int <- 332 in if x = 0 then x else
+		let x : Int <- 333 in if x = 0 then x else
+		let x : Int <- 334 in if x = 0 then x else
+		let x : Int <- 335 in if x = 0 then x else
+		let x : Int <- 336 in if x = 0 then x else
+		let x : Int <- 337 in if x = 0 then x else
+		let x : Int <- 338 in if x = 0 then x else
+		let x : Int <- 339 in if x = 0 then x else
+		let x : Int <- 340 in if x = 0 then x else
+		let x : Int <- 341 in if x = 0 then x else
+		let x : Int <- 342 in if x = 0 then x else
+		let x : Int <- 343 in if x = 0 then x else
+		let x : Int <- 344 in if x = 0 then x else
+		let x : Int <- 345 in if x = 0 then x else
+		let x : Int <- 346 in if x = 0 then x else
+		let x : Int <- 347 in if x = 0 then x else
+		let x : Int <- 348 in if x = 0 then x else
+		let x : Int <- 349 in if x = 0 then x else
+		let x : Int <- 350 in if x = 0 then x else
+		let x : Int <- 351 in if x = 0 then x else
+		let x : Int <- 352 in if x = 0 then x else
+		let x : Int <- 353 in if x = 0 then x else
+		let x : Int <- 354 in if x = 0 then x else
+		let x : Int <- 355 in if x = 0 then x else
+		let x : Int <- 356 in if x = 0 then x else
+		let x : Int <- 357 in if x = 0 then x else
+		let x : Int <- 358 in if x = 0 then x else
+		let x : Int <- 359 in if x = 0 then x else
+		let x : Int <- 360 in if x = 0 then x else
+		let x : Int <- 361 in if x = 0 then x else
+		let x : Int <- 362 in if x = 0 then x else
+		let x : Int <- 363 in if x = 0 then x else
+		let x : Int <- 364 in if x = 0 then x else
+		let x : Int <- 365 in if x = 0 then x else
+		let x : Int <- 366 in if x = 0 then x else
+		let x : Int <- 367 in if x = 0 then x else
+		let x : Int <- 368 in if x = 0 then x else
+		let x : Int <- 369 in if x = 0 then x else
+		let x : Int <- 370 in if x = 0 then x else
+		let x : Int <- 371 in if x = 0 then x else
+		let x : Int <- 372 in if x = 0 then x else
+		let x : Int <- 373 in if x = 0 then x else
+		let x : Int <- 374 in if x = 0 then x else
+		let x : Int <- 375 in if x = 0 then x else
+		let x : Int <- 376 in if x = 0 then x else
+		let x : Int <- 377 in if x = 0 then x else
+		let x : Int <- 378 in if x = 0 then x else
+		let x : Int <- 379 in if x = 0 then x else
+		let x : Int <- 380 in if x = 0 then x else
+		let x : Int <- 381 in if x = 0 then x else
+		let x : Int <- 382 in if x = 0 then x else
+		let x : Int <- 383 in if x = 0 then x else
+		let x : Int <- 384 in if x = 0 then x else
+		let x : Int <- 385 in if x = 0 then x else
+		let x : Int <- 386 in if x = 0 then x else
+		let x : Int <- 387 in if x = 0 then x else
+		let x : Int <- 388 in if x = 0 then x else
+		let x : Int <- 389 in if x = 0 then x else
+		let x : Int <- 390 in if x = 0 then x else
+		let x : Int <- 391 in if x = 0 then x else
+		let x : Int <- 392 in if x = 0 then x else
+		let x : Int <- 393 in if x = 0 then x else
+		let x : Int <- 394 in if x = 0 then x else
+		let x : Int <- 395 in if x = 0 then x else
+		let x : Int <- 396 in if x = 0 then x else
+		let x : Int <- 397 in if x = 0 then x else
+		let x : Int <- 398 in if x = 0 then x else
+		let x : Int <- 399 in if x = 0 then x else
+		let x : Int <- 400 in if x = 0 then x else
+		let x : Int <- 401 in if x = 0 then x else
+		let x : Int <- 402 in if x = 0 then x else
+		let x : Int <- 403 in if x = 0 then x else
+		let x : Int <- 404 in if x = 0 then x else
+		let x : Int <- 405 in if x = 0 then x else
+		let x : Int <- 406 in if x = 0 then x else
+		let x : Int <- 407 in if x = 0 then x else
+		let x : Int <- 408 in if x = 0 then x else
+		let x : Int <- 409 in if x = 0 then x else
+		let x : Int <- 410 in if x = 0 then x else
+		let x : Int <- 411 in if x = 0 then x else
+		let x : Int <- 412 in if x = 0 then x else
+		let x : Int <- 413 in if x = 0 then x else
+		let x : Int <- 414 in if x = 0 then x else
+		let x : Int <- 415 in if x = 0 then x else
+		let x : Int <- 416 in if x = 0 then x else
+		let x : Int <- 417 in if x = 0 then x else
+		let x : Int <- 418 in if x = 0 then x else
+		let x : Int <- 419 in if x = 0 then x else
+		let x : Int <- 420 in if x = 0 then x else
+		let x : Int <- 421 in if x = 0 then x else
+		let x : Int <- 422 in if x = 0 then x else
+		let x : Int <- 423 in if x = 0 then x else
+		let x : Int <- 424 in if x = 0 then x else
+		let x : Int <- 425 in if x = 0 then x else
+		let x : Int <- 426 in if x = 0 then x else
+		let x : Int <- 427 in if x = 0 then x else
+		let x : Int <- 428 in if x = 0 then x else
+		let x : Int <- 429 in if x = 0 then x else
+		let x : Int <- 430 in if x = 0 then x else
+		let x : Int <- 431 in if x = 0 then x else
+		let x : Int <- 432 in if x = 0 then x else
+		let x : Int <- 433 in if x = 0 then x else
+		let x : Int <- 434 in if x = 0 then x else
+		let x : Int <- 435 in if x = 0 then x else
+		let x : Int <- 436 in if x = 0 then x else
+		let x : Int <- 437 in if x = 0 then x else
+		let x : Int <- 438 in if x = 0 then x else
+		let x : Int <- 439 in if x = 0 then x else
+		let x : Int <- 440 in if x = 0 then x else
+		let x : Int <- 441 in if x = 0 then x else
+		let x : Int <- 442 in if x = 0 then x else
+		let x : Int <- 443 in if x = 0 then x else
+		let x : Int <- 444 in if x = 0 then x else
+		let x : Int <- 445 in if x = 0 then x else
+		let x : Int <- 446 in if x = 0 then x else
+		let x : Int <- 447 in if x = 0 then x else
+		let x : Int <- 448 in if x = 0 then x else
+		let x : Int <- 449 in if x = 0 then x else
+		let x : Int <- 450 in if x = 0 then x else
+		let x : Int <- 451 in if x = 0 then x else
+		let x : Int <- 452 in if x = 0 then x else
+		let x : Int <- 453 in if x = 0 then x else
+		let x : Int <- 454 in if x = 0 then x else
+		let x : Int <- 455 in if x = 0 then x else
+		let x : Int <- 456 in if x = 0 then x else
+		let x : Int <- 457 in if x = 0 then x else
+		let x : Int <- 458 in if x = 0 then x else
+		let x : Int <- 459 in if x = 0 then x else
+		let x : Int <- 460 in if x = 0 then x else
+		let x : Int <- 461 in if x = 0 then x else
+		let x : Int <- 462 in if x = 0 then x else
+		let x : Int <- 463 in if x = 0 then x else
+		let x : Int <- 464 in if x = 0 then x else
+		let x : Int <- 465 in if x = 0 then x else
+		let x : Int <- 466 in if x = 0 then x else
+		let x : Int <- 467 in if x = 0 then x else
+		let x : Int <- 468 in if x = 0 then x else
+		let x : Int <- 469 in if x = 0 then x else
+		let x : Int <- 470 in if x = 0 then x else
+		let x : Int <- 471 in if x = 0 then x else
+		let x : Int <- 472 in if x = 0 then x else
+		let x : Int <- 473 in if x = 0 then x else
+		let x : Int <- 474 in if x = 0 then x else
+		let x : Int <- 475 in if x = 0 then x else
+		let x : Int <- 476 in if x = 0 then x else
+		let x : Int <- 477 in if x = 0 then x else
+		let x : Int <- 478 in if x = 0 then x else
+		let x : Int <- 479 in if x = 0 then x else
+		let x : Int <- 480 in if x = 0 then x else
+		let x : Int <- 481 in if x = 0 then x else
+		let x : Int <- 482 in if x = 0 then x else
+		let x : Int <- 483 in if x = 0 then x else
+		let x : Int <- 484 in if x = 0 then x else
+		let x : Int <- 485 in if x = 0 then x else
+		let x : Int <- 486 in if x = 0 then x else
+		let x : Int <- 487 in if x = 0 then x else
+		let x : Int <- 488 in if x = 0 then x else
+		let x : Int <- 489 in if x = 0 then x else
+		let x : Int <- 490 in if x = 0 then x else
+		let x : Int <- 491 in if x = 0 then x else
+		let x : Int <- 492 in if x = 0 then x else
+		let x : Int <- 493 in if x = 0 then x else
+		let x : Int <- 494 in if x = 0 then x else
+		let x : Int <- 495 in if x = 0 then x else
+		let x : Int <- 496 in if x = 0 then x else
+		let x : Int <- 497 in if x = 0 then x else
+		let x : Int <- 498 in if x = 0 then x else
+		let x : Int <- 499 in if x = 0 then x else
+		0
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+		fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi fi
+	};
+};
@@ -0,0 +1,66 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+-- Precedence and associativity of operators
+
+class Main
+{
+	a : Int;
+	b : Bool;
+	c : Int;
+	x : Main;
+
+	f() : Int { 1 };
+
+	main() : Object
+	{{
+		-- not binds less tightly than arithmetic and comparisons
+		a * not b + c;
+		not a = b;
+		not not a < c;
+
+		-- Negation and isvoid bind less tightly than dispatch
+		~x.f();
+		~a@Main.f();
+		isvoid a * b;
+		isvoid x.f() + 1;
+		~~a;
+
+		-- Expressions ending with a keyword can be operands
+		if a < c then a else c fi + 1;
+		a * while b loop a pool;
+		{ a; } - (let y : Int in y);
+		case a of y : Int => y; esac / 2;
+
+		-- Arithmetic is left associative
+		a + b - c * a / b;
+		a - b - c;
+		a / b / c * a;
+
+		-- Assignment is right associative and binds least tightly
+		a <- b <- c = a;
+		a <- not b;
+
+		-- Comparisons do not associate
+		a < b = c;
+		a = b <= c;
+
+		-- let extends as far right as possible
+		let y : Int in y + 1;
+		a + let y : Int in y * 2;
+	}};
+};
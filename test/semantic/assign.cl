@@ -0,0 +1,54 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+-- Assignment tests
+
+class Main inherits IO
+{
+	count : Int;
+	name : String <- "attribute\n";
+
+	-- Print integer with newline
+	out_int_ln(int : Int) : Object
+	{{
+		out_int(int);
+		out_string("\n");
+	}};
+
+	main() : Object
+	{{
+		-- The value of an assignment is the value assigned
+		out_int_ln(count <- 5);
+		out_int_ln((count <- count + 1) * 2);
+		out_string(name <- "assigned\n");
+		out_string(name);
+
+		-- Locals and attributes
+		let local : Int <- 1 in
+		{
+			out_int_ln((local <- local + count) + 1);
+			out_int_ln(local);
+		};
+
+		-- Assignments inside conditionals (which are upcast to Object)
+		case if count = 6 then count <- 7 else name <- "wrong\n" fi of
+			int : Int => out_int(int);
+			str : String => out_string(str);
+		esac;
+		out_string("\n");
+	}};
+};
@@ -0,0 +1,267 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+
+-- Attribute layout tests
+
+-- A few Bools packed together with other attributes
+class Point
+{
+	visible : Bool <- true;
+	x : Int <- 3;
+	selected : Bool;
+	label : String <- "point";
+	y : Int <- 4;
+	moved : Bool;
+
+	move(dx : Int, dy : Int) : Point
+	{{
+		x <- x + dx;
+		y <- y + dy;
+		moved <- true;
+		self;
+	}};
+
+	toggle() : Bool { selected <- not selected };
+	hide() : Bool { visible <- false };
+
+	describe(io : IO) : IO
+	{{
+		io.out_string(label).out_string(" ");
+		io.out_int(x).out_string(" ");
+		io.out_int(y).out_string(" ");
+		if visible then io.out_string("visible ") else io.out_string("hidden ") fi;
+		if selected then io.out_string("selected ") else io.out_string("unselected ") fi;
+		if moved then io.out_string("moved\n") else io.out_string("still\n") fi;
+	}};
+};
+
+-- Subclass attributes are placed after (and around) the parent's
+class ColorPoint inherits Point
+{
+	color : Int <- 7;
+	bright : Bool <- true;
+
+	darken() : Bool { bright <- false };
+
+	describe_color(io : IO) : IO
+	{{
+		io.out_string("color ").out_int(color);
+		if bright then io.out_string(" bright\n") else io.out_string(" dark\n") fi;
+	}};
+};
+
+-- Enough Bools to need more than one flags word
+class ManyFlags
+{
+	b0 : Bool;
+	b1 : Bool;
+	b2 : Bool;
+	b3 : Bool;
+	b4 : Bool;
+	b5 : Bool;
+	b6 : Bool;
+	b7 : Bool;
+	b8 : Bool;
+	b9 : Bool;
+	b10 : Bool;
+	b11 : Bool;
+	b12 : Bool;
+	b13 : Bool;
+	b14 : Bool;
+	b15 : Bool;
+	b16 : Bool;
+	b17 : Bool;
+	b18 : Bool;
+	b19 : Bool;
+	b20 : Bool;
+	b21 : Bool;
+	b22 : Bool;
+	b23 : Bool;
+	b24 : Bool;
+	b25 : Bool;
+	b26 : Bool;
+	b27 : Bool;
+	b28 : Bool;
+	b29 : Bool;
+	b30 : Bool;
+	b31 : Bool;
+	b32 : Bool;
+	b33 : Bool;
+	b34 : Bool;
+	b35 : Bool;
+	b36 : Bool;
+	b37 : Bool;
+	b38 : Bool;
+	b39 : Bool;
+
+	set_all(value : Bool) : Object
+	{{
+		b0 <- value;
+		b1 <- value;
+		b2 <- value;
+		b3 <- value;
+		b4 <- value;
+		b5 <- value;
+		b6 <- value;
+		b7 <- value;
+		b8 <- value;
+		b9 <- value;
+		b10 <- value;
+		b11 <- value;
+		b12 <- value;
+		b13 <- value;
+		b14 <- value;
+		b15 <- value;
+		b16 <- value;
+		b17 <- value;
+		b18 <- value;
+		b19 <- value;
+		b20 <- value;
+		b21 <- value;
+		b22 <- value;
+		b23 <- value;
+		b24 <- value;
+		b25 <- value;
+		b26 <- value;
+		b27 <- value;
+		b28 <- value;
+		b29 <- value;
+		b30 <- value;
+		b31 <- value;
+		b32 <- value;
+		b33 <- value;
+		b34 <- value;
+		b35 <- value;
+		b36 <- value;
+		b37 <- value;
+		b38 <- value;
+		b39 <- value;
+	}};
+
+	flip_some() : Object
+	{{
+		b0 <- not b0;
+		b3 <- not b3;
+		b6 <- not b6;
+		b9 <- not b9;
+		b12 <- not b12;
+		b15 <- not b15;
+		b18 <- not b18;
+		b21 <- not b21;
+		b24 <- not b24;
+		b27 <- not b27;
+		b30 <- not b30;
+		b33 <- not b33;
+		b36 <- not b36;
+		b39 <- not b39;
+	}};
+
+	count() : Int
+	{
+		let total : Int <- 0 in
+		{
+			if b0 then total <- total + 1 else total fi;
+			if b1 then total <- total + 1 else total fi;
+			if b2 then total <- total + 1 else total fi;
+			if b3 then total <- total + 1 else total fi;
+			if b4 then total <- total + 1 else total fi;
+			if b5 then total <- total + 1 else total fi;
+			if b6 then total <- total + 1 else total fi;
+			if b7 then total <- total + 1 else total fi;
+			if b8 then total <- total + 1 else total fi;
+			if b9 then total <- total + 1 else total fi;
+			if b10 then total <- total + 1 else total fi;
+			if b11 then total <- total + 1 else total fi;
+			if b12 then total <- total + 1 else total fi;
+			if b13 then total <- total + 1 else total fi;
+			if b14 then total <- total + 1 else total fi;
+			if b15 then total <- total + 1 else total fi;
+			if b16 then total <- total + 1 else total fi;
+			if b17 then total <- total + 1 else total fi;
+			if b18 then total <- total + 1 else total fi;
+			if b19 then total <- total + 1 else total fi;
+			if b20 then total <- total + 1 else total fi;
+			if b21 then total <- total + 1 else total fi;
+			if b22 then total <- total + 1 else total fi;
+			if b23 then total <- total + 1 else total fi;
+			if b24 then total <- total + 1 else total fi;
+			if b25 then total <- total + 1 else total fi;
+			if b26 then total <- total + 1 else total fi;
+			if b27 then total <- total + 1 else total fi;
+			if b28 then total <- total + 1 else total fi;
+			if b29 then total <- total + 1 else total fi;
+			if b30 then total <- total + 1 else total fi;
+			if b31 then total <- total + 1 else total fi;
+			if b32 then total <- total + 1 else total fi;
+			if b33 then total <- total + 1 else total fi;
+			if b34 then total <- total + 1 else total fi;
+			if b35 then total <- total + 1 else total fi;
+			if b36 then total <- total + 1 else total fi;
+			if b37 then total <- total + 1 else total fi;
+			if b38 then total <- total + 1 else total fi;
+			if b39 then total <- total + 1 else total fi;
+			total;
+		}
+	};
+};
+
+class Main inherits IO
+{
+	out_int_ln(int : Int) : Object
+	{{
+		out_int(int);
+		out_string("\n");
+	}};
+
+	main() : Object
+	{{
+		let p : Point <- new Point in
+		{
+			p.describe(self);
+			p.move(1, 2).describe(self);
+			p.toggle();
+			p.describe(self);
+			p.hide();
+			p.toggle();
+			p.describe(self);
+		};
+
+		let c : ColorPoint <- new ColorPoint in
+		{
+			c.describe(self);
+			c.describe_color(self);
+			c.toggle();
+			c.darken();
+			c.move(10, 20);
+			c.describe(self);
+			c.describe_color(self);
+		};
+
+		let f : ManyFlags <- new ManyFlags in
+		{
+			out_int_ln(f.count());
+			f.set_all(true);
+			out_int_ln(f.count());
+			f.flip_some();
+			out_int_ln(f.count());
+			f.set_all(false);
+			f.flip_some();
+			out_int_ln(f.count());
+		};
+	}};
+};
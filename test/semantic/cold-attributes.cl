@@ -0,0 +1,166 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+
+-- Attribute profile tests
+--  cold-attributes.prof is the profile written by this program. With it,
+--  the rarely used attributes of Account and Savings are moved into side
+--  objects which are only allocated when one of them is first used.
+
+class Account
+{
+	balance : Int;
+	owner : String;
+	note : String;
+	joint : Account;
+	frozen : Bool;
+	opened : Int;
+
+	deposit(amount : Int) : Int { balance <- balance + amount };
+	balance() : Int { balance };
+
+	open(o : String, day : Int) : Account {{ owner <- o; opened <- day; self; }};
+	annotate(n : String) : Account {{ note <- n; self; }};
+	share(a : Account) : Account {{ joint <- a; self; }};
+	freeze() : Account {{ frozen <- true; self; }};
+	joint() : Account { joint };
+
+	print(io : IO) : IO
+	{{
+		io.out_string(owner).out_string(" ").out_int(balance).out_string(" ").out_int(opened);
+		io.out_string(" [").out_string(note).out_string("]");
+		if frozen then io.out_string(" frozen") else io.out_string("") fi;
+		if isvoid joint then io.out_string("\n") else io.out_string(" with ").out_string(joint.owner()).out_string("\n") fi;
+	}};
+
+	owner() : String { owner };
+};
+
+class Savings inherits Account
+{
+	rate : Int;
+	bonus : Int;
+	reason : String;
+
+	grow() : Int { deposit(rate) };
+	set_rate(r : Int) : Savings {{ rate <- r; self; }};
+	reward(b : Int, r : String) : Savings {{ bonus <- b; reason <- r; self; }};
+
+	print_bonus(io : IO) : IO
+	{{
+		io.out_int(bonus).out_string(" ").out_string(reason).out_string("\n");
+	}};
+};
+
+class Main inherits IO
+{
+	-- Output goes through a separate object since passing self to other
+	--  methods would keep Main (and its attributes) alive after main returns
+	io : IO <- new IO;
+
+	-- These are destroyed after main returns
+	plain : Account;
+	kept : Account;
+	kept_copy : Account;
+	kept_savings : Savings;
+
+	main() : Object
+	{{
+		let a : Account <- new Account, b : Account <- new Account, i : Int <- 0 in
+		{
+			-- The hot attribute is used in a loop (and the cold ones are not)
+			while i < 500 loop {
+				a.deposit(2);
+				b.deposit(3);
+				i <- i + 1;
+			} pool;
+
+			-- Copy an object without a side object, then use its cold attributes
+			case b.copy() of c : Account =>
+			{
+				c.open("copy of b", 3);
+				c.print(io);
+			};
+			esac;
+			b.print(io);
+
+			-- Write and read cold attributes
+			a.open("alice", 1).annotate("first");
+			b.open("bob", 2).share(a).freeze();
+			a.print(io);
+			b.print(io);
+
+			-- Copy objects with side objects and change the copies
+			case a.copy() of c : Account =>
+			{
+				c.annotate("copied").deposit(1);
+				c.print(io);
+			};
+			esac;
+			case b.copy() of c : Account =>
+			{
+				c.joint().deposit(5);
+				c.print(io);
+			};
+			esac;
+			a.print(io);
+			b.print(io);
+		};
+
+		-- Destroy lots of objects with and without side objects (the shared
+		--  account must survive all of them)
+		let shared : Account <- (new Account).open("shared", 4), i : Int <- 0 in
+		{
+			while i < 20 loop {
+				let t : Account <- new Account in
+				{
+					t.deposit(i);
+					if i - (i / 2) * 2 = 0 then t.share(shared).annotate("temporary") else t fi;
+				};
+				i <- i + 1;
+			} pool;
+			shared.print(io);
+		};
+
+		-- Subclasses have their own side objects
+		let s : Savings <- new Savings, i : Int <- 0 in
+		{
+			s.set_rate(7);
+			while i < 1000 loop { s.grow(); i <- i + 1; } pool;
+			s.open("saver", 5);
+			s.reward(10, "loyalty").annotate("savings");
+			s.print(io);
+			s.print_bonus(io);
+			case s.copy() of c : Savings => c.reward(20, "copied").print_bonus(io); esac;
+			s.print_bonus(io);
+		};
+
+		-- Objects with and without side objects (their strings are built with
+		--  concat since string literals cannot be destroyed)
+		plain <- new Account;
+		plain.deposit(1);
+		kept <- (new Account).open("ka".concat("te"), 6).annotate("kept".concat("!"));
+		kept.share((new Account).open("jo".concat("e"), 7));
+		kept_copy <- case kept.copy() of c : Account => c; esac;
+		kept_copy.annotate("copy".concat("!"));
+		kept_savings <- new Savings;
+		kept_savings.reward(1, "end".concat("!"));
+		kept.print(io);
+		kept_copy.print(io);
+		kept_savings.print_bonus(io);
+	}};
+};
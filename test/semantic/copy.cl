@@ -0,0 +1,85 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+
+-- Object copying tests
+
+class Point
+{
+	x : Int;
+	y : Int;
+	label : String <- "point";
+	visible : Bool;
+
+	init(nx : Int, ny : Int, l : String) : Point {{ x <- nx; y <- ny; label <- l; visible <- true; self; }};
+	move(dx : Int) : Point {{ x <- x + dx; self; }};
+	hide() : Point {{ visible <- false; self; }};
+
+	print(io : IO) : IO
+	{{
+		io.out_string(label).out_string(" ").out_int(x).out_string(" ").out_int(y);
+		if visible then io.out_string(" visible\n") else io.out_string(" hidden\n") fi;
+	}};
+};
+
+class Line inherits Point
+{
+	other : Point;
+
+	link(p : Point) : Line {{ other <- p; self; }};
+	other() : Point { other };
+};
+
+class Main inherits IO
+{
+	main() : Object
+	{{
+		let p : Point <- (new Point).init(1, 2, "p"), q : Point in
+		{
+			-- A copy has the same attribute values as the original
+			q <- case p.copy() of c : Point => c; esac;
+			q.print(self);
+
+			-- And is a different object
+			q.move(10).hide();
+			p.print(self);
+			q.print(self);
+
+			-- Copy of a copy
+			case q.copy() of c : Point => c.print(self); esac;
+		};
+
+		-- Copying a subclass copies the parent's attributes too
+		let l : Line <- new Line, p : Point <- (new Point).init(3, 4, "target"), m : Line in
+		{
+			l.init(5, 6, "line");
+			l.link(p);
+			m <- case l.copy() of c : Line => c; esac;
+			m.print(self);
+
+			-- References to other objects are shared, not copied
+			m.other().move(100);
+			l.other().print(self);
+			if isvoid (new Line).copy() then out_string("void\n") else out_string("not void\n") fi;
+		};
+
+		-- Copies of basic values
+		case 42.copy() of i : Int => out_int(i); esac;
+		case "str".copy() of s : String => out_string(" ".concat(s)); esac;
+		case true.copy() of b : Bool => if b then out_string(" true\n") else out_string(" false\n") fi; esac;
+	}};
+};
@@ -0,0 +1,52 @@
+(*
+ * Copyright (C) 2017 James Cowgill
+ *
+ * LCool is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LCool is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LCool.  If not, see <http://www.gnu.org/licenses/>.
+ *)
+
+-- Template for files which are big enough to be split between threads
+--  split_test_driver repeats this file with CLASS_ID replaced by the number
+--  of each copy. The word class appears in comments and strings so that
+--  splitting the file there would cause syntax errors.
+
+(* Not a class: class Fake inherits IO { };
+   (* class Nested { }; *) class After { }; *)
+class ClassCLASS_ID inherits IO
+{
+	-- class Comment { };
+	name : String <- "class String { };";
+	escaped : String <- "\" class Escaped { }; \
+class Continued { };";
+	classy : Int <- 123456789012;
+	subclass : Int <- CLASS_ID;
+
+	describe() : String
+	{
+		if subclass < 0 then "(* class Unopened { }; " else "-- class Uncommented { };" fi
+	};
+
+	count(n : Int) : Int
+	{
+		let total : Int <- 0 in
+		{
+			while 0 < n loop
+			{
+				total <- total + n * subclass;
+				n <- n - 1;
+			}
+			pool;
+			total;
+		}
+	};
+};